@@ -17,11 +17,11 @@
 #    along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #
-#This is a shell script wrapper for 'fastx_barcode_splitter.pl'
+#This is a shell script wrapper for 'fastx_barcode_splitter'
 #
 # 1. Output files are saved at the dataset's files_path directory.
 #    
-# 2. 'fastx_barcode_splitter.pl' outputs a textual table.
+# 2. 'fastx_barcode_splitter' outputs a textual table.
 #    This script turns it into pretty HTML with working URL
 #    (so lazy users can just click on the URLs and get their files)
 
@@ -67,7 +67,7 @@ BASEPATH="$OUTPUT_PATH/"
 PREFIX="$BASEPATH""${LIBNAME}__"
 SUFFIX=".txt"
 
-RESULTS=`gzip -cdf "$FASTQ_FILE" | fastx_barcode_splitter.pl --bcfile "$BARCODE_FILE" --prefix "$PREFIX" --suffix "$SUFFIX" "$@"`
+RESULTS=`gzip -cdf "$FASTQ_FILE" | fastx_barcode_splitter --bcfile "$BARCODE_FILE" --prefix "$PREFIX" --suffix "$SUFFIX" "$@"`
 if [ $? != 0 ]; then
 	echo "error"
 fi
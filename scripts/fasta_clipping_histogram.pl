@@ -18,9 +18,13 @@
 
 use strict;
 use warnings;
+use FindBin;
 use GD::Graph::bars;
-use Data::Dumper;
-use PerlIO::gzip;
+
+##
+## The lengths histogram itself is calculated by 'fastx_length_histogram'
+## (which also handles FASTQ and GZIPped input). This script only draws it.
+##
 
 if (scalar @ARGV==0) {
 	print<<END;
@@ -36,45 +40,27 @@ END
 	exit 0;
 }
 
+my $program = "$FindBin::Bin/fastx_length_histogram";
+$program = "fastx_length_histogram" unless -x $program;
+
 #
 # Read parameters
 #
-open(IN, "<:gzip(autopop)", "$ARGV[0]") or die "Cannot open input file $ARGV[0]\n";
 open(OUT, ">$ARGV[1]") or die "Cannot create output file $ARGV[1]\n";
 binmode OUT;
 
-my %histogram ;
+open(HISTOGRAM, "-|", $program, "-i", $ARGV[0])
+	or die "Cannot run fastx_length_histogram: $!\n";
 
-while (my $name = <IN>) {
-	my $sequence = <IN> ;
-	chomp $sequence;
-	
-	my $sequence_length = length($sequence);
-	
-	my $count;
-
-	if ( index($name, "-")==-1 ) {
-		#Assume this file is not collapsed, just count each seqeunce as 1
-		$count = 1 ;
-	} else  {
-		#Assume file is collapsed (that is - sequence-ID has two numbers with a separating dash)
-		($count) = $name =~ /^\>[^-]+\-(\d+)$/ ;
-
-		# If the match failed, treat this fasta as not collapsed;
-		$count = 1 if not defined $count ;
-	}
-	
-	$histogram{$sequence_length} += $count ;
-}
+my %histogram ;
 
-#Textual Output
-if (0) {
-	print "Length\tCount\n";
-	foreach my $length_key ( sort { $a <=> $b } keys %histogram ) {
-		print $length_key,"\t", $histogram{$length_key},"\n";
-	}
-	exit 0;
+my $header = <HISTOGRAM>;
+while (my $line = <HISTOGRAM>) {
+	chomp $line;
+	my ($length, $count) = split /\t/, $line;
+	$histogram{$length} = $count;
 }
+close HISTOGRAM or die "fastx_length_histogram failed on input file $ARGV[0]\n";
 
 ## Build the data as required by GD::Graph::bars.
 ## Data list has two items (each item is itself a list)
@@ -100,5 +86,4 @@ $graph->set(
 $graph->plot(\@data) or die $graph->error;
 print OUT $graph->gd->png;
 
-close IN;
 close OUT;
@@ -17,14 +17,15 @@
 */
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <fstream>
 #include <string>
 
 #include <getopt.h>
 #include <err.h>
 
 #include <gtextutils/stream_wrapper.h>
-#include <gtextutils/text_line_reader.h>
 
 #include "sequence_writers.h"
 
@@ -34,12 +35,13 @@ using namespace std;
 
 string input_filename;
 string output_filename;
+string fai_filename;
 bool flag_output_empty_sequences = false ;
 bool flag_output_tabular = false ;
 int  flag_requested_output_width = 0 ;
 
 const char* usage_string=
-"usage: fasta_formatter [-h] [-i INFILE] [-o OUTFILE] [-w N] [-t] [-e]\n" \
+"usage: fasta_formatter [-h] [-i INFILE] [-o OUTFILE] [-w N] [-t] [-e] [-x FAIFILE]\n" \
 "Part of " PACKAGE_STRING " by assafgordon@gmail.com\n" \
 "\n" \
 "   [-h]         = This helpful help screen.\n" \
@@ -55,6 +57,8 @@ const char* usage_string=
 "   [-e]         = Output empty sequences (default is to discard them).\n" \
 "                  Empty sequences are ones who have only a sequence identifier,\n" \
 "                  but not actual nucleotides.\n" \
+"   [-x FAIFILE] = Write a samtools-compatible FASTA index (.fai) of the\n" \
+"                  output file to FAIFILE (can't be used with [-t]).\n" \
 "\n" \
 "Input Example:\n" \
 "   >MY-ID\n" \
@@ -97,7 +101,7 @@ void parse_command_line(int argc, char* argv[])
 {
 	int opt;
 
-	while ( (opt = getopt(argc, argv, "i:o:hw:te") ) != -1 ) {
+	while ( (opt = getopt(argc, argv, "i:o:hw:tex:") ) != -1 ) {
 		
 		//Parse the default options
 		switch(opt) {
@@ -125,14 +129,101 @@ void parse_command_line(int argc, char* argv[])
 		case 'e':
 			flag_output_empty_sequences = true;
 			break;
+
+		case 'x':
+			fai_filename = optarg;
+			break;
 			
 		default:
 			exit(1);
 		}
 	}
+
+	if ( !fai_filename.empty() && flag_output_tabular )
+		errx(1,"FASTA index [-x] can't be written with tabular output [-t]");
 }
 
 
+/*
+ * Streaming FASTA re-formatter.
+ *
+ * The input is read in fixed-size blocks. Identifier lines are collected
+ * into 'sequence_id', but nucleotides are passed to the writer directly
+ * from the input block (one call per line fragment) - a sequence is never
+ * held in memory, regardless of its length.
+ */
+void reformat_fasta(istream& input, SequencesWriter* pWriter)
+{
+	const size_t block_size = 256*1024 ;
+	char *block = new char[block_size];
+
+	string sequence_id ;
+	bool at_line_start = true ;
+	bool in_sequence_id = false ;
+	bool have_sequence = false ;
+	bool skip_line = false ;	// nucleotides before the first identifier are discarded
+
+	while ( true ) {
+		input.read ( block, block_size ) ;
+		size_t length = input.gcount();
+		if ( length == 0 )
+			break;
+
+		const char* p = block ;
+		const char* end = block + length ;
+		while ( p < end ) {
+			if ( at_line_start ) {
+				if ( *p == '\n' ) { // empty line
+					p++;
+					continue;
+				}
+				at_line_start = false ;
+				if ( *p == '>' ) {
+					//Got new sequence identifier - finish the previous sequence
+					if ( have_sequence )
+						pWriter->end_sequence();
+					have_sequence = false ;
+					in_sequence_id = true ;
+					sequence_id.clear();
+				}
+				skip_line = !in_sequence_id && !have_sequence ;
+			}
+
+			const char* eol = (const char*)memchr ( p, '\n', end - p ) ;
+			const char* segment_end = (eol!=NULL) ? eol : end ;
+
+			if ( in_sequence_id ) {
+				sequence_id.append ( p, segment_end - p ) ;
+				if ( eol != NULL ) {
+					pWriter->start_sequence ( sequence_id ) ;
+					in_sequence_id = false ;
+					have_sequence = true ;
+				}
+			} else if ( !skip_line ) {
+				//Got sequence nucleotides
+				pWriter->write_bases ( p, segment_end - p ) ;
+			}
+
+			if ( eol != NULL ) {
+				at_line_start = true ;
+				p = eol + 1 ;
+			} else {
+				p = end ;
+			}
+		}
+	}
+
+	//Finish the last sequence (identifier line without a trailing newline, too)
+	if ( in_sequence_id ) {
+		pWriter->start_sequence ( sequence_id ) ;
+		have_sequence = true ;
+	}
+	if ( have_sequence )
+		pWriter->end_sequence();
+
+	delete[] block;
+}
+
 int main(int argc, char* argv[])
 {
 	ios::sync_with_stdio(false);
@@ -141,7 +232,7 @@ int main(int argc, char* argv[])
 
 	InputStreamWrapper input ( input_filename ) ;
 	OutputStreamWrapper output ( output_filename );
-	TextLineReader reader ( input.stream() ) ;
+	OutputBlockBuffer output_buffer ( output.stream() ) ;
 
 	/*
 	 * Use the writer according to the user's request
@@ -149,53 +240,34 @@ int main(int argc, char* argv[])
 	SequencesWriter * pWriter = NULL ;
 
 	if ( flag_output_tabular ) {
-		pWriter = new TabulatedFastaWriter ( output.stream() ) ;
+		pWriter = new TabulatedFastaWriter ( output_buffer ) ;
 	} else {
 		if ( flag_requested_output_width == 0 )
-			pWriter = new SingleLineFastaWriter ( output.stream() ) ;
+			pWriter = new SingleLineFastaWriter ( output_buffer ) ;
 		else 
-			pWriter = new MultiLineFastaWriter ( output.stream(), flag_requested_output_width ) ;
+			pWriter = new MultiLineFastaWriter ( output_buffer, flag_requested_output_width ) ;
+	}
+
+	ofstream fai_file ;
+	if ( !fai_filename.empty() ) {
+		fai_file.open ( fai_filename.c_str() ) ;
+		if ( !fai_file )
+			err(1,"Failed to create FASTA index file (%s)", fai_filename.c_str());
+		pWriter = new FaiIndexWriter ( pWriter, output_buffer, fai_file, flag_requested_output_width ) ;
 	}
 	if (!flag_output_empty_sequences) {
 		EmptySequencesFilter *filter = new EmptySequencesFilter ( pWriter ) ;
 		pWriter = filter ;
 	}
 
+	reformat_fasta ( input.stream(), pWriter ) ;
 
-	/*
-	 * FASTA read/process/write loop
-	 */
-	int max_length = 0 ;
-	string sequence_id ;
-	string sequence_bases ;
-	bool first_line = true ;
-	while ( reader.next_line() ) {
+	delete pWriter;
+	output_buffer.flush();
 
-		const string &line = reader.line_string();
-		
-		if ( line.length()==0 )
-			continue;
-
-		if ( line[0] == '>' ) {
-			//Got new sequence identifier - print previous sequence
-			if (first_line)
-				first_line = false;
-			else
-				pWriter->write ( sequence_id, sequence_bases ) ;
-			
-			// Start new sequence 
-			sequence_id = line ;
-			sequence_bases.clear();
-			sequence_bases.resize ( max_length * 2 ) ;
-		} else {
-			//Got sequence nucleotides
-			sequence_bases += line ;
-		}
+	if ( !fai_filename.empty() ) {
+		fai_file.close();
+		if ( !fai_file )
+			err(1,"Failed to write FASTA index file (%s)", fai_filename.c_str());
 	}
-
-	//Write the last sequence
-	pWriter->write ( sequence_id, sequence_bases ) ;
-
-	delete pWriter;
 }
-
@@ -18,95 +18,307 @@
 #ifndef __SEQUENCE_WRITERS__
 #define __SEQUENCE_WRITERS__
 
+#include <algorithm>
+#include <cstring>
 #include <string>
 #include <ostream>
+#include <fstream>
 
+/*
+ * Fixed-size output buffer.
+ *
+ * Bytes are copied into a single block, which is written to the
+ * output stream (with one large write) whenever it fills up.
+ * Memory usage is constant, regardless of the sequences' length.
+ */
+class OutputBlockBuffer
+{
+private:
+	std::ostream& ostrm ;
+	char*  block ;
+	size_t block_size ;
+	size_t used ;
+	unsigned long long total_bytes ;
+
+	OutputBlockBuffer ( const OutputBlockBuffer& ) ;
+	OutputBlockBuffer& operator= ( const OutputBlockBuffer& ) ;
+
+public:
+	OutputBlockBuffer ( std::ostream& output_stream, size_t _block_size = 256*1024 ) :
+		ostrm ( output_stream ), block ( new char[_block_size] ),
+		block_size ( _block_size ), used ( 0 ), total_bytes ( 0 )
+	{
+	}
+
+	~OutputBlockBuffer()
+	{
+		flush();
+		delete[] block;
+	}
+
+	void flush()
+	{
+		if ( used > 0 ) {
+			ostrm.write ( block, used ) ;
+			used = 0 ;
+		}
+		ostrm.flush();
+	}
+
+	void put ( char c )
+	{
+		if ( used == block_size )
+			flush();
+		block[used++] = c ;
+		total_bytes++;
+	}
+
+	void put ( const char* data, size_t length )
+	{
+		total_bytes += length ;
+		while ( length > 0 ) {
+			if ( used == block_size )
+				flush();
+			size_t n = std::min ( length, block_size - used ) ;
+			memcpy ( block + used, data, n ) ;
+			used += n ;
+			data += n ;
+			length -= n ;
+		}
+	}
+
+	// Number of bytes written so far (= offset of the next byte in the output)
+	unsigned long long offset() const { return total_bytes ; }
+};
+
+/*
+ * Sequence writers are streaming: each sequence is written as
+ *   start_sequence() , write_bases() (any number of times) , end_sequence()
+ * so sequences never need to be held in memory.
+ */
 class SequencesWriter
 {
 public:
 	virtual ~SequencesWriter() {}
-	virtual void write ( const std::string& sequence_id, const std::string& sequence_bases ) = 0 ;
+	virtual void start_sequence ( const std::string& sequence_id ) = 0 ;
+	virtual void write_bases ( const char* bases, size_t length ) = 0 ;
+	virtual void end_sequence () = 0 ;
 };
 
+/*
+ * Holds back the sequence identifier until the first nucleotides are written,
+ * so that sequences without any nucleotides are never passed upstream.
+ */
 class EmptySequencesFilter : public SequencesWriter
 {
 private:
 	SequencesWriter* upstream ;
+	std::string pending_sequence_id ;
+	bool started ;
 
 public:
-	EmptySequencesFilter ( SequencesWriter * _upstream ) : upstream(_upstream) {}
+	EmptySequencesFilter ( SequencesWriter * _upstream ) : upstream(_upstream), started(false) {}
 
 	~EmptySequencesFilter()
 	{
 		delete upstream;
 	}
 
-	virtual void write ( const std::string & sequence_id, const std::string& sequence_bases)
+	virtual void start_sequence ( const std::string& sequence_id )
 	{
-		if ( !sequence_bases.empty() )
-			upstream->write ( sequence_id, sequence_bases ) ;
+		pending_sequence_id = sequence_id ;
+		started = false ;
+	}
+
+	virtual void write_bases ( const char* bases, size_t length )
+	{
+		if ( length == 0 )
+			return ;
+		if ( !started ) {
+			upstream->start_sequence ( pending_sequence_id ) ;
+			started = true ;
+		}
+		upstream->write_bases ( bases, length ) ;
+	}
+
+	virtual void end_sequence ()
+	{
+		if ( started )
+			upstream->end_sequence () ;
+		started = false ;
 	}
 };
 
 class SingleLineFastaWriter : public SequencesWriter
 {
 private:
-	std::ostream& ostrm ;
+	OutputBlockBuffer& output ;
+	bool has_bases ;
 public:
-	SingleLineFastaWriter ( std::ostream& output_stream ) : ostrm ( output_stream ) { }
+	SingleLineFastaWriter ( OutputBlockBuffer& _output ) : output ( _output ), has_bases(false) { }
+
+	virtual void start_sequence ( const std::string& sequence_id )
+	{
+		output.put ( sequence_id.data(), sequence_id.length() ) ;
+		output.put ( '\n' ) ;
+		has_bases = false ;
+	}
 
-	virtual void write ( const std::string & sequence_id, const std::string& sequence_bases )
+	virtual void write_bases ( const char* bases, size_t length )
 	{
-		ostrm << sequence_id << std::endl;
-		if ( !sequence_bases.empty() )
-			ostrm << sequence_bases << std::endl ;
+		output.put ( bases, length ) ;
+		has_bases |= ( length > 0 ) ;
+	}
+
+	virtual void end_sequence ()
+	{
+		if ( has_bases )
+			output.put ( '\n' ) ;
 	}
 };
 
 class MultiLineFastaWriter : public SequencesWriter
 {
 private:
-	std::ostream& ostrm ;
+	OutputBlockBuffer& output ;
 	size_t   max_width ;
+	size_t   column ;	// number of bases already written in the current line
 
 public:
-	MultiLineFastaWriter ( std::ostream& output_stream, size_t _max_width ) :
-		ostrm ( output_stream ), max_width ( _max_width ) 
+	MultiLineFastaWriter ( OutputBlockBuffer& _output, size_t _max_width ) :
+		output ( _output ), max_width ( _max_width ), column ( 0 )
 	{
 	}
 
-	virtual void write ( const std::string & sequence_id, const std::string& sequence_bases )
+	virtual void start_sequence ( const std::string& sequence_id )
 	{
-		ostrm << sequence_id << std::endl;
-		if ( !sequence_bases.empty() ) {
-			size_t start = 0 ;
-			while ( (sequence_bases.length() - start) >= max_width ) {
-				ostrm << sequence_bases.substr ( start, max_width ) << std::endl;
-				start += max_width ;
+		output.put ( sequence_id.data(), sequence_id.length() ) ;
+		output.put ( '\n' ) ;
+		column = 0 ;
+	}
+
+	virtual void write_bases ( const char* bases, size_t length )
+	{
+		while ( length > 0 ) {
+			size_t n = std::min ( length, max_width - column ) ;
+			output.put ( bases, n ) ;
+			bases += n ;
+			length -= n ;
+			column += n ;
+			if ( column == max_width ) {
+				output.put ( '\n' ) ;
+				column = 0 ;
 			}
-			if ( sequence_bases.length() - start > 0 )
-				ostrm << sequence_bases.substr ( start ) << std::endl ;
 		}
 	}
+
+	virtual void end_sequence ()
+	{
+		if ( column > 0 )
+			output.put ( '\n' ) ;
+		column = 0 ;
+	}
 };
 
 class TabulatedFastaWriter : public SequencesWriter
 {
 private:
-	std::ostream& ostrm ;
+	OutputBlockBuffer& output ;
+	bool has_bases ;
 public:
-	TabulatedFastaWriter ( std::ostream& output_stream ) : ostrm ( output_stream ) { }
+	TabulatedFastaWriter ( OutputBlockBuffer& _output ) : output ( _output ), has_bases(false) { }
 
-	virtual void write ( const std::string & sequence_id, const std::string& sequence_bases )
+	virtual void start_sequence ( const std::string& sequence_id )
 	{
-		ostrm << sequence_id.substr(1) ;
-		if ( !sequence_bases.empty() ) {
-			ostrm << "\t" ;
-			ostrm << sequence_bases ;
+		if ( !sequence_id.empty() )
+			output.put ( sequence_id.data()+1, sequence_id.length()-1 ) ;
+		has_bases = false ;
+	}
+
+	virtual void write_bases ( const char* bases, size_t length )
+	{
+		if ( length == 0 )
+			return ;
+		if ( !has_bases ) {
+			output.put ( '\t' ) ;
+			has_bases = true ;
 		}
-		ostrm << std::endl;
+		output.put ( bases, length ) ;
+	}
+
+	virtual void end_sequence ()
+	{
+		output.put ( '\n' ) ;
 	}
 };
 
-#endif
+/*
+ * Writes a samtools-compatible FASTA index (.fai) of the upstream writer's output.
+ *
+ * Each line of the index contains:
+ *   NAME  LENGTH  OFFSET  LINEBASES  LINEWIDTH
+ * (name is the sequence identifier up to the first white-space,
+ *  offset is the byte offset of the first nucleotide in the output file).
+ *
+ * Only valid for FASTA writers in which every line (but the last)
+ * of a sequence has the same length - Single/MultiLineFastaWriter.
+ */
+class FaiIndexWriter : public SequencesWriter
+{
+private:
+	SequencesWriter* upstream ;
+	const OutputBlockBuffer& output ;
+	std::ostream& index ;
+	size_t max_width ;	// zero = unlimited (single line)
+
+	std::string name ;
+	unsigned long long offset ;
+	unsigned long long length ;
+
+public:
+	FaiIndexWriter ( SequencesWriter* _upstream, const OutputBlockBuffer& _output,
+			std::ostream& _index, size_t _max_width ) :
+		upstream ( _upstream ), output ( _output ), index ( _index ),
+		max_width ( _max_width ), offset ( 0 ), length ( 0 )
+	{
+	}
+
+	~FaiIndexWriter()
+	{
+		delete upstream;
+	}
+
+	virtual void start_sequence ( const std::string& sequence_id )
+	{
+		size_t name_end = sequence_id.find_first_of ( " \t", 1 ) ;
+		if ( name_end == std::string::npos )
+			name_end = sequence_id.length();
+		name.assign ( sequence_id, 1, name_end - 1 ) ;
+
+		upstream->start_sequence ( sequence_id ) ;
+
+		offset = output.offset();
+		length = 0 ;
+	}
 
+	virtual void write_bases ( const char* bases, size_t _length )
+	{
+		upstream->write_bases ( bases, _length ) ;
+		length += _length ;
+	}
+
+	virtual void end_sequence ()
+	{
+		upstream->end_sequence ();
+
+		unsigned long long line_bases = length ;
+		if ( max_width > 0 && line_bases > max_width )
+			line_bases = max_width ;
+		unsigned long long line_width = ( line_bases > 0 ) ? line_bases + 1 : 0 ;
+
+		index << name << '\t' << length << '\t' << offset << '\t'
+		      << line_bases << '\t' << line_width << '\n' ;
+	}
+};
+
+#endif
@@ -41,6 +41,7 @@ const char* usage=
 "                  Otherwise, summary is printed to STDERR.\n" \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
 "   [-r]         = DNA-to-RNA mode - change T's into U's.\n" \
 "   [-d]         = RNA-to-DNA mode - change U's into T's.\n" \
 "\n";
@@ -92,6 +93,9 @@ int main(int argc, char* argv[])
 		nuc_to   = 'U';
 	}
 
+	//The output is FASTA - don't decode the quality scores
+	fastx_set_default_record_fields(0);
+
 	fastx_init_reader(&fastx, get_input_filename(), 
 		FASTA_OR_FASTQ, ALLOW_N | ALLOW_U, REQUIRE_UPPERCASE,
 		get_fastq_ascii_quality_offset() );
@@ -120,5 +124,7 @@ int main(int argc, char* argv[])
 		fprintf(get_report_file(), "Output: %zu reads.\n", num_output_reads(&fastx) ) ;
 		fprintf(get_report_file(), "Nucleotides changed: %zu\n", changes_count ) ;
 	}
+
+	fastx_report_timings();
 	return 0;
 }
@@ -37,8 +37,13 @@ const char* usage=
 "                  Default is 10.\n" \
 "   [-r C]       = Replace low-quality nucleotides with character C. Default is 'N'\n" \
 "   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
 "   [-i INFILE]  = FASTQ input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTQ output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
 "   [-v]         = Verbose - report number of sequences.\n" \
 "                  If [-o] is specified,  report will be printed to STDOUT.\n" \
 "                  If [-o] is not specified (and output goes to STDOUT),\n" \
@@ -119,5 +124,7 @@ int main(int argc, char* argv[])
 		fprintf(get_report_file(), "Masked nucleotides: %zu\n", masked_nucleotides_count ) ;
 	}
 
+	fastx_report_timings();
+
 	return 0;
 }
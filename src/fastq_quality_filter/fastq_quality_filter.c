@@ -27,152 +27,103 @@
 
 #include "fastx.h"
 #include "fastx_args.h"
+#include "fastx_stages.h"
 
 #define MAX_ADAPTER_LEN 100
 
 const char* usage=
-"usage: fastq_quality_filter [-h] [-v] [-q N] [-p N] [-z] [-i INFILE] [-o OUTFILE]\n" \
+"usage: fastq_quality_filter [-h] [-v] [-q N] [-p N] [-z] [-i INFILE] [-o OUTFILE] [-I INFILE2] [-O OUTFILE2] [-P]\n" \
 "Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
 "\n" \
 "   [-h]         = This helpful help screen.\n" \
 "   [-q N]       = Minimum quality score to keep.\n" \
 "   [-p N]       = Minimum percent of bases that must have [-q] quality.\n" \
 "   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
+"   [-I INFILE2] = Paired-end mode: FASTA/Q input file of the second mates.\n" \
+"                  Both mates are kept or discarded together.\n" \
+"   [-O OUTFILE2]= Paired-end mode: output file of the second mates.\n" \
+"   [-P]         = Paired-end mode: interleaved files - consecutive records are mates.\n" \
+"                  Without [-I], both mates are read from INFILE.\n" \
+"                  Without [-O], both mates are written to OUTFILE.\n" \
 "   [-v]         = Verbose - report number of sequences.\n" \
 "                  If [-o] is specified,  report will be printed to STDOUT.\n" \
 "                  If [-o] is not specified (and output goes to STDOUT),\n" \
 "                  report will be printed to STDERR.\n" \
 "\n";
 
-#define DO_NOT_TRIM_LAST_BASE (0)
-
-int min_quality=0;
-int min_percent=0;
+struct fastq_quality_filter_options options;
 
 FASTX fastx;
+FASTX mate2;
 
 int parse_program_args(int __attribute__((unused)) optind, int optc, char* optarg)
 {
-	switch(optc) {
-	case 'q':
-		if (optarg==NULL) 
-			errx(1, "[-q] parameter requires an argument value");
-		min_quality = strtoul(optarg,NULL,10);
-		break;
-
-	case 'p':
-		if (optarg==NULL) 
-			errx(1, "[-l] parameter requires an argument value");
-		min_percent = strtoul(optarg,NULL,10);
-		if (min_percent<=0 ||  min_percent>100) 
-			errx(1,"Invalid percent value (-p %s)", optarg);
-		break;
-	default:
+	if (!fastq_quality_filter_parse_option(&options, optc, optarg))
 		errx(1, __FILE__ ":%d: Unknown argument (%c)", __LINE__, optc ) ;
-	}
 	return 1;
 }
 
-int get_index_of_nth_element(int *array, int array_size, int n)
-{
-	int pos;
-
-	//Find the first nono-empty index
-	pos = 0 ;
-	while ( pos < array_size && array[pos]==0 )
-		pos++;
-
-	#if 0
-	fprintf(stderr,"n=%d\n", n);
-	for (i=0; i< array_size; i++) {
-		if (array[i] != 0)
-			fprintf(stderr, "[%d]=%d  ", i + MIN_QUALITY_VALUE, array[i]) ;
-	}
-	fprintf(stderr,"\n");
-	#endif
-	
-	if (pos == array_size)
-		errx(1,"bug: got empty array at %s:%d", __FILE__, __LINE__);
-	
-	while (n > 0) {
-		if (array[pos] > n)
-			break;
-		n -= array[pos];
-		pos++;
-		while (array[pos]==0 && pos < array_size)
-			pos++;
-	}
-	return pos;
-}
-
-int get_percentile_quality(const FASTX *fastx, int percentile)
-{
-	size_t i;
-	int count=0;
-	int quality_values[QUALITY_VALUES_RANGE];
-
-	memset(quality_values, 0, sizeof(quality_values));
-
-	for (i=0; i< strlen(fastx->nucleotides); i++) {
-		count++;
-		quality_values[ fastx->quality[i] - MIN_QUALITY_VALUE ] ++ ;
-	}
-
-	i = get_index_of_nth_element(quality_values, QUALITY_VALUES_RANGE, (count * (100-percentile) / 100));
-	
-	//printf(" n = %d, i = %d, i+MIN_QUAL_VALUE=%d\n", 
-	//	(count*(100-percentile)/100), i, i+MIN_QUALITY_VALUE) ;
-
-	return i + MIN_QUALITY_VALUE ;
-}
-
 int main(int argc, char* argv[])
 {
+	const char* reads_unit;
+
+	fastq_quality_filter_init_options(&options);
+	fastx_allow_paired_files();
 	fastx_parse_cmdline(argc, argv, "q:p:", parse_program_args);
 
-	fastx_init_reader(&fastx, get_input_filename(), 
-		FASTQ_ONLY, ALLOW_N, REQUIRE_UPPERCASE,
-		get_fastq_ascii_quality_offset() );
+	//The records are only filtered - kept records are copied as read
+	fastx_set_default_record_fields(FASTX_FIELD_QUALITY | FASTX_FIELD_RAW_RECORD);
 
-	fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
+	if ( paired_files_flag() ) {
+		fastx_init_paired_reader(&fastx, &mate2, get_input_filename(), get_input2_filename(),
+			FASTQ_ONLY, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
 
-	while ( fastx_read_next_record(&fastx) ) {
-		#if 0
-		fprintf(stderr, "%s\n", fastx.nucleotides ) ;
-		for (i=0; i<strlen(fastx.nucleotides); i++) {
-			fprintf(stderr,"%d ", fastx.quality[i]);
-		}
-		fprintf(stderr,"\n");
-		#endif
+		fastx_init_paired_writer(&fastx, &mate2, get_output_filename(), get_output2_filename(),
+			OUTPUT_SAME_AS_INPUT, compress_output_flag());
 
-		int value = get_percentile_quality(&fastx, min_percent);
+		while ( fastx_read_next_pair(&fastx, &mate2) ) {
+			if ( fastq_quality_filter_process(&fastx, &options)
+			     && fastq_quality_filter_process(&mate2, &options) )
+				fastx_write_pair(&fastx, &mate2);
+		}
+		reads_unit = "read pairs";
+	} else {
+		fastx_init_reader(&fastx, get_input_filename(), 
+			FASTQ_ONLY, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
 
-		//fprintf(stderr, "value = %d\n\n", value ) ;
-			
+		fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
 
-		if (value >= min_quality) {
-			fastx_write_record(&fastx);
-		} else {
-	//		fprintf(stderr, "%s\n", fastx.nucleotides ) ;
-	//		fprintf(stderr, "value = %d\n", value ) ;
+		while ( fastx_read_next_record(&fastx) ) {
+			if ( fastq_quality_filter_process(&fastx, &options) )
+				fastx_write_record(&fastx);
 		}
+		reads_unit = "reads";
 	}
 	
 	//
 	//Print verbose report
 	if ( verbose_flag() ) {
-		fprintf(get_report_file(), "Quality cut-off: %d\n", min_quality);
-		fprintf(get_report_file(), "Minimum percentage: %d\n", min_percent);
+		fprintf(get_report_file(), "Quality cut-off: %d\n", options.min_quality);
+		fprintf(get_report_file(), "Minimum percentage: %d\n", options.min_percent);
 
-		fprintf(get_report_file(), "Input: %zu reads.\n", num_input_reads(&fastx) ) ;
-		fprintf(get_report_file(), "Output: %zu reads.\n", num_output_reads(&fastx) ) ;
+		fprintf(get_report_file(), "Input: %zu %s.\n", num_input_reads(&fastx), reads_unit ) ;
+		fprintf(get_report_file(), "Output: %zu %s.\n", num_output_reads(&fastx), reads_unit ) ;
 
 		size_t discarded = num_input_reads(&fastx) - num_output_reads(&fastx) ;
-		fprintf(get_report_file(), "discarded %zu (%zu%%) low-quality reads.\n", 
-			discarded, (discarded*100)/( num_input_reads(&fastx) ) ) ;
+		fprintf(get_report_file(), "discarded %zu (%zu%%) low-quality %s.\n", 
+			discarded, (discarded*100)/( num_input_reads(&fastx) ), reads_unit ) ;
 	}	
 
+	fastx_report_timings();
+
 	return 0;
 }
@@ -27,9 +27,10 @@
 
 #include "fastx.h"
 #include "fastx_args.h"
+#include "fastx_stages.h"
 
 const char* usage=
-"usage: fastq_quality_trimmer [-h] [-v] [-t N] [-l N] [-z] [-i INFILE] [-o OUTFILE]\n" \
+"usage: fastq_quality_trimmer [-h] [-v] [-t N] [-l N] [-z] [-i INFILE] [-o OUTFILE] [-I INFILE2] [-O OUTFILE2] [-P]\n" \
 "Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
 "\n" \
 "   [-h]         = This helpful help screen.\n" \
@@ -38,87 +39,94 @@ const char* usage=
 "   [-l N]       = Minimum length - sequences shorter than this (after trimming)\n" \
 "                  will be discarded. Default = 0 = no minimum length. \n" \
 "   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
 "   [-i INFILE]  = FASTQ input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTQ output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
+"   [-I INFILE2] = Paired-end mode: FASTQ input file of the second mates.\n" \
+"                  Both mates are trimmed, and kept or discarded together.\n" \
+"   [-O OUTFILE2]= Paired-end mode: output file of the second mates.\n" \
+"   [-P]         = Paired-end mode: interleaved files - consecutive records are mates.\n" \
+"                  Without [-I], both mates are read from INFILE.\n" \
+"                  Without [-O], both mates are written to OUTFILE.\n" \
 "   [-v]         = Verbose - report number of sequences.\n" \
 "                  If [-o] is specified,  report will be printed to STDOUT.\n" \
 "                  If [-o] is not specified (and output goes to STDOUT),\n" \
 "                  report will be printed to STDERR.\n" \
 "\n";
 
-int min_quality_threshold=0;
-int min_length=0;
+struct fastq_quality_trimmer_options options;
 
 FASTX fastx;
+FASTX mate2;
 
 int parse_program_args(int __attribute__((unused)) optind, int optc, char* optarg)
 {
-	switch(optc) {
-	case 'l':
-		if (optarg==NULL) 
-			errx(1, "[-l] parameter requires an argument value");
-		min_length = strtoul(optarg,NULL,10);
-		if (min_length<0)
-			errx(1,"Invalid minimum length value (-l %s)", optarg);
-		break;
-
-	case 't':
-		if (optarg==NULL) 
-			errx(1, "[-t] parameter requires an argument value");
-		min_quality_threshold = strtol(optarg,NULL,10);
-		break;
-	default:
+	if (!fastq_quality_trimmer_parse_option(&options, optc, optarg))
 		errx(1, __FILE__ ":%d: Unknown argument (%c)", __LINE__, optc ) ;
-	}
 	return 1;
 }
 
 int main(int argc, char* argv[])
 {
-	int i ;
+	const char* reads_unit;
 
+	fastq_quality_trimmer_init_options(&options);
+	fastx_allow_paired_files();
 	fastx_parse_cmdline(argc, argv, "t:l:", parse_program_args);
 
-	if ( min_quality_threshold == 0 )
-		errx(1, "Missing minimum quality threshold value (-t)" ) ;
-
-	fastx_init_reader(&fastx, get_input_filename(), 
-		FASTQ_ONLY, ALLOW_N, REQUIRE_UPPERCASE,
-		get_fastq_ascii_quality_offset() );
+	fastq_quality_trimmer_validate_options(&options);
 
-	fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
+	if ( paired_files_flag() ) {
+		fastx_init_paired_reader(&fastx, &mate2, get_input_filename(), get_input2_filename(),
+			FASTQ_ONLY, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
 
-	while ( fastx_read_next_record(&fastx) ) {
+		fastx_init_paired_writer(&fastx, &mate2, get_output_filename(), get_output2_filename(),
+			OUTPUT_SAME_AS_INPUT, compress_output_flag());
 
-		//Scan each sequence - backwards
-		for ( i=(int)strlen(fastx.nucleotides)-1 ; i >=0 ; i-- ) {
-			if ( fastx.quality[i] < min_quality_threshold ) 
-				fastx.nucleotides[i] = 0 ;
-			else
-				break ;	
+		while ( fastx_read_next_pair(&fastx, &mate2) ) {
+			if ( fastq_quality_trimmer_process(&fastx, &options)
+			     && fastq_quality_trimmer_process(&mate2, &options) )
+				fastx_write_pair(&fastx, &mate2);
 		}
+		reads_unit = "read pairs";
+	} else {
+		fastx_init_reader(&fastx, get_input_filename(), 
+			FASTQ_ONLY, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
+
+		fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
 
-		if ( i>=0 && i+1 >= min_length )
-			fastx_write_record(&fastx);
+		while ( fastx_read_next_record(&fastx) ) {
+			if ( fastq_quality_trimmer_process(&fastx, &options) )
+				fastx_write_record(&fastx);
+		}
+		reads_unit = "reads";
 	}
 	
 	//
 	//Print verbose report
 	if ( verbose_flag() ) {
-		fprintf(get_report_file(), "Minimum Quality Threshold: %d\n", min_quality_threshold);
-		if ( min_length > 0 )
-			fprintf(get_report_file(), "Minimum Length: %d\n", min_length);
+		fprintf(get_report_file(), "Minimum Quality Threshold: %d\n", options.min_quality_threshold);
+		if ( options.min_length > 0 )
+			fprintf(get_report_file(), "Minimum Length: %d\n", options.min_length);
 		else
 			fprintf(get_report_file(), "No minimum Length\n");
 
 
-		fprintf(get_report_file(), "Input: %zu reads.\n", num_input_reads(&fastx) ) ;
-		fprintf(get_report_file(), "Output: %zu reads.\n", num_output_reads(&fastx) ) ;
+		fprintf(get_report_file(), "Input: %zu %s.\n", num_input_reads(&fastx), reads_unit ) ;
+		fprintf(get_report_file(), "Output: %zu %s.\n", num_output_reads(&fastx), reads_unit ) ;
 
 		size_t discarded = num_input_reads(&fastx) - num_output_reads(&fastx) ;
-		fprintf(get_report_file(), "discarded %zu (%zu%%) too-short reads.\n", 
-			discarded, (discarded*100)/( num_input_reads(&fastx) ) ) ;
+		fprintf(get_report_file(), "discarded %zu (%zu%%) too-short %s.\n", 
+			discarded, (discarded*100)/( num_input_reads(&fastx) ), reads_unit ) ;
 	}	
 
+	fastx_report_timings();
+
 	return 0;
 }
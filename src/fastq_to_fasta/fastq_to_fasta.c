@@ -26,6 +26,7 @@
 #include <config.h>
 
 #include "fastx.h"
+#include "fastx_context.h"
 #include "fastx_args.h"
 
 const char* usage=
@@ -43,9 +44,9 @@ const char* usage=
 "   [-z]         = Compress output with GZIP.\n" \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
 "\n";
 
-FASTX fastx;
 int flag_rename_seqid = 0;
 int flag_discard_N = 1 ;
 
@@ -68,36 +69,46 @@ int parse_program_args(int __attribute__((unused)) optind, int optc, char __attr
 
 int main(int argc, char* argv[])
 {
-	fastx_parse_cmdline(argc, argv, "rn", parse_program_args);
+	FASTX_CONTEXT *ctx;
+	FASTX *fastx;
 
-	fastx_init_reader(&fastx, get_input_filename(), 
-		FASTQ_ONLY, ALLOW_N, REQUIRE_UPPERCASE,
-		get_fastq_ascii_quality_offset() );
+	ctx = fastx_context_new();
+	ctx->usage = usage;
+	fastx_context_parse_cmdline(ctx, argc, argv, "rn", parse_program_args);
 
-	fastx_init_writer(&fastx, get_output_filename(), OUTPUT_FASTA, compress_output_flag());
+	//The quality scores aren't written - don't decode them
+	fastx_set_io_options_record_fields(&ctx->io_options, 0);
 
-	while ( fastx_read_next_record(&fastx) ) {
+	fastx = fastx_context_open_reader(ctx, ctx->input_filename,
+		FASTQ_ONLY, ALLOW_N, REQUIRE_UPPERCASE);
+
+	fastx_context_open_writer(ctx, fastx, ctx->output_filename, OUTPUT_FASTA);
+
+	while ( fastx_read_next_record(fastx) ) {
 		//See if the input sequence contained 'N' nucleotides
-		if ( flag_discard_N  && (strchr(fastx.nucleotides,'N') != NULL)) 
+		if ( flag_discard_N  && (strchr(fastx->nucleotides,'N') != NULL)) 
 				continue;
 
 		if ( flag_rename_seqid ) 
-			snprintf(fastx.name, sizeof(fastx.name), "%zu", num_output_reads(&fastx)+1) ;
+			snprintf(fastx->name, sizeof(fastx->name), "%zu", num_output_reads(fastx)+1) ;
 
-		fastx_write_record(&fastx);
+		fastx_write_record(fastx);
 	}
 
 	//Print verbose report
-	if ( verbose_flag() ) {
-		fprintf(get_report_file(), "Input: %zu reads.\n", num_input_reads(&fastx) ) ;
-		fprintf(get_report_file(), "Output: %zu reads.\n", num_output_reads(&fastx) ) ;
+	if ( ctx->verbose ) {
+		fprintf(ctx->report_file, "Input: %zu reads.\n", num_input_reads(fastx) ) ;
+		fprintf(ctx->report_file, "Output: %zu reads.\n", num_output_reads(fastx) ) ;
 
 		if ( flag_discard_N ) {
-			size_t discarded = num_input_reads(&fastx) - num_output_reads(&fastx) ;
-			fprintf(get_report_file(), "discarded %zu (%zu%%) low-quality reads.\n", 
-				discarded, (discarded*100)/( num_input_reads(&fastx) ) ) ;
+			size_t discarded = num_input_reads(fastx) - num_output_reads(fastx) ;
+			fprintf(ctx->report_file, "discarded %zu (%zu%%) low-quality reads.\n", 
+				discarded, (discarded*100)/( num_input_reads(fastx) ) ) ;
 		}
 	}	
 
+	fastx_context_report_timings(ctx);
+
+	fastx_context_free(ctx);
 	return 0;
 }
@@ -27,118 +27,95 @@
 
 #include "fastx.h"
 #include "fastx_args.h"
+#include "fastx_stages.h"
 
 #define MAX_ADAPTER_LEN 100
 
 const char* usage=
-"usage: fastx_artifacts_filter [-h] [-v] [-z] [-i INFILE] [-o OUTFILE]\n" \
+"usage: fastx_artifacts_filter [-h] [-v] [-z] [-i INFILE] [-o OUTFILE] [-I INFILE2] [-O OUTFILE2] [-P]\n" \
 "Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
 "\n" \
 "   [-h]         = This helpful help screen.\n" \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
+"   [-I INFILE2] = Paired-end mode: FASTA/Q input file of the second mates.\n" \
+"                  Both mates are kept or discarded together.\n" \
+"   [-O OUTFILE2]= Paired-end mode: output file of the second mates.\n" \
+"   [-P]         = Paired-end mode: interleaved files - consecutive records are mates.\n" \
+"                  Without [-I], both mates are read from INFILE.\n" \
+"                  Without [-O], both mates are written to OUTFILE.\n" \
 "   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
 "   [-v]         = Verbose - report number of processed reads.\n" \
 "                  If [-o] is specified,  report will be printed to STDOUT.\n" \
 "                  If [-o] is not specified (and output goes to STDOUT),\n" \
 "                  report will be printed to STDERR.\n" \
 "\n";
 
-#define DO_NOT_TRIM_LAST_BASE (0)
-
 FASTX fastx;
+FASTX mate2;
 
 int parse_commandline(int argc, char* argv[])
 {
+	fastx_allow_paired_files();
 	return fastx_parse_cmdline(argc, argv, "", NULL);
 }
 
-int artifact_sequence(const FASTX *fastx)
-{
-	int n_count=0;
-	int a_count=0;
-	int c_count=0;
-	int t_count=0;
-	int g_count=0;
-	int total_count=0;
-
-	int max_allowed_different_bases = 3 ;
-
-	int i=0;
-
-	while (1) {
-		if (fastx->nucleotides[i]==0)
-			break;
-
-		total_count++;
-		switch(fastx->nucleotides[i])
-		{
-		case 'A':
-			a_count++;
-			break;
-		case 'C':
-			c_count++;
-			break;
-		case 'G':
-			g_count++;
-			break;
-		case 'T':
-			t_count++;
-			break;
-		case 'N':
-			n_count++;
-			break;
-		default:
-			errx(1, __FILE__":%d: invalid nucleotide value (%c) at position %d",
-				__LINE__, fastx->nucleotides[i], i ) ;
-		}
-		i++;
-	}
-
-	//Rules for artifacts
-	
-	if ( a_count>=(total_count-max_allowed_different_bases) 
-	     ||
-	     c_count>=(total_count-max_allowed_different_bases)
-	     ||
-	     g_count>=(total_count-max_allowed_different_bases)
-	     ||
-	     t_count>=(total_count-max_allowed_different_bases)
-	     )
-	     return 1;
-	 
-
-	 return 0;
-}
-
 int main(int argc, char* argv[])
 {
+	const char* reads_unit;
+
 	parse_commandline(argc, argv);
 
-	fastx_init_reader(&fastx, get_input_filename(), 
-		FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE,
-		get_fastq_ascii_quality_offset() );
+	//Only the nucleotides are checked - kept records are copied as read
+	//(the quality scores are still decoded, to validate them)
+	fastx_set_default_record_fields(FASTX_FIELD_QUALITY | FASTX_FIELD_RAW_RECORD);
 
-	fastx_init_writer(&fastx, get_output_filename(), 
-		OUTPUT_SAME_AS_INPUT, compress_output_flag());
+	if ( paired_files_flag() ) {
+		fastx_init_paired_reader(&fastx, &mate2, get_input_filename(), get_input2_filename(),
+			FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
 
-	while ( fastx_read_next_record(&fastx) ) {
-		
-		if ( artifact_sequence(&fastx)  ) {
-		} else {
-			fastx_write_record(&fastx);
+		fastx_init_paired_writer(&fastx, &mate2, get_output_filename(), get_output2_filename(),
+			OUTPUT_SAME_AS_INPUT, compress_output_flag());
+
+		while ( fastx_read_next_pair(&fastx, &mate2) ) {
+			if ( fastx_artifacts_filter_process(&fastx)
+			     && fastx_artifacts_filter_process(&mate2) )
+				fastx_write_pair(&fastx, &mate2);
+		}
+		reads_unit = "read pairs";
+	} else {
+		fastx_init_reader(&fastx, get_input_filename(), 
+			FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
+
+		fastx_init_writer(&fastx, get_output_filename(), 
+			OUTPUT_SAME_AS_INPUT, compress_output_flag());
+
+		while ( fastx_read_next_record(&fastx) ) {
+			
+			if ( fastx_artifacts_filter_process(&fastx) )
+				fastx_write_record(&fastx);
 		}
+		reads_unit = "reads";
 	}
 	
 	//Print verbose report
 	if ( verbose_flag() ) {
-		fprintf(get_report_file(), "Input: %zu reads.\n", num_input_reads(&fastx) ) ;
-		fprintf(get_report_file(), "Output: %zu reads.\n", num_output_reads(&fastx) ) ;
+		fprintf(get_report_file(), "Input: %zu %s.\n", num_input_reads(&fastx), reads_unit ) ;
+		fprintf(get_report_file(), "Output: %zu %s.\n", num_output_reads(&fastx), reads_unit ) ;
 
 		size_t discarded = num_input_reads(&fastx) - num_output_reads(&fastx) ;
-		fprintf(get_report_file(), "discarded %zu (%zu%%) artifact reads.\n", 
-			discarded, (discarded*100)/( num_input_reads(&fastx) ) ) ;
+		fprintf(get_report_file(), "discarded %zu (%zu%%) artifact %s.\n", 
+			discarded, (discarded*100)/( num_input_reads(&fastx) ), reads_unit ) ;
 	}	
 
+	fastx_report_timings();
+
 	return 0;
 }
@@ -0,0 +1,675 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <err.h>
+#include <errno.h>
+#include <ctype.h>
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+#include <fstream>
+
+#include "config.h"
+
+#include "fastx.h"
+#include "fastx_sinks.h"
+
+using namespace std;
+
+const char* usage=
+"usage: fastx_barcode_splitter --bcfile FILE --prefix PREFIX [--suffix SUFFIX] [--bol|--eol]\n" \
+"         [--mismatches N] [--exact] [--partial N] [--gzip] [--quality-bins BINS]\n" \
+"         [--help] [--quiet] [--debug]\n" \
+"Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
+"\n" \
+"This program reads FASTA/FASTQ file and splits it into several smaller files,\n" \
+"Based on barcode matching.\n" \
+"FASTA/FASTQ data is read from STDIN (format is auto-detected.)\n" \
+"Any character in the sequences (e.g. '.' or IUPAC codes) is accepted, like in\n" \
+"fastx_barcode_splitter.pl - bases other than A/C/G/T never match a barcode base\n" \
+"(they count as mismatches).\n" \
+"Output files will be writen to disk.\n" \
+"Summary will be printed to STDOUT.\n" \
+"\n" \
+"   [--bcfile FILE]   = Barcodes file name. (see explanation below.)\n" \
+"   [--prefix PREFIX] = File prefix. will be added to the output files. Can be used\n" \
+"                       to specify output directories.\n" \
+"   [--suffix SUFFIX] = File suffix (optional). Can be used to specify file\n" \
+"                       extensions.\n" \
+"   [--bol]           = Try to match barcodes at the BEGINNING of sequences.\n" \
+"   [--eol]           = Try to match barcodes at the END of sequences.\n" \
+"                       NOTE: one of --bol, --eol must be specified, but not both.\n" \
+"   [--mismatches N]  = Max. number of mismatches allowed. default is 1.\n" \
+"   [--exact]         = Same as '--mismatches 0'. If both --exact and --mismatches\n" \
+"                       are specified, '--exact' takes precedence.\n" \
+"   [--partial N]     = Allow partial overlap of barcodes. (see explanation below.)\n" \
+"                       (Default is not partial matching)\n" \
+"   [--gzip]          = Compress the output files with GZIP (add '.gz' to the suffix).\n" \
+"   [--quality-bins BINS] = Bin the quality scores of the output files:\n" \
+"                       'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                       LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
+"   [--quiet]         = Don't print counts and summary at the end of the run.\n" \
+"   [--debug]         = Print lots of useless debug information to STDERR.\n" \
+"   [--help]          = This helpful help screen.\n" \
+"\n" \
+"Example (Assuming 's_2_100.txt' is a FASTQ file, 'mybarcodes.txt' is\n" \
+"the barcodes file):\n" \
+"\n" \
+"   $ cat s_2_100.txt | fastx_barcode_splitter --bcfile mybarcodes.txt --bol \\\n" \
+"        --mismatches 2 --prefix /tmp/bla_ --suffix \".txt\"\n" \
+"\n" \
+"Barcode file format\n" \
+"-------------------\n" \
+"Each line should contain an identifier (alphanumeric) and the barcode itself\n" \
+"(A/C/G/T), separated by white space. Lines starting with '#' are comments.\n" \
+"All barcodes must have the same length. Example:\n" \
+"\n" \
+"    #This line is a comment (starts with a 'number' sign)\n" \
+"    BC1 GATCT\n" \
+"    BC2 ATCGT\n" \
+"\n" \
+"For each barcode, a new file will be created (PREFIX + identifier + SUFFIX),\n" \
+"plus an 'unmatched' file for sequences that didn't match any barcode.\n" \
+"\n" \
+"Barcode matching\n" \
+"----------------\n" \
+"The barcode which matched with the lowest mismatches count (providing the\n" \
+"count is small or equal to '--mismatches N') 'gets' the sequence. If several\n" \
+"barcodes match with the same count, the first one in the barcode file wins\n" \
+"(such ambiguous barcodes are reported when the barcode file is loaded).\n" \
+"\n" \
+"With '--partial N', barcodes are also checked for partial overlap (up to N\n" \
+"bases of the barcode may be missing at the edge of the sequence). Each\n" \
+"missing base is scored as two mismatches (the missing barcode base, and the\n" \
+"sequence base which isn't covered by the barcode) - same as in\n" \
+"fastx_barcode_splitter.pl\n" \
+"\n";
+
+/*
+	Variants lookup table -
+	Every sequence fragment which matches a barcode within the allowed
+	number of mismatches is precomputed when the barcode file is loaded,
+	so each sequence requires a single hash lookup.
+
+	Fragments are encoded in base 5 (A,C,G,T and 'anything else', which
+	never matches a barcode base) - up to 27 bases fit in a 64-bit key.
+	Longer barcodes (or tables which would be too big) fall back to
+	comparing each sequence against all the barcodes.
+*/
+#define MAX_LOOKUP_BARCODE_LENGTH (27)
+#define MAX_LOOKUP_VARIANTS       (1<<21)
+#define VARIANT_SYMBOLS           (5)
+#define EMPTY_VARIANT_KEY         (UINT64_MAX)
+
+struct VariantSlot
+{
+	uint64_t key;
+	int ident;
+	int tied_ident;		// another barcode with the same mismatches count, or -1
+	int mismatches;
+};
+
+struct BarcodeEntry
+{
+	int ident;		// index into 'idents'
+	string sequence;	// shorter than 'barcodes_length' for partial-overlap entries
+
+	BarcodeEntry(int _ident, const string& _sequence) :
+		ident(_ident), sequence(_sequence) {}
+};
+
+// Command line options, same as fastx_barcode_splitter.pl
+const char* barcode_file = NULL;
+const char* newfile_prefix = NULL;
+const char* newfile_suffix = "";
+int barcodes_at_bol = 0;
+int barcodes_at_eol = 0;
+int exact_match = 0;
+int compress_output = 0;
+int quality_bins[QUALITY_BINS_TABLE_SIZE];
+int quiet = 0;
+int debug = 0;
+int allow_partial_overlap = 0;
+int allowed_mismatches = 1;
+
+vector<string> idents;			// unique barcode identifiers, the last one is 'unmatched'
+map<string,int> ident_index;
+vector<BarcodeEntry> barcodes;		// in the barcode file's order (partial entries follow their barcode)
+size_t barcodes_length = 0;
+int unmatched_ident = -1;
+
+bool use_lookup_table = false;
+vector<VariantSlot> variants_table;
+size_t variants_mask = 0;
+unsigned char nuc_to_symbol[256];
+
+FASTX_SINK_POOL *output_pool = NULL;	// one sink per barcode identifier
+vector<string> output_filenames;
+vector<size_t> counts;
+
+FASTX fastx;
+
+enum {
+	OPT_BCFILE = 1,
+	OPT_PREFIX,
+	OPT_SUFFIX,
+	OPT_BOL,
+	OPT_EOL,
+	OPT_EXACT,
+	OPT_GZIP,
+	OPT_QUALITY_BINS,
+	OPT_PARTIAL,
+	OPT_MISMATCHES,
+	OPT_QUIET,
+	OPT_DEBUG,
+	OPT_HELP
+};
+
+const struct option long_options[] = {
+	{ "bcfile",     required_argument, NULL, OPT_BCFILE },
+	{ "prefix",     required_argument, NULL, OPT_PREFIX },
+	{ "suffix",     required_argument, NULL, OPT_SUFFIX },
+	{ "bol",        no_argument,       NULL, OPT_BOL },
+	{ "eol",        no_argument,       NULL, OPT_EOL },
+	{ "exact",      no_argument,       NULL, OPT_EXACT },
+	{ "gzip",       no_argument,       NULL, OPT_GZIP },
+	{ "quality-bins", required_argument, NULL, OPT_QUALITY_BINS },
+	{ "partial",    required_argument, NULL, OPT_PARTIAL },
+	{ "mismatches", required_argument, NULL, OPT_MISMATCHES },
+	{ "quiet",      no_argument,       NULL, OPT_QUIET },
+	{ "debug",      no_argument,       NULL, OPT_DEBUG },
+	{ "help",       no_argument,       NULL, OPT_HELP },
+	{ NULL,         0,                 NULL, 0 }
+};
+
+int parse_integer_option(const char* name, const char* value)
+{
+	char *endptr;
+	long result;
+
+	errno = 0;
+	result = strtol(value, &endptr, 10);
+	if (errno!=0 || endptr==value || *endptr!=0 || result<INT_MIN || result>INT_MAX)
+		errx(1,"Value \"%s\" invalid for option %s (number expected)", value, name);
+	return (int)result;
+}
+
+void print_usage_and_exit()
+{
+	printf("%s", usage);
+	exit(1);
+}
+
+void parse_command_line(int argc, char* argv[])
+{
+	int opt;
+
+	if (argc<2)
+		print_usage_and_exit();
+
+	while ( (opt = getopt_long_only(argc, argv, "", long_options, NULL)) != -1 ) {
+		switch (opt) {
+		case OPT_BCFILE:
+			barcode_file = optarg;
+			break;
+		case OPT_PREFIX:
+			newfile_prefix = optarg;
+			break;
+		case OPT_SUFFIX:
+			newfile_suffix = optarg;
+			break;
+		case OPT_BOL:
+			barcodes_at_bol = 1;
+			break;
+		case OPT_EOL:
+			barcodes_at_eol = 1;
+			break;
+		case OPT_EXACT:
+			exact_match = 1;
+			break;
+		case OPT_GZIP:
+			compress_output = 1;
+			break;
+		case OPT_QUALITY_BINS:
+			fastx_parse_quality_bins(optarg, quality_bins);
+			fastx_set_default_quality_bins(quality_bins);
+			break;
+		case OPT_PARTIAL:
+			allow_partial_overlap = parse_integer_option("partial", optarg);
+			break;
+		case OPT_MISMATCHES:
+			allowed_mismatches = parse_integer_option("mismatches", optarg);
+			break;
+		case OPT_QUIET:
+			quiet = 1;
+			break;
+		case OPT_DEBUG:
+			debug = 1;
+			break;
+		case OPT_HELP:
+			print_usage_and_exit();
+			break;
+		default:
+			printf("use '--help' for usage information.\n");
+			exit(1);
+		}
+	}
+
+	if (barcode_file==NULL)
+		errx(1,"barcode file not specified (use '--bcfile [FILENAME]')");
+	if (newfile_prefix==NULL)
+		errx(1,"prefix path/filename not specified (use '--prefix [PATH]')");
+
+	if (barcodes_at_bol == barcodes_at_eol) {
+		if (barcodes_at_eol)
+			errx(1,"can't specify both --eol & --bol");
+		errx(1,"must specify either --eol or --bol");
+	}
+
+	if (allow_partial_overlap<0)
+		errx(1,"invalid for value partial matches (valid values are 0 or greater)");
+
+	if (exact_match)
+		allowed_mismatches = 0;
+
+	if (allowed_mismatches<0)
+		errx(1,"invalid value for mismatches (valid values are 0 or more)");
+
+	if (allow_partial_overlap > allowed_mismatches)
+		errx(1,"partial overlap value (%d) bigger than max. allowed mismatches (%d)",
+			allow_partial_overlap, allowed_mismatches);
+}
+
+int get_ident_index(const string& ident)
+{
+	map<string,int>::const_iterator it = ident_index.find(ident);
+	if (it != ident_index.end())
+		return it->second;
+
+	int index = (int)idents.size();
+	idents.push_back(ident);
+	ident_index[ident] = index;
+	return index;
+}
+
+bool is_valid_identifier(const string& ident)
+{
+	if (ident.empty())
+		return false;
+	for (size_t i=0; i<ident.length(); i++)
+		if ( ! (isalnum((unsigned char)ident[i]) || ident[i]=='_') )
+			return false;
+	return true;
+}
+
+void load_barcode_file(const char* filename)
+{
+	ifstream bcfile(filename);
+	string line;
+	size_t line_number = 0;
+
+	if (!bcfile)
+		errx(1,"failed to open barcode file (%s)", filename);
+
+	while (getline(bcfile, line)) {
+		line_number++;
+		if (!line.empty() && line[0]=='#')
+			continue;
+
+		//Split the line on white space, ignore any extra fields
+		const char* whitespace = " \t\r\n\f\v";
+		string fields[2];
+		size_t pos = 0;
+		for (int i=0; i<2; i++) {
+			size_t start = line.find_first_not_of(whitespace, pos);
+			if (start==string::npos)
+				break;
+			size_t end = line.find_first_of(whitespace, start);
+			if (end==string::npos)
+				end = line.length();
+			fields[i] = line.substr(start, end-start);
+			pos = end;
+		}
+		const string& ident = fields[0];
+		string barcode = fields[1];
+
+		for (size_t i=0; i<barcode.length(); i++)
+			barcode[i] = toupper((unsigned char)barcode[i]);
+
+		// Sanity checks on the barcodes
+		if (barcode.empty() || barcode.find_first_not_of("ACGT")!=string::npos)
+			errx(1,"bad barcode value (%s) at barcode file (%s) line %zu",
+				barcode.c_str(), filename, line_number);
+
+		if (!is_valid_identifier(ident))
+			errx(1,"bad identifier value (%s) at barcode file (%s) line %zu (must be alphanumeric)",
+				ident.c_str(), filename, line_number);
+
+		if (barcode.length() <= (size_t)allowed_mismatches)
+			errx(1,"barcode (%s, %s) is shorter or equal to maximum number of "
+			       "mismatches (%d). This makes no sense. Specify fewer mismatches.",
+			       ident.c_str(), barcode.c_str(), allowed_mismatches);
+
+		if (barcodes_length==0)
+			barcodes_length = barcode.length();
+		if (barcodes_length != barcode.length())
+			errx(1,"found barcodes in different lengths. this feature is not supported yet.");
+
+		int index = get_ident_index(ident);
+		barcodes.push_back(BarcodeEntry(index, barcode));
+
+		for (int i=0; i<allow_partial_overlap; i++) {
+			if (barcodes_at_bol)
+				barcode.erase(0, 1);
+			else
+				barcode.erase(barcode.length()-1, 1);
+			barcodes.push_back(BarcodeEntry(index, barcode));
+		}
+	}
+
+	//The dummy 'unmatched' barcode
+	unmatched_ident = get_ident_index("unmatched");
+
+	if (debug) {
+		fprintf(stderr, "barcode\tsequence\n");
+		for (size_t i=0; i<barcodes.size(); i++)
+			fprintf(stderr, "%s\t%s\n", idents[barcodes[i].ident].c_str(),
+					barcodes[i].sequence.c_str());
+	}
+}
+
+/*
+	Mismatch count, exactly as fastx_barcode_splitter.pl calculates it:
+	every base of the sequence fragment which isn't equal to the
+	corresponding barcode base is a mismatch, and every base missing
+	from a partial barcode is counted again.
+
+	NOTE: fragments can be shorter than the barcodes (for short sequences).
+*/
+int mismatch_count(const char* fragment, size_t fragment_length, const string& barcode)
+{
+	size_t overlap = min(fragment_length, barcode.length());
+	size_t matches = 0;
+
+	for (size_t i=0; i<overlap; i++)
+		if (fragment[i]==barcode[i])
+			matches++;
+
+	return (int)(fragment_length - matches + (barcodes_length - barcode.length()));
+}
+
+int match_all_barcodes(const char* fragment, size_t fragment_length)
+{
+	int best_mismatches = (int)barcodes_length;
+	int best_ident = -1;
+
+	for (size_t i=0; i<barcodes.size(); i++) {
+		int mm = mismatch_count(fragment, fragment_length, barcodes[i].sequence);
+		if (mm < best_mismatches) {
+			best_mismatches = mm;
+			best_ident = barcodes[i].ident;
+		}
+	}
+
+	if (best_ident==-1 || best_mismatches > allowed_mismatches)
+		return unmatched_ident;
+	return best_ident;
+}
+
+static inline size_t variant_hash(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return (size_t)key;
+}
+
+static inline VariantSlot& find_variant_slot(uint64_t key)
+{
+	size_t slot = variant_hash(key) & variants_mask;
+
+	while (variants_table[slot].key != EMPTY_VARIANT_KEY && variants_table[slot].key != key)
+		slot = (slot+1) & variants_mask;
+	return variants_table[slot];
+}
+
+void add_variant(uint64_t key, int ident, int mismatches)
+{
+	VariantSlot& slot = find_variant_slot(key);
+
+	if (slot.key == EMPTY_VARIANT_KEY || mismatches < slot.mismatches) {
+		slot.key = key;
+		slot.ident = ident;
+		slot.tied_ident = -1;
+		slot.mismatches = mismatches;
+		return;
+	}
+
+	//Barcodes are added in the file's order, so on a tie the first barcode keeps the fragment
+	if (mismatches == slot.mismatches && ident != slot.ident && slot.tied_ident == -1)
+		slot.tied_ident = ident;
+}
+
+/*
+	Add all the fragments (of length 'barcodes_length') which match 'entry'
+	with up to 'allowed_mismatches' mismatches.
+	Bases past the end of a partial barcode can be anything.
+*/
+void add_barcode_variants(const BarcodeEntry& entry, size_t pos, uint64_t key, int mismatches)
+{
+	if (pos == barcodes_length) {
+		add_variant(key, entry.ident, mismatches);
+		return;
+	}
+
+	if (pos >= entry.sequence.length()) {
+		for (unsigned int symbol=0; symbol<VARIANT_SYMBOLS; symbol++)
+			add_barcode_variants(entry, pos+1, key*VARIANT_SYMBOLS + symbol, mismatches);
+		return;
+	}
+
+	unsigned int barcode_symbol = nuc_to_symbol[(unsigned char)entry.sequence[pos]];
+	add_barcode_variants(entry, pos+1, key*VARIANT_SYMBOLS + barcode_symbol, mismatches);
+	if (mismatches < allowed_mismatches)
+		for (unsigned int symbol=0; symbol<VARIANT_SYMBOLS; symbol++)
+			if (symbol != barcode_symbol)
+				add_barcode_variants(entry, pos+1, key*VARIANT_SYMBOLS + symbol, mismatches+1);
+}
+
+// Number of variants add_barcode_variants() will generate for 'entry'
+double count_barcode_variants(const BarcodeEntry& entry)
+{
+	size_t length = entry.sequence.length();
+	int initial_mismatches = 2*(barcodes_length - length);
+	double total = 0 ;
+	double choose = 1;
+
+	if (initial_mismatches > allowed_mismatches)
+		return 0;
+
+	for (int mm=0; mm<=allowed_mismatches-initial_mismatches && (size_t)mm<=length; mm++) {
+		total += choose * pow(VARIANT_SYMBOLS-1, mm);
+		choose = choose * (length-mm) / (mm+1);
+	}
+	return total * pow(VARIANT_SYMBOLS, barcodes_length - length);
+}
+
+void report_ambiguous_barcodes()
+{
+	map< pair<int,int>, size_t > ambiguous;
+
+	for (size_t i=0; i<variants_table.size(); i++) {
+		const VariantSlot& slot = variants_table[i];
+		if (slot.key != EMPTY_VARIANT_KEY && slot.tied_ident != -1)
+			ambiguous[ make_pair(slot.ident, slot.tied_ident) ]++;
+	}
+
+	for (map< pair<int,int>, size_t >::const_iterator it = ambiguous.begin();
+			it != ambiguous.end(); ++it) {
+		const char* first = idents[it->first.first].c_str();
+		const char* second = idents[it->first.second].c_str();
+		warnx("warning: barcodes %s and %s are ambiguous: %zu possible barcode fragments "
+		      "match both with the same number of mismatches (reads with them will be "
+		      "assigned to %s)",
+		      first, second, it->second, first);
+	}
+}
+
+void build_variants_table()
+{
+	double total_variants = 0;
+	size_t capacity;
+
+	memset(nuc_to_symbol, VARIANT_SYMBOLS-1, sizeof(nuc_to_symbol));
+	nuc_to_symbol['A'] = 0 ;
+	nuc_to_symbol['C'] = 1 ;
+	nuc_to_symbol['G'] = 2 ;
+	nuc_to_symbol['T'] = 3 ;
+
+	for (size_t i=0; i<barcodes.size(); i++)
+		total_variants += count_barcode_variants(barcodes[i]);
+
+	if (barcodes_length > MAX_LOOKUP_BARCODE_LENGTH) {
+		if (debug)
+			fprintf(stderr, "Barcodes are longer than %d bases, comparing sequences against all barcodes\n",
+					MAX_LOOKUP_BARCODE_LENGTH);
+		return;
+	}
+	if (total_variants > MAX_LOOKUP_VARIANTS) {
+		if (debug)
+			fprintf(stderr, "Too many barcode variants (%.0f), comparing sequences against all barcodes\n",
+					total_variants);
+		return;
+	}
+
+	//keep the load factor below 1/2
+	capacity = 16;
+	while (capacity < total_variants*2)
+		capacity *= 2 ;
+
+	VariantSlot empty_slot = { EMPTY_VARIANT_KEY, -1, -1, 0 } ;
+	variants_table.assign(capacity, empty_slot);
+	variants_mask = capacity - 1 ;
+
+	for (size_t i=0; i<barcodes.size(); i++) {
+		int initial_mismatches = 2*(barcodes_length - barcodes[i].sequence.length());
+		if (initial_mismatches <= allowed_mismatches)
+			add_barcode_variants(barcodes[i], 0, 0, initial_mismatches);
+	}
+	use_lookup_table = true;
+
+	if (debug)
+		fprintf(stderr, "Barcode variants table: %.0f variants\n", total_variants);
+
+	if (!quiet)
+		report_ambiguous_barcodes();
+}
+
+int match_sequence(const char* sequence, size_t length)
+{
+	const char* fragment;
+
+	if (!use_lookup_table || length < barcodes_length)
+		return match_all_barcodes(barcodes_at_bol ? sequence : sequence + length - min(length, barcodes_length),
+				min(length, barcodes_length));
+
+	fragment = barcodes_at_bol ? sequence : sequence + length - barcodes_length;
+
+	uint64_t key = 0 ;
+	for (size_t i=0; i<barcodes_length; i++)
+		key = key*VARIANT_SYMBOLS + nuc_to_symbol[(unsigned char)fragment[i]];
+
+	const VariantSlot& slot = find_variant_slot(key);
+	if (slot.key == EMPTY_VARIANT_KEY)
+		return unmatched_ident;
+	return slot.ident;
+}
+
+/*
+	One output file for each barcode identifier (and one for 'unmatched').
+	The files are written through a sink pool, so splitting into hundreds
+	of files doesn't require hundreds of open descriptors.
+*/
+void create_output_files()
+{
+	fastx_set_output_type(&fastx, OUTPUT_SAME_AS_INPUT);
+
+	output_pool = fastx_sink_pool_new(0, 0);
+	for (size_t i=0; i<idents.size(); i++) {
+		string filename = string(newfile_prefix) + idents[i] + newfile_suffix;
+
+		fastx_sink_pool_add(output_pool, filename.c_str(), compress_output);
+		output_filenames.push_back(filename);
+	}
+	counts.assign(idents.size(), 0);
+}
+
+void print_results()
+{
+	map<string,int> sorted_idents(ident_index.begin(), ident_index.end());
+	size_t total = 0 ;
+
+	printf("Barcode\tCount\tLocation\n");
+	for (map<string,int>::const_iterator it = sorted_idents.begin(); it != sorted_idents.end(); ++it) {
+		printf("%s\t%zu\t%s\n", it->first.c_str(), counts[it->second],
+				output_filenames[it->second].c_str());
+		total += counts[it->second];
+	}
+	printf("total\t%zu\n", total);
+}
+
+int main(int argc, char* argv[])
+{
+	parse_command_line(argc, argv);
+
+	load_barcode_file(barcode_file);
+
+	build_variants_table();
+
+	//Only the sequences are matched - the quality scores are copied as read
+	fastx_set_default_record_fields(0);
+	fastx_init_reader(&fastx, "-",
+		FASTA_OR_FASTQ, ALLOW_ANY_BASE, ALLOW_LOWERCASE, 33);
+
+	create_output_files();
+
+	while ( fastx_read_next_record(&fastx) ) {
+		int ident = match_sequence(fastx.nucleotides, fastx.sequence_length);
+
+		if (debug)
+			fprintf(stderr, "sequence %s matched barcode: %s\n",
+				fastx.nucleotides, idents[ident].c_str());
+
+		counts[ident]++;
+		fastx_sink_write_record(output_pool, ident, &fastx);
+	}
+
+	fastx_sink_pool_close(output_pool);
+
+	if (!quiet)
+		print_results();
+
+	return 0;
+}
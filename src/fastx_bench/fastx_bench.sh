@@ -0,0 +1,89 @@
+#!/usr/bin/env bash
+
+#    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+#    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+#
+#   This program is free software: you can redistribute it and/or modify
+#   it under the terms of the GNU Affero General Public License as
+#   published by the Free Software Foundation, either version 3 of the
+#   License, or (at your option) any later version.
+#
+#   This program is distributed in the hope that it will be useful,
+#   but WITHOUT ANY WARRANTY; without even the implied warranty of
+#   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#   GNU Affero General Public License for more details.
+#
+#    You should have received a copy of the GNU Affero General Public License
+#    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#
+# Throughput benchmarks, run by 'make bench'.
+#
+# Generates synthetic FASTQ/FASTA files (with fastx_bench_generator),
+# runs the tools over them (with fastx_bench_run), and prints a
+# tab-separated table: name, reads, bytes, seconds, reads/s, MB/s, max. RSS (KB).
+#
+# Usage: fastx_bench.sh BINDIR [READS] [LENGTH]
+#   BINDIR - the build's 'src' directory (containing the tools' subdirectories).
+#
+# Extra generator options (e.g. "-a 0.5 -d 0.1 -q random") can be given
+# in the BENCH_GENERATOR_OPTIONS environment variable.
+#
+
+set -e
+
+BINDIR=$1
+READS=${2:-1000000}
+LENGTH=${3:-100}
+ADAPTER=CTGTAGGCACCATCAATCGTATGCCGTCTTCTGCTTG
+
+if [ -z "$BINDIR" ] || [ ! -d "$BINDIR" ]; then
+	echo "Usage: $0 BINDIR [READS] [LENGTH]" >&2
+	exit 1
+fi
+
+GENERATOR=$BINDIR/fastx_bench/fastx_bench_generator
+RUN=$BINDIR/fastx_bench/fastx_bench_run
+
+WORKDIR=$(mktemp -d "${TMPDIR:-/tmp}/fastx_bench.XXXXXX")
+trap 'rm -rf "$WORKDIR"' EXIT
+
+FASTQ=$WORKDIR/bench.fq
+FASTA=$WORKDIR/bench.fa
+BARCODES=$WORKDIR/barcodes.txt
+
+"$GENERATOR" -n "$READS" -l "$LENGTH" -A "$ADAPTER" $BENCH_GENERATOR_OPTIONS -o "$FASTQ"
+"$GENERATOR" -n "$READS" -l "$LENGTH" -A "$ADAPTER" $BENCH_GENERATOR_OPTIONS -f -o "$FASTA"
+printf "BC1\tACGTA\nBC2\tCGTAC\nBC3\tGTACG\nBC4\tTACGT\n" > "$BARCODES"
+
+# bench NAME INPUT PROGRAM [ARGS...]
+bench()
+{
+	NAME=$1
+	INPUT=$2
+	PROGRAM=$3
+	shift 3
+	"$RUN" -n "$NAME" -r "$READS" -i "$INPUT" -- "$BINDIR/$PROGRAM/$PROGRAM" "$@"
+}
+
+"$RUN" -H
+
+bench fastq_to_fasta           "$FASTQ" fastq_to_fasta
+bench fastx_quality_stats      "$FASTQ" fastx_quality_stats
+bench fastq_quality_filter     "$FASTQ" fastq_quality_filter -q 20 -p 80
+bench fastq_quality_trimmer    "$FASTQ" fastq_quality_trimmer -t 20 -l 20
+bench fastq_quality_converter  "$FASTQ" fastq_quality_converter -n
+bench fastq_masker             "$FASTQ" fastq_masker -q 10
+bench fastx_trimmer            "$FASTQ" fastx_trimmer -f 5 -l 80
+bench fastx_clipper            "$FASTQ" fastx_clipper -a "$ADAPTER" -l 15
+bench fastx_artifacts_filter   "$FASTQ" fastx_artifacts_filter
+bench fastx_reverse_complement "$FASTQ" fastx_reverse_complement
+bench fastx_length_histogram   "$FASTQ" fastx_length_histogram
+bench fastx_collapser          "$FASTQ" fastx_collapser
+bench fastx_store              "$FASTQ" fastx_store
+bench fastx_pipeline           "$FASTQ" fastx_pipeline -s trim:f=5 -s clip:a=$ADAPTER,l=15 -s qtrim:t=20,l=20 -s qfilter:q=20,p=80
+bench fastx_barcode_splitter   "$FASTQ" fastx_barcode_splitter --bcfile "$BARCODES" --bol --prefix "$WORKDIR/bc_"
+bench fasta_formatter          "$FASTA" fasta_formatter -w 60
+bench fasta_nucleotide_changer "$FASTA" fasta_nucleotide_changer -r
+bench fastx_renamer            "$FASTA" fastx_renamer -n COUNT
+bench fastx_collapser.fasta    "$FASTA" fastx_collapser
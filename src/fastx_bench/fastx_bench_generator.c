@@ -0,0 +1,301 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <err.h>
+
+#include <config.h>
+
+/*
+	Deterministic synthetic FASTA/FASTQ generator, for 'make bench'.
+	The same options (and seed) always produce the same file, on every platform
+	(uses its own random number generator, not rand() ).
+*/
+
+const char* usage=
+"usage: fastx_bench_generator [-h] [-n READS] [-l LENGTH] [-a RATE] [-A ADAPTER]\n" \
+"                             [-N RATE] [-q PROFILE] [-d RATE] [-s SEED] [-f] [-o OUTFILE]\n" \
+"Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
+"\n" \
+"   [-h]         = This helpful help screen.\n" \
+"   [-n READS]   = Number of reads. default is 1000000.\n" \
+"   [-l LENGTH]  = Read length. default is 100.\n" \
+"   [-a RATE]    = Fraction of reads containing the adapter (at a random position).\n" \
+"                  default is 0.3.\n" \
+"   [-A ADAPTER] = Adapter sequence. default is CTGTAGGCACCATCAATCGTATGCCGTCTTCTGCTTG.\n" \
+"   [-N RATE]    = Fraction of 'N' bases. default is 0.001.\n" \
+"   [-q PROFILE] = Quality scores profile:\n" \
+"                  illumina - high scores, decreasing along the read (default).\n" \
+"                  random   - uniformly distributed scores (2 to 40).\n" \
+"                  flat:Q   - all scores are Q.\n" \
+"   [-d RATE]    = Duplication level - fraction of reads which are copies of\n" \
+"                  a previous read. default is 0.2.\n" \
+"   [-s SEED]    = Random seed. default is 1.\n" \
+"   [-f]         = Write FASTA (default is FASTQ, with Phred+33 quality scores).\n" \
+"   [-o OUTFILE] = Output file. default is STDOUT.\n" \
+"\n";
+
+#define DUPLICATES_POOL_SIZE (4096)
+
+enum QUALITY_PROFILE {
+	QUALITY_ILLUMINA,
+	QUALITY_RANDOM,
+	QUALITY_FLAT
+};
+
+unsigned long long reads_count = 1000000 ;
+unsigned int read_length = 100 ;
+double adapter_rate = 0.3 ;
+const char* adapter = "CTGTAGGCACCATCAATCGTATGCCGTCTTCTGCTTG";
+double n_rate = 0.001 ;
+enum QUALITY_PROFILE quality_profile = QUALITY_ILLUMINA;
+int flat_quality = 30 ;
+double duplication_rate = 0.2 ;
+uint64_t random_state = 1 ;
+int write_fasta = 0 ;
+const char* output_filename = "-";
+
+/* xorshift64* */
+static uint64_t next_random()
+{
+	random_state ^= random_state >> 12;
+	random_state ^= random_state << 25;
+	random_state ^= random_state >> 27;
+	return random_state * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [0,1)
+static double random_fraction()
+{
+	return (next_random() >> 11) * (1.0/9007199254740992.0);
+}
+
+static unsigned int random_below(unsigned int limit)
+{
+	return (unsigned int)(random_fraction() * limit);
+}
+
+static double parse_rate(const char* option, const char* value)
+{
+	char *endptr;
+	double rate = strtod(value, &endptr);
+	if (endptr==value || *endptr!=0 || rate<0 || rate>1)
+		errx(1,"invalid rate (%s %s), expecting a value between 0 and 1", option, value);
+	return rate;
+}
+
+static unsigned long long parse_number(const char* option, const char* value)
+{
+	char *endptr;
+	unsigned long long number = strtoull(value, &endptr, 10);
+	if (endptr==value || *endptr!=0 || number==0)
+		errx(1,"invalid value (%s %s)", option, value);
+	return number;
+}
+
+void parse_command_line(int argc, char* argv[])
+{
+	int opt;
+
+	while ( (opt = getopt(argc, argv, "hn:l:a:A:N:q:d:s:fo:")) != -1 ) {
+		switch(opt) {
+		case 'h':
+			printf("%s", usage);
+			exit(1);
+
+		case 'n':
+			reads_count = parse_number("-n", optarg);
+			break;
+
+		case 'l':
+			read_length = (unsigned int)parse_number("-l", optarg);
+			if (read_length > 10000)
+				errx(1,"read length (-l %s) is too long", optarg);
+			break;
+
+		case 'a':
+			adapter_rate = parse_rate("-a", optarg);
+			break;
+
+		case 'A':
+			if (strlen(optarg)==0 || strspn(optarg,"ACGT")!=strlen(optarg))
+				errx(1,"invalid adapter (-A %s)", optarg);
+			adapter = optarg;
+			break;
+
+		case 'N':
+			n_rate = parse_rate("-N", optarg);
+			break;
+
+		case 'q':
+			if (strcmp(optarg,"illumina")==0)
+				quality_profile = QUALITY_ILLUMINA;
+			else if (strcmp(optarg,"random")==0)
+				quality_profile = QUALITY_RANDOM;
+			else if (strncmp(optarg,"flat:",5)==0) {
+				quality_profile = QUALITY_FLAT;
+				flat_quality = atoi(optarg+5);
+				if (flat_quality<0 || flat_quality>41)
+					errx(1,"invalid quality score (-q %s)", optarg);
+			} else
+				errx(1,"unknown quality profile (-q %s)", optarg);
+			break;
+
+		case 'd':
+			duplication_rate = parse_rate("-d", optarg);
+			break;
+
+		case 's':
+			random_state = parse_number("-s", optarg);
+			break;
+
+		case 'f':
+			write_fasta = 1 ;
+			break;
+
+		case 'o':
+			output_filename = optarg;
+			break;
+
+		default:
+			printf("use '-h' for usage information.\n");
+			exit(1);
+		}
+	}
+}
+
+static void generate_sequence(char *sequence)
+{
+	static const char bases[4] = { 'A', 'C', 'G', 'T' };
+	size_t adapter_length = strlen(adapter);
+	unsigned int i, position;
+
+	for (i=0; i<read_length; i++)
+		sequence[i] = bases[next_random() & 3];
+
+	if (random_fraction() < adapter_rate) {
+		position = random_below(read_length);
+		for (i=position; i<read_length && i-position<adapter_length; i++)
+			sequence[i] = adapter[i-position];
+	}
+
+	for (i=0; i<read_length; i++)
+		if (random_fraction() < n_rate)
+			sequence[i] = 'N';
+}
+
+static void generate_quality(const char *sequence, char *quality)
+{
+	unsigned int i;
+	double mean;
+	int q;
+
+	for (i=0; i<read_length; i++) {
+		switch (quality_profile) {
+		case QUALITY_ILLUMINA:
+			//From ~36 at the start of the read to ~26 at the end, with some noise,
+			//and an occasional low-quality base
+			mean = 36.0 - 10.0 * i / read_length ;
+			q = (int)(mean + (random_fraction()+random_fraction()+random_fraction()-1.5)*6.0);
+			if (random_fraction() < 0.02)
+				q = 2 + random_below(15);
+			break;
+
+		case QUALITY_RANDOM:
+			q = 2 + random_below(39);
+			break;
+
+		case QUALITY_FLAT:
+			q = flat_quality;
+			break;
+
+		default:
+			errx(1,"Internal error: unknown quality profile");
+		}
+
+		if (sequence[i]=='N')
+			q = 2 ;
+		if (q<2)
+			q = 2 ;
+		if (q>41)
+			q = 41 ;
+		quality[i] = (char)(q + 33);
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	FILE *output;
+	char *pool;
+	char *sequence;
+	char quality[10001];
+	unsigned long long read;
+	size_t pool_count = 0 ;
+
+	parse_command_line(argc, argv);
+
+	if (strcmp(output_filename,"-")==0)
+		output = stdout;
+	else {
+		output = fopen(output_filename, "w");
+		if (output==NULL)
+			err(1,"failed to create output file (%s)", output_filename);
+	}
+
+	pool = malloc((size_t)DUPLICATES_POOL_SIZE * read_length);
+	if (pool==NULL)
+		err(1,"failed to allocate sequences pool");
+
+	for (read=1; read<=reads_count; read++) {
+		if (pool_count>0 && random_fraction() < duplication_rate) {
+			sequence = pool + (size_t)random_below(pool_count) * read_length ;
+		} else {
+			//A new sequence (replacing a random one, once the pool is full)
+			if (pool_count < DUPLICATES_POOL_SIZE)
+				sequence = pool + (size_t)(pool_count++) * read_length ;
+			else
+				sequence = pool + (size_t)random_below(DUPLICATES_POOL_SIZE) * read_length ;
+			generate_sequence(sequence);
+		}
+
+		//Casava 1.8 identifiers: 100 tiles
+		if (write_fasta) {
+			fprintf(output, ">BENCH:1:FC:1:%llu:%llu:%llu 1:N:0:1\n",
+				1101 + read%100, read%20000, read/20000);
+			fwrite(sequence, 1, read_length, output);
+			fputc('\n', output);
+		} else {
+			generate_quality(sequence, quality);
+			fprintf(output, "@BENCH:1:FC:1:%llu:%llu:%llu 1:N:0:1\n",
+				1101 + read%100, read%20000, read/20000);
+			fwrite(sequence, 1, read_length, output);
+			fputs("\n+\n", output);
+			fwrite(quality, 1, read_length, output);
+			fputc('\n', output);
+		}
+	}
+
+	if (fclose(output)!=0)
+		err(1,"failed to write output file (%s)", output_filename);
+	free(pool);
+	return 0;
+}
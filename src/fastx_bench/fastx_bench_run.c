@@ -0,0 +1,163 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <err.h>
+#include <fcntl.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <config.h>
+
+const char* usage=
+"usage: fastx_bench_run [-h] [-H] [-n NAME] [-r READS] -i INFILE -- COMMAND [ARGS...]\n" \
+"Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
+"\n" \
+"Runs COMMAND with INFILE as its standard input (discarding its output),\n" \
+"and prints one line of a tab-separated table:\n" \
+"   name, reads, bytes, seconds, reads/s, MB/s, max. RSS (KB)\n" \
+"\n" \
+"   [-h]         = This helpful help screen.\n" \
+"   [-H]         = Print the table's header line (and exit, if no COMMAND is given).\n" \
+"   [-n NAME]    = Name of the benchmark. default is the COMMAND.\n" \
+"   [-r READS]   = Number of reads in INFILE (for reads/s). default is 0.\n" \
+"   [-i INFILE]  = Input file.\n" \
+"\n";
+
+const char* benchmark_name = NULL;
+const char* input_filename = NULL;
+unsigned long long reads_count = 0 ;
+int print_header = 0 ;
+
+void parse_command_line(int argc, char* argv[])
+{
+	int opt;
+	char *endptr;
+
+	while ( (opt = getopt(argc, argv, "hHn:r:i:")) != -1 ) {
+		switch(opt) {
+		case 'h':
+			printf("%s", usage);
+			exit(1);
+
+		case 'H':
+			print_header = 1 ;
+			break;
+
+		case 'n':
+			benchmark_name = optarg;
+			break;
+
+		case 'r':
+			reads_count = strtoull(optarg, &endptr, 10);
+			if (endptr==optarg || *endptr!=0)
+				errx(1,"invalid number of reads (-r %s)", optarg);
+			break;
+
+		case 'i':
+			input_filename = optarg;
+			break;
+
+		default:
+			printf("use '-h' for usage information.\n");
+			exit(1);
+		}
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	struct timespec start, end;
+	struct rusage usage_info;
+	struct stat st;
+	double seconds;
+	pid_t pid;
+	int status;
+	int fd;
+
+	parse_command_line(argc, argv);
+
+	if (print_header) {
+		printf("name\treads\tbytes\tseconds\treads_per_sec\tmb_per_sec\tmax_rss_kb\n");
+		fflush(stdout);
+		if (optind>=argc)
+			return 0;
+	}
+
+	if (optind>=argc)
+		errx(1,"missing COMMAND to run (use '-h' for usage information)");
+	if (input_filename==NULL)
+		errx(1,"missing input file (-i INFILE)");
+	if (benchmark_name==NULL)
+		benchmark_name = argv[optind];
+
+	if (stat(input_filename, &st)!=0)
+		err(1,"failed to stat input file (%s)", input_filename);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	pid = fork();
+	if (pid==-1)
+		err(1,"fork failed");
+	if (pid==0) {
+		fd = open(input_filename, O_RDONLY);
+		if (fd==-1)
+			err(1,"failed to open input file (%s)", input_filename);
+		dup2(fd, STDIN_FILENO);
+		close(fd);
+
+		fd = open("/dev/null", O_WRONLY);
+		if (fd==-1)
+			err(1,"failed to open /dev/null");
+		dup2(fd, STDOUT_FILENO);
+		close(fd);
+
+		execvp(argv[optind], &argv[optind]);
+		err(1,"failed to run '%s'", argv[optind]);
+	}
+
+	//wait4() reports the resource usage of this child only
+	if (wait4(pid, &status, 0, &usage_info)==-1)
+		err(1,"wait4 failed");
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status)!=0)
+		errx(1,"benchmark '%s' failed (%s %d)", benchmark_name,
+			WIFEXITED(status) ? "exit code" : "signal",
+			WIFEXITED(status) ? WEXITSTATUS(status) : WTERMSIG(status));
+
+	seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9 ;
+	if (seconds <= 0)
+		seconds = 1e-9 ;
+
+	//ru_maxrss is in kilobytes on Linux
+	printf("%s\t%llu\t%lld\t%.3f\t%.0f\t%.2f\t%ld\n",
+		benchmark_name, reads_count, (long long)st.st_size, seconds,
+		reads_count / seconds,
+		st.st_size / seconds / (1024.0*1024.0),
+		usage_info.ru_maxrss);
+
+	return 0;
+}
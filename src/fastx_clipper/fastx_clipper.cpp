@@ -26,8 +26,6 @@
 #include <stdio.h>
 #include <unistd.h>
 
-#include "sequence_alignment.h"
-
 #include <errno.h>
 #include <err.h>
 
@@ -35,12 +33,11 @@
 
 #include "fastx.h"
 #include "fastx_args.h"
+#include "clipper_stage.h"
 
 
-#define MAX_ADAPTER_LEN 100
-
 const char* usage=
-"usage: fastx_clipper [-h] [-a ADAPTER] [-D] [-l N] [-n] [-d N] [-c] [-C] [-o] [-v] [-z] [-i INFILE] [-o OUTFILE]\n" \
+"usage: fastx_clipper [-h] [-a ADAPTER] [-D] [-l N] [-n] [-d N] [-c] [-C] [-o] [-v] [-z] [-i INFILE] [-o OUTFILE] [-I INFILE2] [-O OUTFILE2] [-P]\n" \
 "Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
 "\n" \
 "   [-h]         = This helpful help screen.\n" \
@@ -57,25 +54,24 @@ const char* usage=
 "                  If [-o] is not specified (and output goes to STDOUT),\n" \
 "                  report will be printed to STDERR.\n" \
 "   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
 "   [-D]	 = DEBUG output.\n" \
 "   [-M N]       = require minimum adapter alignment length of N.\n" \
 "                  If less than N nucleotides aligned with the adapter - don't clip it." \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
+"   [-I INFILE2] = Paired-end mode: FASTA/Q input file of the second mates.\n" \
+"                  Both mates are clipped, and kept or discarded together.\n" \
+"   [-O OUTFILE2]= Paired-end mode: output file of the second mates.\n" \
+"   [-P]         = Paired-end mode: interleaved files - consecutive records are mates.\n" \
+"                  Without [-I], both mates are read from INFILE.\n" \
+"                  Without [-O], both mates are written to OUTFILE.\n" \
 "\n";
 
-//Default adapter - Dummy sequence
-char adapter[MAX_ADAPTER_LEN]="CCTTAAGG";
-unsigned int min_length=5;
-int discard_unknown_bases=1;
-int keep_delta=0;
-int discard_non_clipped=0;
-int discard_clipped=0;
-int show_adapter_only=0;
-int debug = 0 ;
-int minimum_adapter_length = 0;
-
-
 //Statistics for verbose report
 unsigned int count_input=0 ;
 unsigned int count_discarded_too_short=0; // see [-l N] option
@@ -85,266 +81,131 @@ unsigned int count_discarded_adapter_found=0; // see [-C] option
 unsigned int count_discarded_N=0; // see [-n]
 
 FASTX fastx;
-HalfLocalSequenceAlignment align;
+FASTX mate2;
+FastxClipper clipper;
 
 int parse_program_args(int __attribute__((unused)) optind, int optc, char* optarg)
 {
-	switch(optc) {
-		case 'M':
-			if (optarg==NULL) 
-				errx(1, "[-M] parameter requires an argument value");
-			minimum_adapter_length = atoi(optarg);
-			if (minimum_adapter_length<=0) 
-				errx(1,"Invalid minimum adapter length (-M %s)", optarg);
-			break;
-
-		case 'k':
-			show_adapter_only=1;
-			break;
-
-		case 'D':
-			debug++;
-			break ;
-
-		case 'c':
-			discard_non_clipped = 1;
-			break;
-
-		case 'C':
-			discard_clipped = 1 ;
-			break ;
-		case 'd':
-			if (optarg==NULL) 
-				errx(1, "[-d] parameter requires an argument value");
-			keep_delta = strtoul(optarg,NULL,10);
-			if (keep_delta<0) 
-				errx(1,"Invalid number bases to keep (-d %s)", optarg);
-			break;
-		case 'a':
-			strncpy(adapter,optarg,sizeof(adapter)-1);
-			//TODO:
-			//if (!valid_sequence_string(adapter)) 
-			//	errx(1,"Invalid adapter string (-a %s)", adapter);
-			break ;
-			
-		case 'l':
-			if (optarg==NULL) 
-				errx(1,"[-l] parameter requires an argument value");
-			
-			min_length = strtoul(optarg, NULL, 10);
-			break;
-			
-		case 'n':
-			discard_unknown_bases = 0 ;
-			break;
-
-		default:
-			errx(1,"Unknown argument (%c)", optc ) ;
-
-	}
+	if (!clipper.parse_option(optc, optarg))
+		errx(1,"Unknown argument (%c)", optc ) ;
 	return 1;
 }
 
 int parse_commandline(int argc, char* argv[])
 {
-
+	fastx_allow_paired_files();
 	fastx_parse_cmdline(argc, argv, "M:kDCcd:a:s:l:n", parse_program_args);
 
-	if (keep_delta>0) 
-		keep_delta += strlen(adapter);
+	clipper.finalize_options();
+
+	//Only the views are clipped - the quality lines (and records which
+	//weren't clipped) are copied as read. The quality scores are still
+	//decoded, to validate them.
+	//The debug output is written to STDOUT, too - keep it in order.
+	if (!clipper.options.debug)
+		fastx_set_default_record_fields(FASTX_FIELD_QUALITY | FASTX_FIELD_RAW_RECORD);
 	return 1;
 }
 
-int adapter_cutoff_index ( const SequenceAlignmentResults& alignment_results ) __attribute__ ((const));
-int adapter_cutoff_index ( const SequenceAlignmentResults& alignment_results )
-{
-	#if 0
-	int mismatches = alignment_results.mismatches ;
-	
-	//The adapter(=target) is expected to align from the first base.
-	//If the start is not zero (=not aligned from first base),
-	//count each skipped base as a mismatch
-	mismatches += alignment_results.target_start ;
-
-	//The adapter is expected to align up to the end
-	//of the adapter(=target), or the end of the query.
-	//If it doesn't, count the un-aligned bases as mismatches
-	int missing_from_query_end = (alignment_results.query_size - alignment_results.query_end-1);
-	int missing_from_target_end = (alignment_results.target_size - alignment_results.target_end-1);
-
-	int missing_from_end = std::min(missing_from_query_end, missing_from_target_end);
-	
-	mismatches += missing_from_end ;
-	
-
-	 
-	std::cout << "Missing from start = " << alignment_results.target_start
-		  << " Missing from end = " << missing_from_end
-		  << " mismatches = " << mismatches 
-		  << std::endl;
-	
-	if (mismatches > max_mismatches)
-		return -1;
-
-	return alignment_results.query_start;
-	#endif
-
-	int alignment_size = alignment_results.neutral_matches +
-			     alignment_results.matches + 
-			     alignment_results.mismatches +
-			     alignment_results.gaps ;
-
-	//No alignment at all?
-	if (alignment_size==0)
-		return -1;
-
-	if (minimum_adapter_length>0 && alignment_size<minimum_adapter_length)
-		return -1;
-
-	//Any good alignment at the end of the query
-	//(even only a single nucleotide)
-	//Example:
-	//  The adapter starts with CTGTAG, The Query ends with CT - it's a match.
-	if ( alignment_results.query_end == alignment_results.query_size-1
-	     &&
-	     alignment_results.mismatches == 0 ) {
-	     	//printf("--1\n");
-		return alignment_results.query_start ;
-	}
-
-	if ( alignment_size > 5
-	     &&
-	     alignment_results.target_start == 0
-	     &&
-	     (alignment_results.matches * 100 / alignment_size ) >= 75 ) {
-	     	//printf("--2\n");
-		return alignment_results.query_start ;
-	}
 
-	if ( alignment_size > 11 
-	     &&
-	     (alignment_results.matches * 100 / alignment_size ) >= 80 ) {
-	     	//printf("--2\n");
-		return alignment_results.query_start ;
+void count_result(CLIPPER_RESULT result, int reads_count)
+{
+	count_input+= reads_count;
+
+	switch (result) {
+	case CLIPPER_KEEP:
+		break;
+	case CLIPPER_ADAPTER_ONLY:
+		count_discarded_adapter_at_index_zero += reads_count;
+		break;
+	case CLIPPER_TOO_SHORT:
+		count_discarded_too_short += reads_count;
+		break;
+	case CLIPPER_NO_ADAPTER:
+		count_discarded_no_adapter_found += reads_count;
+		break;
+	case CLIPPER_ADAPTER_FOUND:
+		count_discarded_adapter_found += reads_count;
+		break;
+	case CLIPPER_UNKNOWN_BASES:
+		count_discarded_N += reads_count;
+		break;
+	default:
+		errx(1,"bug: unknown clipper result (%d)", (int)result);
 	}
-
-	//
-	//Be very lenient regarding alignments at the end of the query sequence
-	if ( alignment_results.query_end >= alignment_results.query_size-2
-	     &&
-	     alignment_size <= 5 && alignment_results.matches >= 3) {
-			//printf("--3\n");
-			return alignment_results.query_start ;
-		}
-
-	return -1;
 }
 
-
 int main(int argc, char* argv[])
 {
-	int i;
-	int reads_count;
+	CLIPPER_RESULT result, result2;
+	const char* reads_unit;
 
 	parse_commandline(argc, argv);
 
-	fastx_init_reader(&fastx, get_input_filename(), 
-		FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE,
-		get_fastq_ascii_quality_offset() );
+	if ( paired_files_flag() ) {
+		fastx_init_paired_reader(&fastx, &mate2, get_input_filename(), get_input2_filename(),
+			FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
 
-	fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
+		fastx_init_paired_writer(&fastx, &mate2, get_output_filename(), get_output2_filename(),
+			OUTPUT_SAME_AS_INPUT, compress_output_flag());
 
-	while ( fastx_read_next_record(&fastx) ) {
+		while ( fastx_read_next_pair(&fastx, &mate2) ) {
+			result = clipper.process(&fastx);
+			result2 = clipper.process(&mate2);
 
-		reads_count = get_reads_count(&fastx);
-		
-		#if 0
-		std::string query = std::string(fastx.nucleotides) + std::string( strlen(adapter), 'N' ); 
-		std::string target= std::string( strlen(fastx.nucleotides), 'N' ) + std::string(adapter);
-		#else
-		std::string query = std::string(fastx.nucleotides) ;
-		std::string target= std::string(adapter);
-		#endif
-		
-		
-		align.align( query, target ) ;
-
-		if (debug>1) 
-			align.print_matrix();
-		if (debug>0)
-			align.results().print();
-		
-		count_input+= reads_count;
+			//A discarded pair is counted once, by the reason of the first discarded mate
+			count_result( (result!=CLIPPER_KEEP) ? result : result2, get_reads_count(&fastx) );
 
-		//Find the best match with the adapter
-		i = adapter_cutoff_index ( align.results() ) ;
-		
-		if (i!=-1 && i>0) {
-			i += keep_delta;
-			//Just trim the string after this position
-			fastx.nucleotides[i] = 0 ;
+			if (clipper.keep(result) && clipper.keep(result2))
+				fastx_write_pair(&fastx, &mate2);
 		}
+		reads_unit = "read pairs";
+	} else {
+		fastx_init_reader(&fastx, get_input_filename(), 
+			FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
 
-		if (i==0) { // empty sequence ? (in which the adapter was found at index 0)
-			count_discarded_adapter_at_index_zero += reads_count;
-			
-			if (show_adapter_only)
-				fastx_write_record(&fastx);
-			continue;
-		}
+		fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
 
-		if (strlen(fastx.nucleotides) < min_length) { // too-short sequence ?
-			count_discarded_too_short += reads_count;
-			continue;
-		}
+		while ( fastx_read_next_record(&fastx) ) {
+			result = clipper.process(&fastx);
+			count_result( result, get_reads_count(&fastx) );
 
-		if ( (i==-1) && discard_non_clipped ) { // adapter not found (i.e. sequence was not clipped) ?
-			count_discarded_no_adapter_found += reads_count;
-			continue ;
-		}
-
-		if ( (i>0) && discard_clipped ) { // adapter found, and user requested to keep only non-clipped sequences 
-			count_discarded_adapter_found += reads_count;
-			continue;
-		}
-
-		if ( (discard_unknown_bases && strchr(fastx.nucleotides,'N')!=NULL ) ) { // contains unknown bases (after clipping) ?
-			count_discarded_N += reads_count;
-			continue;
-		}
-		
-		if (!show_adapter_only)  {
-			//none of the above condition matched, so print this sequence.
-			fastx_write_record(&fastx);
+			if (clipper.keep(result))
+				fastx_write_record(&fastx);
 		}
+		reads_unit = "reads";
 	}
 
 	//
 	//Print verbose report
 	if ( verbose_flag() ) {
-		fprintf(get_report_file(), "Clipping Adapter: %s\n", adapter );
-		fprintf(get_report_file(), "Min. Length: %d\n", min_length) ;
+		fprintf(get_report_file(), "Clipping Adapter: %s\n", clipper.options.adapter );
+		fprintf(get_report_file(), "Min. Length: %d\n", clipper.options.min_length) ;
 
-		if (discard_clipped)
+		if (clipper.options.discard_clipped)
 			fprintf(get_report_file(), "Clipped reads - discarded.\n"  ) ;
-		if (discard_non_clipped)
+		if (clipper.options.discard_non_clipped)
 			fprintf(get_report_file(), "Non-Clipped reads - discarded.\n"  ) ;
 
 		
-		fprintf(get_report_file(), "Input: %u reads.\n", count_input ) ;
-		fprintf(get_report_file(), "Output: %u reads.\n", 
+		fprintf(get_report_file(), "Input: %u %s.\n", count_input, reads_unit ) ;
+		fprintf(get_report_file(), "Output: %u %s.\n", 
 			count_input - count_discarded_too_short - count_discarded_no_adapter_found - count_discarded_adapter_found -
-			count_discarded_N - count_discarded_adapter_at_index_zero ) ;
-
-		fprintf(get_report_file(), "discarded %u too-short reads.\n", count_discarded_too_short ) ;
-		fprintf(get_report_file(), "discarded %u adapter-only reads.\n", count_discarded_adapter_at_index_zero );
-		if (discard_non_clipped)
-			fprintf(get_report_file(), "discarded %u non-clipped reads.\n", count_discarded_no_adapter_found );
-		if (discard_clipped)
-			fprintf(get_report_file(), "discarded %u clipped reads.\n", count_discarded_adapter_found );
-		if (discard_unknown_bases)
-			fprintf(get_report_file(), "discarded %u N reads.\n", count_discarded_N );
+			count_discarded_N - count_discarded_adapter_at_index_zero, reads_unit ) ;
+
+		fprintf(get_report_file(), "discarded %u too-short %s.\n", count_discarded_too_short, reads_unit ) ;
+		fprintf(get_report_file(), "discarded %u adapter-only %s.\n", count_discarded_adapter_at_index_zero, reads_unit );
+		if (clipper.options.discard_non_clipped)
+			fprintf(get_report_file(), "discarded %u non-clipped %s.\n", count_discarded_no_adapter_found, reads_unit );
+		if (clipper.options.discard_clipped)
+			fprintf(get_report_file(), "discarded %u clipped %s.\n", count_discarded_adapter_found, reads_unit );
+		if (clipper.options.discard_unknown_bases)
+			fprintf(get_report_file(), "discarded %u N %s.\n", count_discarded_N, reads_unit );
 	}
 
+	fastx_report_timings();
+
 	return 0;
 }
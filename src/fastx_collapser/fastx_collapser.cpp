@@ -44,6 +44,7 @@ const char* usage=
 "   [-v]         = verbose: print short summary of input/output counts\n" \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_INPUT_OPTIONS_USAGE \
 "\n";
 
 FASTX fastx;
@@ -96,6 +97,9 @@ int main(int argc, char* argv[])
 
 	fastx_parse_cmdline(argc, argv, "", NULL );
 
+	//Only the sequences are collapsed - don't decode the quality scores
+	fastx_set_default_record_fields(0);
+
 	fastx_init_reader(&fastx, get_input_filename(), 
 		FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE,
 		get_fastq_ascii_quality_offset() );
@@ -134,5 +138,7 @@ int main(int argc, char* argv[])
 		fprintf(get_report_file(), "Output: %zu sequences (representing %zu reads)\n",
 				stats.counter, stats.total_reads);
 	}
+
+	fastx_report_timings();
 	return 0;
 }
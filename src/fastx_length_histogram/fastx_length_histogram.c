@@ -0,0 +1,91 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <err.h>
+
+#include <config.h>
+
+#include "fastx.h"
+#include "fastx_args.h"
+
+const char* usage=
+"usage: fastx_length_histogram [-h] [-v] [-i INFILE] [-o OUTFILE]\n" \
+"Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
+"\n" \
+"   [-h]         = This helpful help screen.\n" \
+"   [-v]         = Verbose - report number of sequences.\n" \
+"                  If [-o] is specified,  report will be printed to STDOUT.\n" \
+"                  If [-o] is not specified (and output goes to STDOUT),\n" \
+"                  report will be printed to STDERR.\n" \
+"   [-i INFILE]  = FASTA/Q input file (can be GZIPped). default is STDIN.\n" \
+"   [-o OUTFILE] = Output file. default is STDOUT.\n" \
+FASTX_COMMON_INPUT_OPTIONS_USAGE \
+"\n" \
+"Prints a table of sequence lengths, and the number of reads with each length.\n" \
+"Collapsed FASTA sequences (e.g. '>1-1500', see fastx_collapser) are counted\n" \
+"with their number of reads.\n" \
+"\n";
+
+FASTX fastx;
+
+// Number of reads per sequence length
+uint64_t length_counts[MAX_SEQ_LINE_LENGTH+1];
+
+int main(int argc, char* argv[])
+{
+	FILE* output;
+	size_t length;
+
+	fastx_parse_cmdline(argc, argv, "", NULL);
+
+	fastx_init_reader(&fastx, get_input_filename(),
+		FASTA_OR_FASTQ, ALLOW_N, ALLOW_LOWERCASE, get_fastq_ascii_quality_offset() );
+
+	while ( fastx_read_next_record(&fastx) )
+		length_counts[fastx.sequence_length] += get_reads_count(&fastx);
+
+	if (strcmp(get_output_filename(),"-")==0) {
+		output = stdout;
+	} else {
+		output = fopen(get_output_filename(), "w");
+		if (output==NULL)
+			err(1,"failed to create output file (%s)", get_output_filename());
+	}
+
+	fprintf(output, "Length\tCount\n");
+	for (length=0; length<=MAX_SEQ_LINE_LENGTH; length++)
+		if (length_counts[length]>0)
+			fprintf(output, "%zu\t%llu\n", length, (unsigned long long)length_counts[length]);
+
+	if (fclose(output)!=0)
+		err(1,"failed to write output file (%s)", get_output_filename());
+
+	if ( verbose_flag() ) {
+		fprintf(get_report_file(), "Input: %zu sequences (representing %zu reads)\n",
+				num_input_sequences(&fastx), num_input_reads(&fastx));
+	}
+
+	fastx_report_timings();
+	return 0;
+}
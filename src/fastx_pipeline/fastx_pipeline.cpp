@@ -0,0 +1,326 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <cstddef>
+#include <cstdlib>
+#include <ostream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+
+#include <errno.h>
+#include <err.h>
+
+#include <config.h>
+
+#include "fastx.h"
+#include "fastx_args.h"
+#include "fastx_stages.h"
+#include "clipper_stage.h"
+
+const char* usage=
+"usage: fastx_pipeline [-h] [-v] [-z] [-s STAGE] [-s STAGE ...] [-i INFILE] [-o OUTFILE] [-I INFILE2] [-O OUTFILE2] [-P]\n" \
+"Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
+"\n" \
+"   [-h]         = This helpful help screen.\n" \
+"   [-s STAGE]   = Add a processing stage. Stages are applied in the order\n" \
+"                  they are given, as if the programs were piped together.\n" \
+"                  STAGE is NAME or NAME:OPTIONS, where OPTIONS is a\n" \
+"                  comma-separated list of the program's option letters\n" \
+"                  (with '=VALUE' for options which require a value).\n" \
+"                  Available stages:\n" \
+"                    trim      = fastx_trimmer          (f,l,t,m)\n" \
+"                    clip      = fastx_clipper          (a,l,d,c,C,k,n,M,D)\n" \
+"                    qtrim     = fastq_quality_trimmer  (t,l)\n" \
+"                    qfilter   = fastq_quality_filter   (q,p)\n" \
+"                    artifacts = fastx_artifacts_filter\n" \
+"                  The full program names can also be used.\n" \
+"   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
+"   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
+"   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
+"   [-I INFILE2] = Paired-end mode: FASTA/Q input file of the second mates.\n" \
+"                  Both mates go through all the stages, and are kept\n" \
+"                  or discarded together.\n" \
+"   [-O OUTFILE2]= Paired-end mode: output file of the second mates.\n" \
+"   [-P]         = Paired-end mode: interleaved files - consecutive records are mates.\n" \
+"                  Without [-I], both mates are read from INFILE.\n" \
+"                  Without [-O], both mates are written to OUTFILE.\n" \
+"   [-v]         = Verbose - report number of reads in each stage.\n" \
+"                  If [-o] is specified,  report will be printed to STDOUT.\n" \
+"                  If [-o] is not specified (and output goes to STDOUT),\n" \
+"                  report will be printed to STDERR.\n" \
+"\n" \
+"Example:\n" \
+"   fastx_pipeline -s trim:f=2,l=40 -s clip:a=CTGTAGGCACCATCAAT,l=15 \\\n" \
+"                  -s qtrim:t=20,l=15 -s qfilter:q=20,p=80 -s artifacts\n" \
+"\n" \
+"   produces exactly the same output as:\n" \
+"\n" \
+"   fastx_trimmer -f 2 -l 40 | fastx_clipper -a CTGTAGGCACCATCAAT -l 15 |\n" \
+"        fastq_quality_trimmer -t 20 -l 15 | fastq_quality_filter -q 20 -p 80 |\n" \
+"        fastx_artifacts_filter\n" \
+"\n";
+
+/*
+	A processing stage - wraps the record logic of one of the
+	stand-alone programs (see fastx_stages.h, clipper_stage.h).
+*/
+class PipelineStage
+{
+public:
+	std::string name;
+	size_t input_reads;
+	size_t output_reads;
+
+	PipelineStage(const std::string& _name) : name(_name), input_reads(0), output_reads(0) {}
+	virtual ~PipelineStage() {}
+
+	// returns 0 for unknown options
+	virtual int parse_option(int optc, const char* optarg) = 0;
+	virtual void validate_options() {}
+	virtual bool requires_fastq() const { return false; }
+
+	// returns true if the record should be passed on to the next stage
+	virtual bool process(FASTX *pFASTX) = 0;
+};
+
+class TrimmerStage : public PipelineStage
+{
+	struct fastx_trimmer_options options;
+public:
+	TrimmerStage() : PipelineStage("fastx_trimmer") { fastx_trimmer_init_options(&options); }
+	virtual int parse_option(int optc, const char* optarg) { return fastx_trimmer_parse_option(&options, optc, optarg); }
+	virtual void validate_options() { fastx_trimmer_validate_options(&options); }
+	virtual bool process(FASTX *pFASTX) { return fastx_trimmer_process(pFASTX, &options); }
+};
+
+class ClipperStage : public PipelineStage
+{
+	FastxClipper clipper;
+public:
+	ClipperStage() : PipelineStage("fastx_clipper") {}
+	virtual int parse_option(int optc, const char* optarg) { return clipper.parse_option(optc, optarg); }
+	virtual void validate_options() { clipper.finalize_options(); }
+	virtual bool process(FASTX *pFASTX) { return clipper.keep(clipper.process(pFASTX)); }
+};
+
+class QualityTrimmerStage : public PipelineStage
+{
+	struct fastq_quality_trimmer_options options;
+public:
+	QualityTrimmerStage() : PipelineStage("fastq_quality_trimmer") { fastq_quality_trimmer_init_options(&options); }
+	virtual int parse_option(int optc, const char* optarg) { return fastq_quality_trimmer_parse_option(&options, optc, optarg); }
+	virtual void validate_options() { fastq_quality_trimmer_validate_options(&options); }
+	virtual bool requires_fastq() const { return true; }
+	virtual bool process(FASTX *pFASTX) { return fastq_quality_trimmer_process(pFASTX, &options); }
+};
+
+class QualityFilterStage : public PipelineStage
+{
+	struct fastq_quality_filter_options options;
+public:
+	QualityFilterStage() : PipelineStage("fastq_quality_filter") { fastq_quality_filter_init_options(&options); }
+	virtual int parse_option(int optc, const char* optarg) { return fastq_quality_filter_parse_option(&options, optc, optarg); }
+	virtual bool requires_fastq() const { return true; }
+	virtual bool process(FASTX *pFASTX) { return fastq_quality_filter_process(pFASTX, &options); }
+};
+
+class ArtifactsFilterStage : public PipelineStage
+{
+public:
+	ArtifactsFilterStage() : PipelineStage("fastx_artifacts_filter") {}
+	virtual int parse_option(int, const char*) { return 0; }
+	virtual bool process(FASTX *pFASTX) { return fastx_artifacts_filter_process(pFASTX); }
+};
+
+std::vector<PipelineStage*> stages;
+
+FASTX fastx;
+FASTX mate2;
+
+PipelineStage* create_stage(const std::string& name)
+{
+	if (name=="trim" || name=="fastx_trimmer")
+		return new TrimmerStage();
+	if (name=="clip" || name=="fastx_clipper")
+		return new ClipperStage();
+	if (name=="qtrim" || name=="fastq_quality_trimmer")
+		return new QualityTrimmerStage();
+	if (name=="qfilter" || name=="fastq_quality_filter")
+		return new QualityFilterStage();
+	if (name=="artifacts" || name=="fastx_artifacts_filter")
+		return new ArtifactsFilterStage();
+
+	errx(1,"Unknown stage '%s' (see -h for the list of available stages)", name.c_str());
+	return NULL;
+}
+
+/*
+	Run the record (or both mates) through all the stages.
+	Returns true if it passed all of them.
+*/
+bool run_stages(FASTX *pFASTX, FASTX *pMate2)
+{
+	int reads_count = get_reads_count(pFASTX);
+	size_t i;
+
+	bool keep, keep2;
+
+	for (i=0; i<stages.size(); i++) {
+		stages[i]->input_reads += reads_count;
+
+		//Always process both mates, as the stand-alone programs do:
+		//the clipper's results depend on the previously aligned sequences.
+		keep = stages[i]->process(pFASTX);
+		keep2 = (pMate2 == NULL) || stages[i]->process(pMate2);
+		if (!keep || !keep2)
+			return false;
+
+		stages[i]->output_reads += reads_count;
+	}
+	return true;
+}
+
+/*
+	Parse a stage specification: NAME[:OPT[=VALUE][,OPT[=VALUE]...]]
+*/
+PipelineStage* parse_stage(const char* spec)
+{
+	std::string str(spec);
+	std::string options;
+	size_t colon = str.find(':');
+
+	PipelineStage *stage = create_stage(str.substr(0, colon));
+	if (colon == std::string::npos)
+		return stage;
+
+	options = str.substr(colon+1);
+	size_t pos = 0 ;
+	while (pos <= options.length()) {
+		size_t comma = options.find(',', pos);
+		if (comma == std::string::npos)
+			comma = options.length();
+		std::string option = options.substr(pos, comma-pos);
+		pos = comma + 1;
+
+		if (option.empty())
+			continue;
+
+		size_t equal = option.find('=');
+		std::string letter = option.substr(0, equal);
+		if (letter.length() != 1)
+			errx(1,"Invalid option '%s' in stage '%s'", option.c_str(), spec);
+
+		const char *value = (equal==std::string::npos) ? NULL : option.c_str() + equal + 1 ;
+		if (!stage->parse_option(letter[0], value))
+			errx(1,"Unknown option '%s' for stage '%s'", letter.c_str(), stage->name.c_str());
+	}
+
+	return stage;
+}
+
+int parse_program_args(int __attribute__((unused)) optind, int optc, char* optarg)
+{
+	switch(optc) {
+	case 's':
+		if (optarg==NULL) 
+			errx(1, "[-s] parameter requires an argument value");
+		stages.push_back(parse_stage(optarg));
+		break;
+
+	default:
+		errx(1, __FILE__ ":%d: Unknown argument (%c)", __LINE__, optc ) ;
+	}
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	size_t i;
+	bool fastq_only = false;
+	ALLOWED_INPUT_FILE_TYPES input_type;
+	const char* reads_unit;
+
+	fastx_allow_paired_files();
+	fastx_parse_cmdline(argc, argv, "s:", parse_program_args);
+
+	if (stages.empty())
+		errx(1,"No processing stages specified (-s)");
+
+	for (i=0; i<stages.size(); i++) {
+		stages[i]->validate_options();
+		if (stages[i]->requires_fastq())
+			fastq_only = true;
+	}
+
+	input_type = fastq_only ? FASTQ_ONLY : FASTA_OR_FASTQ ;
+
+	if ( paired_files_flag() ) {
+		fastx_init_paired_reader(&fastx, &mate2, get_input_filename(), get_input2_filename(),
+			input_type, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
+
+		fastx_init_paired_writer(&fastx, &mate2, get_output_filename(), get_output2_filename(),
+			OUTPUT_SAME_AS_INPUT, compress_output_flag());
+
+		while ( fastx_read_next_pair(&fastx, &mate2) ) {
+			if (run_stages(&fastx, &mate2))
+				fastx_write_pair(&fastx, &mate2);
+		}
+		reads_unit = "read pairs";
+	} else {
+		fastx_init_reader(&fastx, get_input_filename(), 
+			input_type, ALLOW_N, REQUIRE_UPPERCASE,
+			get_fastq_ascii_quality_offset() );
+
+		fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
+
+		while ( fastx_read_next_record(&fastx) ) {
+			if (run_stages(&fastx, NULL))
+				fastx_write_record(&fastx);
+		}
+		reads_unit = "reads";
+	}
+
+	//
+	//Print verbose report
+	if ( verbose_flag() ) {
+		for (i=0; i<stages.size(); i++) {
+			fprintf(get_report_file(), "Stage %zu (%s): input %zu %s, output %zu %s, discarded %zu %s.\n",
+				i+1, stages[i]->name.c_str(),
+				stages[i]->input_reads, reads_unit,
+				stages[i]->output_reads, reads_unit,
+				stages[i]->input_reads - stages[i]->output_reads, reads_unit);
+		}
+		fprintf(get_report_file(), "Input: %zu %s.\n", num_input_reads(&fastx), reads_unit ) ;
+		fprintf(get_report_file(), "Output: %zu %s.\n", num_output_reads(&fastx), reads_unit ) ;
+	}
+
+	for (i=0; i<stages.size(); i++)
+		delete stages[i];
+
+	fastx_report_timings();
+
+	return 0;
+}
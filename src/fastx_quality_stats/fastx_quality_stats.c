@@ -28,6 +28,8 @@
 #include "chomp.h"
 #include "fastx.h"
 #include "fastx_args.h"
+#include "kmer_profile.h"
+#include "tile_stats.h"
 
 #ifndef MAX
 #define MAX(a,b) (((a) > (b)) ? (a) : (b))
@@ -40,13 +42,23 @@
 #define MAX_SEQUENCE_LENGTH (MAX_SEQ_LINE_LENGTH) //that's pretty arbitrary... should be enough for now
 
 const char* usage=
-"usage: fastx_quality_stats [-h] [-N] [-i INFILE] [-o OUTFILE]\n" \
+"usage: fastx_quality_stats [-h] [-N] [-K FILE] [-k N] [-T N] [-b N] [-M N] [-t FILE] [-i INFILE] [-o OUTFILE]\n" \
 "Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
 "\n" \
 "   [-h] = This helpful help screen.\n" \
 "   [-i INFILE]  = FASTQ input file. default is STDIN.\n" \
 "   [-o OUTFILE] = TEXT output file. default is STDOUT.\n" \
+FASTX_COMMON_INPUT_OPTIONS_USAGE \
 "   [-N]         = New output format (with more information per nucleotide/cycle).\n" \
+"   [-K FILE]    = Profile over-represented K-mers, write the report to FILE.\n" \
+"   [-k N]       = K-mer length (with [-K]). Default is 8, max. is 32.\n" \
+"   [-T N]       = Number of top K-mers to report (with [-K]). Default is 50.\n" \
+"   [-b N]       = Cycle-bin width for positional enrichment (with [-K]). Default is 10.\n" \
+"   [-M N]       = Memory limit for the K-mer profile, in megabytes (with [-K]).\n" \
+"                  Default is 16. The profile never uses more than that.\n" \
+"   [-t FILE]    = Per-tile statistics: write a lane/tile/cycle matrix to FILE.\n" \
+"                  Requires Casava 1.8+ read identifiers\n" \
+"                  (@instrument:run:flowcell:LANE:TILE:x:y ...).\n" \
 "\n"\
 "The *OLD* output TEXT file will have the following fields (one row per column):\n" \
 "	column	= column number (1 to 36 for a 36-cycles read solexa file)\n" \
@@ -85,12 +97,40 @@ const char* usage=
 "		lW	= 'Left-Whisker' value (for boxplotting).\n" \
 "		rW	= 'Right-Whisker' value (for boxplotting).\n" \
 "\n"\
+"\n"\
+"The K-mer profile output format [-K]:\n" \
+"	kmer    = The K-mer sequence.\n" \
+"	count   = Estimated number of occurrences (never under-estimated).\n" \
+"	percent = Percent of all K-mers in the input.\n" \
+"	max_enrichment = Highest positional enrichment of this K-mer.\n" \
+"	max_enrichment_cycles = The cycles in which the highest enrichment was found.\n" \
+"	cycles_X-Y = Positional enrichment in cycles X to Y: the fraction of this\n" \
+"	          K-mer found in these cycles, divided by the fraction of all K-mers\n" \
+"	          found in these cycles (1.0 = evenly distributed).\n" \
+"\n"\
+"\n"\
+"The per-tile output format [-t] (one row per lane/tile/cycle):\n" \
+"	lane, tile, cycle\n" \
+"	count   = number of bases found in this cycle of this tile.\n" \
+"	mean    = Mean quality score value for this cycle of this tile.\n" \
+"	A_Count, C_Count, G_Count, T_Count, N_Count\n" \
+"\n"\
 "\n";
 ;
 
 FILE* outfile;
 int new_output_format = 0 ;
 
+const char* kmer_report_filename = NULL;
+unsigned int kmer_length = 8 ;
+unsigned int kmer_top_count = 50 ;
+unsigned int kmer_bin_width = 10 ;
+unsigned int kmer_max_memory_mb = 16 ;
+KMER_PROFILE* kmer_profile = NULL;
+
+const char* tile_report_filename = NULL;
+TILE_STATS* tile_stats = NULL;
+
 /*
 	Information for each column in the solexa file.
 	("Column" here refers to the number of reads in the file, usually 36)
@@ -170,15 +210,30 @@ void read_file()
 	int reads_count ;
 	char nucleotide ;
 	int nuc_index ;
+	size_t length ;
+	unsigned int lane, tile ;
 
 	while ( fastx_read_next_record(&fastx) ) {
 
-		if (strlen(fastx.nucleotides) >= MAX_SEQ_LINE_LENGTH)
+		length = fastx.sequence_length;
+		if (length >= MAX_SEQ_LINE_LENGTH)
 			errx(1, "Internal error: sequence too long (on line %llu). Hard-coded max. length is %d",
 					fastx.input_line_number, MAX_SEQ_LINE_LENGTH ) ;
+
+		if (kmer_profile)
+			kmer_profile_add_sequence(kmer_profile, fastx.nucleotides, length, get_reads_count(&fastx));
+
+		if (tile_stats) {
+			if (!parse_casava_lane_tile(fastx.name, &lane, &tile))
+				errx(1, "Invalid read identifier on line %llu: expecting Casava 1.8 format " \
+					"(@instrument:run:flowcell:lane:tile:x:y) for per-tile statistics [-t]",
+					fastx.input_line_number - (fastx.read_fastq ? 3 : 1) ) ;
+			tile_stats_add_sequence(tile_stats, lane, tile, fastx.nucleotides,
+				fastx.read_fastq ? fastx.quality : NULL, length, get_reads_count(&fastx));
+		}
 		
 		//for each base in the sequence...
-		for (index=0; index<strlen(fastx.nucleotides); index++) {
+		for (index=0; index<length; index++) {
 
 			nucleotide = fastx.nucleotides[index];
 
@@ -417,13 +472,57 @@ void print_old_statistics()
 }
 
 
-int parse_program_args(int __attribute__((unused)) optind, int optc, char __attribute__((unused))* optarg)
+int parse_program_args(int __attribute__((unused)) optind, int optc, char* optarg)
 {
 	switch(optc) {
 		case 'N':
 			new_output_format = 1 ;
 			break;
 
+		case 'K':
+			if (optarg==NULL)
+				errx(1,"[-K] option requires FILENAME argument");
+			kmer_report_filename = optarg;
+			break;
+
+		case 'k':
+			if (optarg==NULL)
+				errx(1, "[-k] parameter requires an argument value");
+			kmer_length = strtoul(optarg, NULL, 10);
+			if (kmer_length<1 || kmer_length>KMER_MAX_LENGTH)
+				errx(1,"Invalid K-mer length (-k %s)", optarg);
+			break;
+
+		case 'T':
+			if (optarg==NULL)
+				errx(1, "[-T] parameter requires an argument value");
+			kmer_top_count = strtoul(optarg, NULL, 10);
+			if (kmer_top_count<1)
+				errx(1,"Invalid number of top K-mers (-T %s)", optarg);
+			break;
+
+		case 'b':
+			if (optarg==NULL)
+				errx(1, "[-b] parameter requires an argument value");
+			kmer_bin_width = strtoul(optarg, NULL, 10);
+			if (kmer_bin_width<1)
+				errx(1,"Invalid cycle-bin width (-b %s)", optarg);
+			break;
+
+		case 't':
+			if (optarg==NULL)
+				errx(1,"[-t] option requires FILENAME argument");
+			tile_report_filename = optarg;
+			break;
+
+		case 'M':
+			if (optarg==NULL)
+				errx(1, "[-M] parameter requires an argument value");
+			kmer_max_memory_mb = strtoul(optarg, NULL, 10);
+			if (kmer_max_memory_mb<1)
+				errx(1,"Invalid memory limit (-M %s)", optarg);
+			break;
+
 		default:
 			errx(1, __FILE__ ":%d: Unknown argument (%c)", __LINE__, optc ) ;
 	}
@@ -434,7 +533,7 @@ int parse_program_args(int __attribute__((unused)) optind, int optc, char __attr
 
 void parse_commandline(int argc, char* argv[])
 {
-	fastx_parse_cmdline(argc, argv, "N", parse_program_args);
+	fastx_parse_cmdline(argc, argv, "NK:k:T:b:M:t:", parse_program_args);
 
 	fastx_init_reader(&fastx, get_input_filename(), 
 		FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE,
@@ -447,6 +546,41 @@ void parse_commandline(int argc, char* argv[])
 		if (outfile==NULL)	
 			err(1,"Failed to create output file (%s)", get_output_filename());
 	}
+
+	if (kmer_report_filename != NULL)
+		kmer_profile = kmer_profile_new(kmer_length, kmer_top_count, kmer_bin_width,
+				(size_t)kmer_max_memory_mb * 1024 * 1024);
+
+	if (tile_report_filename != NULL)
+		tile_stats = tile_stats_new();
+}
+
+void print_kmer_profile()
+{
+	FILE* kmer_file;
+
+	kmer_file = fopen(kmer_report_filename, "w");
+	if (kmer_file==NULL)
+		err(1,"Failed to create K-mer report file (%s)", kmer_report_filename);
+
+	kmer_profile_print(kmer_profile, kmer_file);
+
+	if (fclose(kmer_file)!=0)
+		err(1,"Failed to write K-mer report file (%s)", kmer_report_filename);
+}
+
+void print_tile_statistics()
+{
+	FILE* tile_file;
+
+	tile_file = fopen(tile_report_filename, "w");
+	if (tile_file==NULL)
+		err(1,"Failed to create per-tile report file (%s)", tile_report_filename);
+
+	tile_stats_print(tile_stats, tile_file);
+
+	if (fclose(tile_file)!=0)
+		err(1,"Failed to write per-tile report file (%s)", tile_report_filename);
 }
 
 
@@ -459,5 +593,15 @@ int main(int argc, char* argv[])
 		print_statistics();
 	else	
 		print_old_statistics();
+	if ( kmer_profile ) {
+		print_kmer_profile();
+		kmer_profile_free(kmer_profile);
+	}
+	if ( tile_stats ) {
+		print_tile_statistics();
+		tile_stats_free(tile_stats);
+	}
+
+	fastx_report_timings();
 	return 0;
 }
@@ -0,0 +1,465 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <err.h>
+
+#include "kmer_profile.h"
+
+#define INDEX_EMPTY (-1)
+
+//Lookup table to convert from ASCII character to 2-bit code.
+//non-ACGT characters (e.g. 'N') are marked with 4.
+static unsigned char nuc_to_2bit[256];
+
+static const char two_bit_to_nuc[4] = { 'A', 'C', 'G', 'T' } ;
+
+static const uint64_t row_seeds[KMER_SKETCH_DEPTH] = {
+	0x9E3779B97F4A7C15ULL,
+	0xC2B2AE3D27D4EB4FULL,
+	0x165667B19E3779F9ULL,
+	0xD6E8FEB86659FD93ULL
+};
+
+/*
+	64bit mixing function (the finalizer of MurmurHash3) -
+	spreads the 2-bit encoded K-mer over all the bits,
+	so that the lower bits can be used as sketch/index positions.
+*/
+static inline uint64_t mix64(uint64_t key)
+{
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	key *= 0xC4CEB9FE1A85EC53ULL;
+	key ^= key >> 33;
+	return key;
+}
+
+static size_t round_up_power_of_two(size_t value)
+{
+	size_t result = 1 ;
+	while (result < value)
+		result <<= 1 ;
+	return result;
+}
+
+static void init_lookup_table()
+{
+	memset(nuc_to_2bit, 4, sizeof(nuc_to_2bit));
+	nuc_to_2bit['A'] = nuc_to_2bit['a'] = 0 ;
+	nuc_to_2bit['C'] = nuc_to_2bit['c'] = 1 ;
+	nuc_to_2bit['G'] = nuc_to_2bit['g'] = 2 ;
+	nuc_to_2bit['T'] = nuc_to_2bit['t'] = 3 ;
+}
+
+KMER_PROFILE* kmer_profile_new(unsigned int kmer_length, size_t top_count,
+		unsigned int bin_width, size_t max_memory_bytes)
+{
+	KMER_PROFILE* profile;
+	size_t index_size;
+	size_t fixed_memory;
+	size_t sketch_width;
+
+	if (kmer_length<1 || kmer_length>KMER_MAX_LENGTH)
+		errx(1,"Invalid K-mer length (%u), valid values are 1 to %d",
+			kmer_length, KMER_MAX_LENGTH);
+	if (top_count<1)
+		errx(1,"Invalid number of top K-mers to report (%zu)", top_count);
+	if (bin_width<1)
+		errx(1,"Invalid cycle-bin width (%u)", bin_width);
+
+	init_lookup_table();
+
+	index_size = round_up_power_of_two(top_count*2);
+
+	//The heap and the index are sized by the number of reported K-mers,
+	//the sketch gets whatever is left from the memory ceiling.
+	fixed_memory = sizeof(KMER_PROFILE) +
+			top_count * sizeof(struct kmer_entry) +
+			index_size * sizeof(int32_t) ;
+	if (fixed_memory >= max_memory_bytes)
+		errx(1,"K-mer profile memory limit (%zu bytes) is too small for %zu top K-mers",
+			max_memory_bytes, top_count);
+
+	//Largest power-of-two width that fits in the remaining memory
+	sketch_width = 1;
+	while ( (sketch_width*2) * KMER_SKETCH_DEPTH * sizeof(uint32_t) <= (max_memory_bytes-fixed_memory) )
+		sketch_width *= 2 ;
+	if (sketch_width < 1024)
+		errx(1,"K-mer profile memory limit (%zu bytes) is too small", max_memory_bytes);
+
+	profile = calloc(1, sizeof(KMER_PROFILE));
+	if (profile==NULL)
+		err(1,"failed to allocate K-mer profile");
+
+	profile->kmer_length = kmer_length;
+	profile->kmer_mask = (kmer_length==32) ? ~0ULL : ((1ULL << (2*kmer_length)) - 1) ;
+	profile->bin_width = bin_width;
+
+	profile->sketch_width = sketch_width;
+	profile->sketch_mask = sketch_width - 1;
+	profile->sketch = calloc(sketch_width * KMER_SKETCH_DEPTH, sizeof(uint32_t));
+	if (profile->sketch==NULL)
+		err(1,"failed to allocate K-mer sketch (%zu counters)", sketch_width*KMER_SKETCH_DEPTH);
+
+	profile->heap_capacity = top_count;
+	profile->heap = calloc(top_count, sizeof(struct kmer_entry));
+	if (profile->heap==NULL)
+		err(1,"failed to allocate K-mer heap (%zu entries)", top_count);
+
+	profile->index_mask = index_size - 1;
+	profile->index = malloc(index_size * sizeof(int32_t));
+	if (profile->index==NULL)
+		err(1,"failed to allocate K-mer index (%zu entries)", index_size);
+	memset(profile->index, 0xFF, index_size * sizeof(int32_t)); // all entries = INDEX_EMPTY
+
+	profile->memory_used = fixed_memory + sketch_width * KMER_SKETCH_DEPTH * sizeof(uint32_t);
+
+	return profile;
+}
+
+void kmer_profile_free(KMER_PROFILE* profile)
+{
+	if (profile==NULL)
+		return;
+	free(profile->sketch);
+	free(profile->heap);
+	free(profile->index);
+	free(profile);
+}
+
+/*
+	Count-Min sketch with conservative update:
+	Only the counters which equal the current minimum are incremented.
+	Returns the new estimated count of the K-mer.
+*/
+static uint64_t sketch_increment(KMER_PROFILE* profile, uint64_t kmer, unsigned int weight)
+{
+	size_t row;
+	size_t pos[KMER_SKETCH_DEPTH];
+	uint32_t min_value = UINT32_MAX;
+	uint64_t new_value;
+
+	for (row=0; row<KMER_SKETCH_DEPTH; row++) {
+		pos[row] = row*profile->sketch_width +
+			(mix64(kmer ^ row_seeds[row]) & profile->sketch_mask);
+		if (profile->sketch[pos[row]] < min_value)
+			min_value = profile->sketch[pos[row]];
+	}
+
+	new_value = (uint64_t)min_value + weight ;
+	if (new_value > UINT32_MAX)
+		new_value = UINT32_MAX ; // saturate, never wrap around
+
+	for (row=0; row<KMER_SKETCH_DEPTH; row++)
+		if (profile->sketch[pos[row]] < new_value)
+			profile->sketch[pos[row]] = (uint32_t)new_value;
+
+	return new_value;
+}
+
+/*
+	Index (kmer => heap position) - open addressing with linear probing.
+	Returns the slot containing the K-mer, or the empty slot where it should be inserted.
+*/
+static size_t index_find_slot(const KMER_PROFILE* profile, uint64_t kmer)
+{
+	size_t slot = mix64(kmer) & profile->index_mask;
+
+	while (profile->index[slot] != INDEX_EMPTY) {
+		if (profile->heap[profile->index[slot]].kmer == kmer)
+			break;
+		slot = (slot+1) & profile->index_mask;
+	}
+	return slot;
+}
+
+/*
+	Remove a K-mer from the index, using backward-shift deletion
+	(so no tombstones are needed, and the probe sequences stay short).
+*/
+static void index_remove(KMER_PROFILE* profile, uint64_t kmer)
+{
+	size_t slot = index_find_slot(profile, kmer);
+	size_t next = slot;
+	size_t home;
+
+	if (profile->index[slot]==INDEX_EMPTY)
+		errx(1,"Internal error: K-mer not found in index (%s:%d)", __FILE__,__LINE__);
+
+	while (1) {
+		next = (next+1) & profile->index_mask;
+		if (profile->index[next]==INDEX_EMPTY)
+			break;
+
+		home = mix64(profile->heap[profile->index[next]].kmer) & profile->index_mask;
+
+		//Can the entry at 'next' be moved back to 'slot' ?
+		//(only if its home position is not in the (slot,next] cyclic range)
+		if ( (slot<=next) ? (home<=slot || home>next) : (home<=slot && home>next) ) {
+			profile->index[slot] = profile->index[next];
+			slot = next;
+		}
+	}
+	profile->index[slot] = INDEX_EMPTY;
+}
+
+static void heap_swap(KMER_PROFILE* profile, size_t a, size_t b)
+{
+	struct kmer_entry temp;
+	size_t slot_a, slot_b;
+
+	//Find the index slots before moving the entries (the lookup compares heap entries)
+	slot_a = index_find_slot(profile, profile->heap[a].kmer);
+	slot_b = index_find_slot(profile, profile->heap[b].kmer);
+
+	temp = profile->heap[a];
+	profile->heap[a] = profile->heap[b];
+	profile->heap[b] = temp;
+
+	profile->index[slot_a] = (int32_t)b;
+	profile->index[slot_b] = (int32_t)a;
+}
+
+static void heap_sift_up(KMER_PROFILE* profile, size_t pos)
+{
+	size_t parent;
+
+	while (pos>0) {
+		parent = (pos-1)/2;
+		if (profile->heap[parent].count <= profile->heap[pos].count)
+			break;
+		heap_swap(profile, parent, pos);
+		pos = parent;
+	}
+}
+
+static void heap_sift_down(KMER_PROFILE* profile, size_t pos)
+{
+	size_t smallest;
+	size_t left, right;
+
+	while (1) {
+		left = pos*2+1;
+		right = pos*2+2;
+		smallest = pos;
+
+		if (left<profile->heap_size && profile->heap[left].count < profile->heap[smallest].count)
+			smallest = left;
+		if (right<profile->heap_size && profile->heap[right].count < profile->heap[smallest].count)
+			smallest = right;
+		if (smallest==pos)
+			break;
+		heap_swap(profile, pos, smallest);
+		pos = smallest;
+	}
+}
+
+static void update_top_kmers(KMER_PROFILE* profile, uint64_t kmer, uint64_t estimate,
+		unsigned int bin, unsigned int weight)
+{
+	size_t slot;
+	size_t pos;
+	struct kmer_entry *entry;
+
+	slot = index_find_slot(profile, kmer);
+
+	if (profile->index[slot] != INDEX_EMPTY) {
+		//Already a top K-mer - update the count and position
+		pos = profile->index[slot];
+		entry = &profile->heap[pos];
+		entry->count = estimate;
+		entry->bins[bin] += weight;
+		heap_sift_down(profile, pos);
+		return;
+	}
+
+	if (profile->heap_size < profile->heap_capacity) {
+		//Heap not full yet - just add the new K-mer
+		pos = profile->heap_size++;
+		entry = &profile->heap[pos];
+		memset(entry, 0, sizeof(struct kmer_entry));
+		entry->kmer = kmer;
+		entry->count = estimate;
+		entry->bins[bin] = weight;
+		profile->index[slot] = (int32_t)pos;
+		heap_sift_up(profile, pos);
+		return;
+	}
+
+	if (estimate <= profile->heap[0].count)
+		return;
+
+	//Replace the least abundant top K-mer
+	index_remove(profile, profile->heap[0].kmer);
+	entry = &profile->heap[0];
+	memset(entry, 0, sizeof(struct kmer_entry));
+	entry->kmer = kmer;
+	entry->count = estimate;
+	entry->bins[bin] = weight;
+	profile->index[index_find_slot(profile, kmer)] = 0;
+	heap_sift_down(profile, 0);
+}
+
+void kmer_profile_add_sequence(KMER_PROFILE* profile, const char* sequence, size_t length,
+		unsigned int weight)
+{
+	size_t i;
+	uint64_t kmer = 0 ;
+	unsigned int valid_bases = 0 ; //number of consecutive ACGT bases ending at the current position
+	unsigned int code;
+	unsigned int bin;
+	uint64_t estimate;
+
+	for (i=0; i<length; i++) {
+		code = nuc_to_2bit[(unsigned char)sequence[i]];
+		if (code>3) {
+			//Unknown base - restart the K-mer
+			valid_bases = 0 ;
+			kmer = 0 ;
+			continue;
+		}
+
+		kmer = ((kmer << 2) | code) & profile->kmer_mask;
+		if (valid_bases < profile->kmer_length)
+			valid_bases++;
+		if (valid_bases < profile->kmer_length)
+			continue;
+
+		//The bin is determined by the starting cycle of the K-mer
+		bin = (i + 1 - profile->kmer_length) / profile->bin_width ;
+		if (bin >= KMER_MAX_BINS)
+			bin = KMER_MAX_BINS-1;
+
+		profile->all_bins[bin] += weight;
+		profile->total_kmers += weight;
+
+		estimate = sketch_increment(profile, kmer, weight);
+		update_top_kmers(profile, kmer, estimate, bin, weight);
+	}
+}
+
+static int compare_entries_by_count(const void* a, const void* b)
+{
+	const struct kmer_entry *entry1 = (const struct kmer_entry*)a;
+	const struct kmer_entry *entry2 = (const struct kmer_entry*)b;
+
+	if (entry1->count > entry2->count)
+		return -1;
+	if (entry1->count < entry2->count)
+		return 1;
+	return (entry1->kmer < entry2->kmer) ? -1 : (entry1->kmer > entry2->kmer) ;
+}
+
+static void print_kmer(const KMER_PROFILE* profile, uint64_t kmer, FILE* output)
+{
+	char text[KMER_MAX_LENGTH+1];
+	unsigned int i;
+
+	for (i=0; i<profile->kmer_length; i++)
+		text[profile->kmer_length-1-i] = two_bit_to_nuc[ (kmer >> (2*i)) & 3 ];
+	text[profile->kmer_length] = 0 ;
+	fprintf(output, "%s", text);
+}
+
+static void print_bin_name(const KMER_PROFILE* profile, unsigned int bin, FILE* output)
+{
+	if (bin == KMER_MAX_BINS-1)
+		fprintf(output, "%u+", bin*profile->bin_width+1);
+	else
+		fprintf(output, "%u-%u", bin*profile->bin_width+1, (bin+1)*profile->bin_width);
+}
+
+/*
+	Print the top K-mers, most abundant first.
+
+	Positional enrichment of a K-mer in a cycle-bin is the fraction of the K-mer's
+	occurrences in that bin, divided by the fraction of all K-mers in that bin.
+	(1.0 = evenly distributed, >1 = over-represented in these cycles).
+*/
+void kmer_profile_print(const KMER_PROFILE* profile, FILE* output)
+{
+	struct kmer_entry *sorted;
+	unsigned int bin;
+	unsigned int used_bins;
+	unsigned int max_bin;
+	size_t i;
+	uint64_t kmer_bins_total;
+	double enrichment;
+	double max_enrichment;
+
+	//Only print bins which had any K-mers
+	used_bins = 0 ;
+	for (bin=0; bin<KMER_MAX_BINS; bin++)
+		if (profile->all_bins[bin]>0)
+			used_bins = bin+1;
+
+	sorted = malloc(sizeof(struct kmer_entry) * (profile->heap_size+1));
+	if (sorted==NULL)
+		err(1,"failed to allocate K-mer report");
+	memcpy(sorted, profile->heap, sizeof(struct kmer_entry) * profile->heap_size);
+	qsort(sorted, profile->heap_size, sizeof(struct kmer_entry), compare_entries_by_count);
+
+	fprintf(output,"kmer\tcount\tpercent\tmax_enrichment\tmax_enrichment_cycles");
+	for (bin=0; bin<used_bins; bin++) {
+		fprintf(output,"\tcycles_");
+		print_bin_name(profile, bin, output);
+	}
+	fprintf(output,"\n");
+
+	for (i=0; i<profile->heap_size; i++) {
+		kmer_bins_total = 0 ;
+		for (bin=0; bin<used_bins; bin++)
+			kmer_bins_total += sorted[i].bins[bin];
+
+		max_bin = 0 ;
+		max_enrichment = 0 ;
+		for (bin=0; bin<used_bins; bin++) {
+			if (profile->all_bins[bin]==0 || kmer_bins_total==0)
+				continue;
+			enrichment = ((double)sorted[i].bins[bin] / (double)kmer_bins_total) /
+				     ((double)profile->all_bins[bin] / (double)profile->total_kmers);
+			if (enrichment > max_enrichment) {
+				max_enrichment = enrichment;
+				max_bin = bin;
+			}
+		}
+
+		print_kmer(profile, sorted[i].kmer, output);
+		fprintf(output, "\t%llu\t%3.2f\t%3.2f\t",
+			(unsigned long long)sorted[i].count,
+			(profile->total_kmers>0) ? (sorted[i].count*100.0/profile->total_kmers) : 0.0,
+			max_enrichment);
+		print_bin_name(profile, max_bin, output);
+
+		for (bin=0; bin<used_bins; bin++) {
+			if (profile->all_bins[bin]==0 || kmer_bins_total==0)
+				enrichment = 0 ;
+			else
+				enrichment = ((double)sorted[i].bins[bin] / (double)kmer_bins_total) /
+					     ((double)profile->all_bins[bin] / (double)profile->total_kmers);
+			fprintf(output, "\t%3.2f", enrichment);
+		}
+		fprintf(output,"\n");
+	}
+
+	free(sorted);
+}
@@ -0,0 +1,83 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __KMER_PROFILE_H__
+#define __KMER_PROFILE_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Bounded-memory K-mer profiler.
+ *
+ * K-mers are 2-bit encoded (up to 32 bases in a 64-bit word) and counted
+ * in a Count-Min sketch (with conservative update). The most abundant
+ * K-mers are kept in a fixed-size min-heap, together with a per-cycle-bin
+ * histogram of the positions in which they were found.
+ *
+ * All memory is allocated once, in kmer_profile_new(), and never grows -
+ * the sketch width is derived from the requested memory ceiling.
+ */
+
+#define KMER_MAX_LENGTH   (32)
+#define KMER_MAX_BINS     (16)
+#define KMER_SKETCH_DEPTH (4)
+
+struct kmer_entry
+{
+	uint64_t kmer;
+	uint64_t count;		// Count-Min estimate, updated on every occurrence
+	uint64_t bins[KMER_MAX_BINS]; // occurrences per cycle-bin (since the K-mer entered the heap)
+};
+
+typedef struct
+{
+	unsigned int kmer_length;
+	uint64_t     kmer_mask;
+
+	unsigned int bin_width;		// number of cycles in each bin
+	uint64_t     all_bins[KMER_MAX_BINS]; // total K-mers per cycle-bin (for enrichment)
+	uint64_t     total_kmers;
+
+	/* Count-Min sketch */
+	uint32_t     *sketch;		// KMER_SKETCH_DEPTH rows of 'sketch_width' counters
+	size_t       sketch_width;	// always a power of two
+	size_t       sketch_mask;
+
+	/* Top-K min-heap, and an open-addressing index (kmer => heap position) */
+	struct kmer_entry *heap;
+	size_t       heap_size;
+	size_t       heap_capacity;
+	int32_t      *index;
+	size_t       index_mask;
+
+	size_t       memory_used;
+} KMER_PROFILE;
+
+KMER_PROFILE* kmer_profile_new(unsigned int kmer_length, size_t top_count,
+		unsigned int bin_width, size_t max_memory_bytes);
+
+void kmer_profile_free(KMER_PROFILE* profile);
+
+// Count all the K-mers of a sequence (K-mers containing non-ACGT bases are skipped).
+// 'weight' is the number of reads this sequence represents (for collapsed FASTA files).
+void kmer_profile_add_sequence(KMER_PROFILE* profile, const char* sequence, size_t length,
+		unsigned int weight);
+
+void kmer_profile_print(const KMER_PROFILE* profile, FILE* output);
+
+#endif
@@ -0,0 +1,269 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <err.h>
+
+#include "tile_stats.h"
+
+#define INITIAL_TILES_CAPACITY (256)
+
+//Lookup table to convert from ASCII character A/C/G/T/N to base index.
+//Anything else is counted as 'N'.
+static unsigned char nuc_to_tile_base[256];
+
+static const char* tile_base_names[TILE_BASES_COUNT] = { "A","C","G","T","N" } ;
+
+static inline size_t tile_hash(unsigned int lane, unsigned int tile)
+{
+	uint64_t key = ((uint64_t)lane << 32) | tile ;
+	key ^= key >> 33;
+	key *= 0xFF51AFD7ED558CCDULL;
+	key ^= key >> 33;
+	return (size_t)key;
+}
+
+TILE_STATS* tile_stats_new()
+{
+	TILE_STATS* stats;
+
+	memset(nuc_to_tile_base, TILE_BASE_N, sizeof(nuc_to_tile_base));
+	nuc_to_tile_base['A'] = nuc_to_tile_base['a'] = TILE_BASE_A ;
+	nuc_to_tile_base['C'] = nuc_to_tile_base['c'] = TILE_BASE_C ;
+	nuc_to_tile_base['G'] = nuc_to_tile_base['g'] = TILE_BASE_G ;
+	nuc_to_tile_base['T'] = nuc_to_tile_base['t'] = TILE_BASE_T ;
+
+	stats = calloc(1, sizeof(TILE_STATS));
+	if (stats==NULL)
+		err(1,"failed to allocate tile statistics");
+
+	stats->tiles_capacity = INITIAL_TILES_CAPACITY;
+	stats->tiles = calloc(stats->tiles_capacity, sizeof(struct tile_data));
+	if (stats->tiles==NULL)
+		err(1,"failed to allocate tile statistics");
+
+	return stats;
+}
+
+void tile_stats_free(TILE_STATS* stats)
+{
+	size_t i;
+
+	if (stats==NULL)
+		return;
+	for (i=0; i<stats->tiles_capacity; i++)
+		free(stats->tiles[i].cycles);
+	free(stats->tiles);
+	free(stats);
+}
+
+/*
+	Parse a decimal number, terminated by 'terminator'.
+	Returns a pointer to the character following the terminator, or NULL.
+*/
+static inline const char* parse_number_field(const char* p, char terminator, unsigned int *value)
+{
+	unsigned int result = 0 ;
+
+	if (*p<'0' || *p>'9')
+		return NULL;
+	while (*p>='0' && *p<='9') {
+		result = result*10 + (*p - '0');
+		p++;
+	}
+	if (*p != terminator)
+		return NULL;
+	*value = result;
+	return p+1;
+}
+
+int parse_casava_lane_tile(const char* read_id, unsigned int *lane, unsigned int *tile)
+{
+	const char* p = read_id;
+	int colons = 0 ;
+
+	//Skip the instrument, run-id and flowcell fields
+	while (colons<3) {
+		if (*p==0 || *p==' ')
+			return 0;
+		if (*p==':')
+			colons++;
+		p++;
+	}
+
+	p = parse_number_field(p, ':', lane);
+	if (p==NULL)
+		return 0;
+	p = parse_number_field(p, ':', tile);
+	if (p==NULL)
+		return 0;
+
+	return 1;
+}
+
+static struct tile_data* find_tile(TILE_STATS* stats, unsigned int lane, unsigned int tile);
+
+static void grow_tiles_table(TILE_STATS* stats)
+{
+	struct tile_data *old_tiles = stats->tiles;
+	size_t old_capacity = stats->tiles_capacity;
+	struct tile_data *new_tile;
+	size_t i;
+
+	stats->tiles_capacity *= 2 ;
+	stats->tiles = calloc(stats->tiles_capacity, sizeof(struct tile_data));
+	if (stats->tiles==NULL)
+		err(1,"failed to allocate tile statistics (%zu tiles)", stats->tiles_capacity);
+
+	for (i=0; i<old_capacity; i++) {
+		if (old_tiles[i].cycles==NULL)
+			continue;
+		new_tile = find_tile(stats, old_tiles[i].lane, old_tiles[i].tile);
+		*new_tile = old_tiles[i];
+	}
+	free(old_tiles);
+}
+
+/*
+	Returns the tile's slot in the hash table - either the existing tile,
+	or an empty slot (with cycles==NULL) where it should be added.
+*/
+static struct tile_data* find_tile(TILE_STATS* stats, unsigned int lane, unsigned int tile)
+{
+	size_t mask = stats->tiles_capacity - 1 ;
+	size_t slot = tile_hash(lane, tile) & mask;
+
+	while (stats->tiles[slot].cycles != NULL) {
+		if (stats->tiles[slot].lane==lane && stats->tiles[slot].tile==tile)
+			break;
+		slot = (slot+1) & mask;
+	}
+	return &stats->tiles[slot];
+}
+
+static void grow_tile_cycles(struct tile_data* data, size_t length)
+{
+	size_t new_count = (data->cycles_count>0) ? data->cycles_count : 64 ;
+
+	while (new_count < length)
+		new_count *= 2 ;
+
+	data->cycles = realloc(data->cycles, new_count * sizeof(struct tile_cycle));
+	if (data->cycles==NULL)
+		err(1,"failed to allocate tile statistics (%zu cycles)", new_count);
+	memset(data->cycles + data->cycles_count, 0,
+		(new_count - data->cycles_count) * sizeof(struct tile_cycle));
+	data->cycles_count = new_count;
+}
+
+void tile_stats_add_sequence(TILE_STATS* stats, unsigned int lane, unsigned int tile,
+		const char* sequence, const int* quality, size_t length, unsigned int weight)
+{
+	struct tile_data *data;
+	struct tile_cycle *cycle;
+	size_t i;
+
+	data = find_tile(stats, lane, tile);
+	if (data->cycles==NULL) {
+		//New tile - keep the load factor below 1/2
+		if ( (stats->tiles_count+1)*2 > stats->tiles_capacity ) {
+			grow_tiles_table(stats);
+			data = find_tile(stats, lane, tile);
+		}
+		data->lane = lane;
+		data->tile = tile;
+		data->cycles_count = 0 ;
+		grow_tile_cycles(data, length);
+		stats->tiles_count++;
+	}
+	if (length > data->cycles_count)
+		grow_tile_cycles(data, length);
+
+	cycle = data->cycles;
+	for (i=0; i<length; i++, cycle++) {
+		cycle->bases[ nuc_to_tile_base[(unsigned char)sequence[i]] ] += weight ;
+		if (quality)
+			cycle->quality_sum += (int64_t)quality[i] * weight ;
+	}
+}
+
+static int compare_tiles(const void* a, const void* b)
+{
+	const struct tile_data *tile1 = *(const struct tile_data**)a;
+	const struct tile_data *tile2 = *(const struct tile_data**)b;
+
+	if (tile1->lane != tile2->lane)
+		return (tile1->lane < tile2->lane) ? -1 : 1 ;
+	if (tile1->tile != tile2->tile)
+		return (tile1->tile < tile2->tile) ? -1 : 1 ;
+	return 0;
+}
+
+/*
+	Print the per-tile matrix: one line per lane/tile/cycle,
+	sorted by lane, tile and cycle.
+*/
+void tile_stats_print(const TILE_STATS* stats, FILE* output)
+{
+	const struct tile_data **sorted;
+	const struct tile_cycle *cycle;
+	size_t i, j, count;
+	size_t cycle_index;
+	uint64_t bases_count;
+	int base;
+
+	sorted = malloc(sizeof(struct tile_data*) * (stats->tiles_count+1));
+	if (sorted==NULL)
+		err(1,"failed to allocate tile report");
+
+	count = 0 ;
+	for (i=0; i<stats->tiles_capacity; i++)
+		if (stats->tiles[i].cycles != NULL)
+			sorted[count++] = &stats->tiles[i];
+	qsort(sorted, count, sizeof(struct tile_data*), compare_tiles);
+
+	fprintf(output,"lane\ttile\tcycle\tcount\tmean");
+	for (base=0; base<TILE_BASES_COUNT; base++)
+		fprintf(output,"\t%s_Count", tile_base_names[base]);
+	fprintf(output,"\n");
+
+	for (i=0; i<count; i++) {
+		for (cycle_index=0; cycle_index<sorted[i]->cycles_count; cycle_index++) {
+			cycle = &sorted[i]->cycles[cycle_index];
+
+			bases_count = 0 ;
+			for (base=0; base<TILE_BASES_COUNT; base++)
+				bases_count += cycle->bases[base];
+			//no more reads are long enough to reach this cycle
+			if (bases_count==0)
+				break;
+
+			fprintf(output,"%u\t%u\t%zu\t%llu\t%3.2f",
+				sorted[i]->lane, sorted[i]->tile, cycle_index+1,
+				(unsigned long long)bases_count,
+				((double)cycle->quality_sum)/((double)bases_count));
+			for (j=0; j<TILE_BASES_COUNT; j++)
+				fprintf(output,"\t%llu", (unsigned long long)cycle->bases[j]);
+			fprintf(output,"\n");
+		}
+	}
+
+	free(sorted);
+}
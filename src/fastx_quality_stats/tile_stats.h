@@ -0,0 +1,81 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __TILE_STATS_H__
+#define __TILE_STATS_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+/*
+ * Per-Tile statistics.
+ *
+ * Lane and tile numbers are extracted from Casava 1.8+ read identifiers:
+ *   @<instrument>:<run>:<flowcell>:<lane>:<tile>:<x>:<y> <read>:<filtered>:<control>:<index>
+ *
+ * Each tile has a compact accumulator (sum of quality scores and base counts,
+ * per cycle), kept in a hash table keyed by lane+tile.
+ */
+
+enum {
+	TILE_BASE_A = 0,
+	TILE_BASE_C,
+	TILE_BASE_G,
+	TILE_BASE_T,
+	TILE_BASE_N,
+	TILE_BASES_COUNT
+};
+
+struct tile_cycle
+{
+	int64_t  quality_sum;
+	uint64_t bases[TILE_BASES_COUNT];
+};
+
+struct tile_data
+{
+	unsigned int lane;
+	unsigned int tile;
+	size_t cycles_count;		// number of allocated cycles
+	struct tile_cycle *cycles;
+};
+
+typedef struct
+{
+	struct tile_data *tiles;	// hash table, open addressing
+	size_t tiles_capacity;		// always a power of two
+	size_t tiles_count;
+} TILE_STATS;
+
+TILE_STATS* tile_stats_new();
+
+void tile_stats_free(TILE_STATS* stats);
+
+/*
+	Extract lane/tile numbers from a Casava 1.8+ read identifier
+	(without the '@' prefix).
+	Returns 1 on success, 0 if the identifier is not in Casava 1.8 format.
+*/
+int parse_casava_lane_tile(const char* read_id, unsigned int *lane, unsigned int *tile);
+
+// 'quality' can be NULL (for FASTA input)
+void tile_stats_add_sequence(TILE_STATS* stats, unsigned int lane, unsigned int tile,
+		const char* sequence, const int* quality, size_t length, unsigned int weight);
+
+void tile_stats_print(const TILE_STATS* stats, FILE* output);
+
+#endif
@@ -37,8 +37,13 @@ const char* usage=
 "                  COUNT - use simply counter as the name.\n" \
 "   [-h]         = This helpful help screen.\n" \
 "   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
 "\n";
 
 enum RENAME_TYPE {
@@ -107,5 +112,7 @@ int main(int argc, char* argv[])
 	if ( verbose_flag() ) {
 		fprintf(get_report_file(), "Renamed: %zu reads.\n", num_input_reads(&fastx) ) ;
 	}
+
+	fastx_report_timings();
 	return 0;
 }
@@ -34,8 +34,13 @@ const char* usage=
 "\n" \
 "   [-h]         = This helpful help screen.\n" \
 "   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
 "\n";
 
 FASTX fastx;
@@ -124,5 +129,7 @@ int main(int argc, char* argv[])
 		fprintf(get_report_file(), "Input: %zu reads.\n", num_input_reads(&fastx) ) ;
 		fprintf(get_report_file(), "Output: %zu reads.\n", num_output_reads(&fastx) ) ;
 	}
+
+	fastx_report_timings();
 	return 0;
 }
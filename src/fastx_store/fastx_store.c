@@ -0,0 +1,118 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+#include <errno.h>
+#include <err.h>
+
+#include <config.h>
+
+#include "fastx.h"
+#include "fastx_args.h"
+#include "fastx_store.h"
+
+const char* usage=
+"usage: fastx_store [-h] [-v] [-d] [-z] [-i INFILE] [-o OUTFILE]\n" \
+"Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
+"\n" \
+"Converts a FASTA/Q file into a binary read store, which the FASTX-Toolkit\n" \
+"programs built on libfastx read directly (using mmap, without parsing and\n" \
+"validating the text). Useful when running many passes over the same file.\n" \
+"fasta_formatter, fastx_uncollapser's tabular mode and the scripts read text\n" \
+"only - decode the store first ([-d]).\n" \
+"\n" \
+"   [-h]         = This helpful help screen.\n" \
+"   [-d]         = Decode - convert a binary read store back to FASTA/Q.\n" \
+"   [-z]         = Compress output with GZIP (only with [-d]).\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
+"   [-v]         = Verbose - report number of sequences.\n" \
+"                  If [-o] is specified,  report will be printed to STDOUT.\n" \
+"                  If [-o] is not specified (and output goes to STDOUT),\n" \
+"                  report will be printed to STDERR.\n" \
+"   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
+"   [-o OUTFILE] = Output file. default is STDOUT.\n" \
+FASTX_COMMON_INPUT_OPTIONS_USAGE \
+"\n" \
+"Only upper-case A/C/G/T/N bases can be stored.\n" \
+"The quality offset (-Q) is stored, and must be used by programs reading the store.\n" \
+"Binary read stores must be regular files (they can't be read from a pipe).\n" \
+"\n";
+
+int decode_store = 0 ;
+FASTX fastx;
+
+int parse_program_args(int __attribute__((unused)) optind, int optc, char __attribute__((unused)) *optarg)
+{
+	switch(optc) {
+	case 'd':
+		decode_store = 1;
+		break;
+
+	default:
+		errx(1, __FILE__ ":%d: Unknown argument (%c)", __LINE__, optc ) ;
+	}
+	return 1;
+}
+
+int main(int argc, char* argv[])
+{
+	struct fastx_store_writer *writer = NULL;
+
+	fastx_parse_cmdline(argc, argv, "d", parse_program_args);
+
+	fastx_init_reader(&fastx, get_input_filename(),
+		FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE, get_fastq_ascii_quality_offset() );
+
+	if (decode_store) {
+		fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
+
+		while ( fastx_read_next_record(&fastx) )
+			fastx_write_record(&fastx);
+	} else {
+		if (compress_output_flag())
+			errx(1,"binary read stores can't be compressed ([-z] is only valid with [-d])");
+
+		while ( fastx_read_next_record(&fastx) ) {
+			//The FASTQ quality format is known only after the first record was read
+			if (writer==NULL)
+				writer = fastx_store_writer_new(get_output_filename(), fastx.read_fastq,
+						fastx.read_fastq_ascii, get_fastq_ascii_quality_offset());
+
+			fastx_store_writer_add(writer, fastx.name, fastx.name2,
+					fastx.nucleotides, fastx.quality, fastx.sequence_length);
+		}
+		if (writer==NULL)
+			writer = fastx_store_writer_new(get_output_filename(), fastx.read_fastq,
+					fastx.read_fastq_ascii, get_fastq_ascii_quality_offset());
+		fastx_store_writer_close(writer);
+	}
+
+	if ( verbose_flag() ) {
+		fprintf(get_report_file(), "Input: %zu sequences (representing %zu reads)\n",
+				num_input_sequences(&fastx), num_input_reads(&fastx));
+	}
+
+	fastx_report_timings();
+	return 0;
+}
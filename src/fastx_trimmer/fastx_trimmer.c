@@ -27,11 +27,12 @@
 
 #include "fastx.h"
 #include "fastx_args.h"
+#include "fastx_stages.h"
 
 #define MAX_ADAPTER_LEN 100
 
 const char* usage=
-"usage: fastx_trimmer [-h] [-f N] [-l N] [-t N] [-m MINLEN] [-z] [-v] [-i INFILE] [-o OUTFILE]\n" \
+"usage: fastx_trimmer [-h] [-f N] [-l N] [-t N] [-m MINLEN] [-z] [-v] [-i INFILE] [-o OUTFILE] [-I INFILE2] [-O OUTFILE2] [-P]\n" \
 "Part of " PACKAGE_STRING " by A. Gordon (assafgordon@gmail.com)\n" \
 "\n" \
 "   [-h]         = This helpful help screen.\n" \
@@ -41,122 +42,83 @@ const char* usage=
 "                  '-t'  can not be used with '-l' and '-f'.\n" \
 "   [-m MINLEN]  = With [-t], discard reads shorter than MINLEN.\n"
 "   [-z]         = Compress output with GZIP.\n" \
+"   [--quality-bins BINS]\n" \
+"                = Bin the quality scores of the output (it compresses better).\n" \
+"                  BINS is 'illumina8' (Illumina's 8-level binning), or a list of\n" \
+"                  LOW-HIGH:VALUE ranges, e.g. '0-19:10,20-29:25,30-93:35'.\n" \
 "   [-i INFILE]  = FASTA/Q input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Q output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
+"   [-I INFILE2] = Paired-end mode: FASTA/Q input file of the second mates.\n" \
+"                  Both mates are trimmed, and kept or discarded together.\n" \
+"   [-O OUTFILE2]= Paired-end mode: output file of the second mates.\n" \
+"   [-P]         = Paired-end mode: interleaved files - consecutive records are mates.\n" \
+"                  Without [-I], both mates are read from INFILE.\n" \
+"                  Without [-O], both mates are written to OUTFILE.\n" \
 "\n";
 
-#define DO_NOT_TRIM_LAST_BASE (0)
-
-int keep_first_base=1;
-int keep_last_base=DO_NOT_TRIM_LAST_BASE;
-unsigned int trim_last_bases=0;
-unsigned int minimum_length=0;
-int trim_by_position=0;
-int trim_from_end=0;
+struct fastx_trimmer_options options;
 
 FASTX fastx;
+FASTX mate2;
 
 int parse_program_args(int __attribute__((unused)) optind, int optc, char* optarg)
 {
-	switch(optc) {
-	case 'f':
-		if (optarg==NULL) 
-			errx(1, "[-f] parameter requires an argument value");
-		keep_first_base = strtoul(optarg,NULL,10);
-		if (keep_first_base<=0 || keep_first_base>=MAX_SEQ_LINE_LENGTH) 
-			errx(1,"Invalid number bases to keep (-f %s)", optarg);
-		trim_by_position=1;
-		break;
-
-	case 'l':
-		if (optarg==NULL) 
-			errx(1, "[-l] parameter requires an argument value");
-		keep_last_base = strtoul(optarg,NULL,10);
-		if (keep_last_base<=0 ||  keep_last_base>=MAX_SEQ_LINE_LENGTH) 
-			errx(1,"Invalid number bases to keep (-l %s)", optarg);
-		trim_by_position=1;
-		break;
-
-	case 't':
-		if (optarg==NULL)
-			errx(1, "[-t] parameter requires an argument value");
-		trim_last_bases = strtoul(optarg,NULL,10);
-		if (trim_last_bases<=0 ||  trim_last_bases>=MAX_SEQ_LINE_LENGTH)
-			errx(1,"Invalid number bases to trim (-t %s)", optarg);
-		trim_from_end=1;
-		break;
-
-	case 'm':
-		if (optarg==NULL)
-			errx(1, "[-t] parameter requires an argument value");
-		minimum_length = strtoul(optarg,NULL,10);
-		if (minimum_length<=0 ||  minimum_length>=MAX_SEQ_LINE_LENGTH)
-			errx(1,"Invalid minimum length value (-m %s)", optarg);
-		break;
-
-	default:
+	if (!fastx_trimmer_parse_option(&options, optc, optarg))
 		errx(1, __FILE__ ":%d: Unknown argument (%c)", __LINE__, optc ) ;
-
-	}
 	return 1;
 }
 
 
 int main(int argc, char* argv[])
 {
-	size_t i;
+	const char* reads_unit;
 
+	fastx_trimmer_init_options(&options);
+	fastx_allow_paired_files();
 	fastx_parse_cmdline(argc, argv, "l:f:t:m:", parse_program_args);
 
 	//validate command line arguments
-	if (trim_by_position && trim_from_end)
-		errx(1,"[-t], [-f] and [-l] options can not be used together. Use [-t] or [-l,-f]");
-
-	fastx_init_reader(&fastx, get_input_filename(), 
-		FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE, get_fastq_ascii_quality_offset() );
+	fastx_trimmer_validate_options(&options);
 
-	fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
+	if ( paired_files_flag() ) {
+		fastx_init_paired_reader(&fastx, &mate2, get_input_filename(), get_input2_filename(),
+			FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE, get_fastq_ascii_quality_offset() );
 
-	while ( fastx_read_next_record(&fastx) ) {
+		fastx_init_paired_writer(&fastx, &mate2, get_output_filename(), get_output2_filename(),
+			OUTPUT_SAME_AS_INPUT, compress_output_flag());
 
-		if (keep_last_base != DO_NOT_TRIM_LAST_BASE) {
-			fastx.nucleotides[keep_last_base] = 0 ;
+		while ( fastx_read_next_pair(&fastx, &mate2) ) {
+			if ( fastx_trimmer_process(&fastx, &options)
+			     && fastx_trimmer_process(&mate2, &options) )
+				fastx_write_pair(&fastx, &mate2);
 		}
+		reads_unit = "read pairs";
+	} else {
+		fastx_init_reader(&fastx, get_input_filename(), 
+			FASTA_OR_FASTQ, ALLOW_N, REQUIRE_UPPERCASE, get_fastq_ascii_quality_offset() );
 
-		if (keep_first_base != 1) {
-			if ( strlen(fastx.nucleotides) < (size_t)keep_first_base ) //sequence too short - remove it
-				continue ;
-			for (i=0; i < strlen(fastx.nucleotides)-keep_first_base+1 ; i++) {
-				fastx.nucleotides[i] = fastx.nucleotides[i+keep_first_base-1];
-				fastx.quality[i] = fastx.quality[i+keep_first_base-1];
-			}
-			fastx.nucleotides[i] = 0 ;
-		}
+		fastx_init_writer(&fastx, get_output_filename(), OUTPUT_SAME_AS_INPUT, compress_output_flag());
 
-		if (trim_last_bases>0) {
-			if (strlen(fastx.nucleotides) <= trim_last_bases)
-				continue;
-			i = strlen(fastx.nucleotides) - trim_last_bases;
-			if (i < minimum_length)
-				continue;
-			fastx.nucleotides[i] = 0;
-			fastx.quality[i] = 0 ;
+		while ( fastx_read_next_record(&fastx) ) {
+			if ( fastx_trimmer_process(&fastx, &options) )
+				fastx_write_record(&fastx);
 		}
-
-		//none of the above condition matched, so print this sequence.
-		fastx_write_record(&fastx);
+		reads_unit = "reads";
 	}
 
 	if ( verbose_flag() ) {
-		if (keep_first_base!=1 || keep_last_base!=DO_NOT_TRIM_LAST_BASE)
-			fprintf(get_report_file(), "Trimming: base %d to %d\n", keep_first_base, keep_last_base ) ;
-		if (trim_last_bases) {
-			fprintf(get_report_file(), "Trimming %d bases from the end of the reads\n", trim_last_bases);
-			if ( minimum_length )
-				fprintf(get_report_file(), "Discarding reads shorter than %d bases\n", minimum_length);
+		if (options.keep_first_base!=1 || options.keep_last_base!=DO_NOT_TRIM_LAST_BASE)
+			fprintf(get_report_file(), "Trimming: base %d to %d\n", options.keep_first_base, options.keep_last_base ) ;
+		if (options.trim_last_bases) {
+			fprintf(get_report_file(), "Trimming %d bases from the end of the reads\n", options.trim_last_bases);
+			if ( options.minimum_length )
+				fprintf(get_report_file(), "Discarding reads shorter than %d bases\n", options.minimum_length);
 		}
-		fprintf(get_report_file(), "Input: %zu reads.\n", num_input_reads(&fastx) ) ;
-		fprintf(get_report_file(), "Output: %zu reads.\n", num_output_reads(&fastx) ) ;
+		fprintf(get_report_file(), "Input: %zu %s.\n", num_input_reads(&fastx), reads_unit ) ;
+		fprintf(get_report_file(), "Output: %zu %s.\n", num_output_reads(&fastx), reads_unit ) ;
 	}
+
+	fastx_report_timings();
 	return 0;
 }
@@ -50,6 +50,10 @@ const char* usage=
 "                  And the collapsed identifier (e.g. '1-1000') is on column N.\n" \
 "   [-i INFILE]  = FASTA/Tabular input file. default is STDIN.\n" \
 "   [-o OUTFILE] = FASTA/Tabular output file. default is STDOUT.\n" \
+FASTX_COMMON_OPTIONS_USAGE \
+"\n" \
+"Tabular input ([-c N]) is read and written line by line - the options from\n" \
+"[--input-list] on apply to FASTA input only.\n" \
 "\n";
 
 size_t collapsed_identifier_column = 0;
@@ -124,6 +128,11 @@ size_t extract_collapsed_read_count(const std::string& text)
 
 void uncollapse_tabular_file()
 {
+	if (fastx_default_input_range_set())
+		errx(1,"tabular input files can't be split into shards");
+	if (get_input_files_count()>1)
+		errx(1,"tabular input can't be read from multiple input files");
+
 	ios::sync_with_stdio(false);
 	size_t input_count=0;
 	size_t output_count=0;
@@ -201,5 +210,7 @@ int main(int argc, char* argv[])
 	else
 		uncollapse_tabular_file();
 
+	fastx_report_timings();
+
 	return 0;
 }
@@ -0,0 +1,193 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <string>
+#include <ostream>
+#include <iostream>
+#include <string.h>
+#include <stdlib.h>
+
+#include "fastx_error.h"
+#include "clipper_stage.h"
+
+static int adapter_cutoff_index ( const SequenceAlignmentResults& alignment_results, int minimum_adapter_length )
+{
+	int alignment_size = alignment_results.neutral_matches +
+			     alignment_results.matches + 
+			     alignment_results.mismatches +
+			     alignment_results.gaps ;
+
+	//No alignment at all?
+	if (alignment_size==0)
+		return -1;
+
+	if (minimum_adapter_length>0 && alignment_size<minimum_adapter_length)
+		return -1;
+
+	//Any good alignment at the end of the query
+	//(even only a single nucleotide)
+	//Example:
+	//  The adapter starts with CTGTAG, The Query ends with CT - it's a match.
+	if ( alignment_results.query_end == alignment_results.query_size-1
+	     &&
+	     alignment_results.mismatches == 0 ) {
+		return alignment_results.query_start ;
+	}
+
+	if ( alignment_size > 5
+	     &&
+	     alignment_results.target_start == 0
+	     &&
+	     (alignment_results.matches * 100 / alignment_size ) >= 75 ) {
+		return alignment_results.query_start ;
+	}
+
+	if ( alignment_size > 11 
+	     &&
+	     (alignment_results.matches * 100 / alignment_size ) >= 80 ) {
+		return alignment_results.query_start ;
+	}
+
+	//
+	//Be very lenient regarding alignments at the end of the query sequence
+	if ( alignment_results.query_end >= alignment_results.query_size-2
+	     &&
+	     alignment_size <= 5 && alignment_results.matches >= 3) {
+			return alignment_results.query_start ;
+		}
+
+	return -1;
+}
+
+FastxClipper::FastxClipper()
+{
+	//Default adapter - Dummy sequence
+	memset(&options, 0, sizeof(options));
+	strcpy(options.adapter, "CCTTAAGG");
+	options.min_length = 5;
+	options.discard_unknown_bases = 1;
+}
+
+int FastxClipper::parse_option(int optc, const char* optarg)
+{
+	switch(optc) {
+		case 'M':
+			if (optarg==NULL) 
+				fastx_errx(1, "[-M] parameter requires an argument value");
+			options.minimum_adapter_length = atoi(optarg);
+			if (options.minimum_adapter_length<=0) 
+				fastx_errx(1,"Invalid minimum adapter length (-M %s)", optarg);
+			break;
+
+		case 'k':
+			options.show_adapter_only=1;
+			break;
+
+		case 'D':
+			options.debug++;
+			break ;
+
+		case 'c':
+			options.discard_non_clipped = 1;
+			break;
+
+		case 'C':
+			options.discard_clipped = 1 ;
+			break ;
+		case 'd':
+			if (optarg==NULL) 
+				fastx_errx(1, "[-d] parameter requires an argument value");
+			options.keep_delta = strtoul(optarg,NULL,10);
+			if (options.keep_delta<0) 
+				fastx_errx(1,"Invalid number bases to keep (-d %s)", optarg);
+			break;
+		case 'a':
+			if (optarg==NULL) 
+				fastx_errx(1, "[-a] parameter requires an argument value");
+			strncpy(options.adapter,optarg,sizeof(options.adapter)-1);
+			//TODO:
+			//if (!valid_sequence_string(adapter)) 
+			//	fastx_errx(1,"Invalid adapter string (-a %s)", adapter);
+			break ;
+			
+		case 'l':
+			if (optarg==NULL) 
+				fastx_errx(1,"[-l] parameter requires an argument value");
+			
+			options.min_length = strtoul(optarg, NULL, 10);
+			break;
+			
+		case 'n':
+			options.discard_unknown_bases = 0 ;
+			break;
+
+		default:
+			return 0;
+	}
+	return 1;
+}
+
+void FastxClipper::finalize_options()
+{
+	if (options.keep_delta>0) 
+		options.keep_delta += strlen(options.adapter);
+}
+
+CLIPPER_RESULT FastxClipper::process(FASTX *pFASTX)
+{
+	int i;
+	size_t length;
+
+	std::string query = std::string(fastx_view_nucleotides(pFASTX), fastx_view_length(pFASTX)) ;
+	std::string target= std::string(options.adapter);
+
+	align.align( query, target ) ;
+
+	if (options.debug>1) 
+		align.print_matrix();
+	if (options.debug>0)
+		align.results().print();
+
+	//Find the best match with the adapter
+	i = adapter_cutoff_index ( align.results(), options.minimum_adapter_length ) ;
+
+	if (i>0) {
+		i += options.keep_delta;
+		//Just trim the string after this position
+		length = fastx_view_length(pFASTX);
+		if ( (size_t)i < length )
+			fastx_trim_end(pFASTX, length - i);
+	}
+
+	if (i==0) // empty sequence ? (in which the adapter was found at index 0)
+		return CLIPPER_ADAPTER_ONLY;
+
+	if (fastx_view_length(pFASTX) < options.min_length) // too-short sequence ?
+		return CLIPPER_TOO_SHORT;
+
+	if ( (i==-1) && options.discard_non_clipped ) // adapter not found (i.e. sequence was not clipped) ?
+		return CLIPPER_NO_ADAPTER;
+
+	if ( (i>0) && options.discard_clipped ) // adapter found, and user requested to keep only non-clipped sequences 
+		return CLIPPER_ADAPTER_FOUND;
+
+	if ( options.discard_unknown_bases && 
+	     memchr(fastx_view_nucleotides(pFASTX),'N',fastx_view_length(pFASTX))!=NULL ) // contains unknown bases (after clipping) ?
+		return CLIPPER_UNKNOWN_BASES;
+
+	return CLIPPER_KEEP;
+}
@@ -0,0 +1,88 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __CLIPPER_STAGE_H__
+#define __CLIPPER_STAGE_H__
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <iostream>
+
+#include "sequence_alignment.h"
+#include "fastx.h"
+
+/*
+	The record logic of fastx_clipper, shared between the
+	stand-alone program and fastx_pipeline.
+
+	Like the other stages (see fastx_stages.h), the adapter is searched
+	for in the record's current view, and the view is clipped in place.
+*/
+
+#define MAX_ADAPTER_LEN 100
+
+struct fastx_clipper_options
+{
+	char adapter[MAX_ADAPTER_LEN];
+	unsigned int min_length;
+	int discard_unknown_bases;
+	int keep_delta;
+	int discard_non_clipped;
+	int discard_clipped;
+	int show_adapter_only;
+	int debug;
+	int minimum_adapter_length;
+};
+
+typedef enum {
+	CLIPPER_KEEP = 0,
+	CLIPPER_ADAPTER_ONLY,		// adapter found at index zero (empty sequence after clipping)
+	CLIPPER_TOO_SHORT,		// see [-l N]
+	CLIPPER_NO_ADAPTER,		// see [-c]
+	CLIPPER_ADAPTER_FOUND,		// see [-C]
+	CLIPPER_UNKNOWN_BASES		// see [-n]
+} CLIPPER_RESULT;
+
+class FastxClipper
+{
+	HalfLocalSequenceAlignment align;
+
+public:
+	struct fastx_clipper_options options;
+
+	FastxClipper();
+
+	// Accepts fastx_clipper's option letters, returns 0 for unknown options.
+	int parse_option(int optc, const char* optarg);
+
+	// Call once, after all the options were parsed.
+	void finalize_options();
+
+	CLIPPER_RESULT process(FASTX *pFASTX);
+
+	// Should a record be written? adapter-only records are written
+	// instead of the clipped records when [-k] is used.
+	bool keep(CLIPPER_RESULT result) const
+	{
+		if (options.show_adapter_only)
+			return result == CLIPPER_ADAPTER_ONLY;
+		return result == CLIPPER_KEEP;
+	}
+};
+
+#endif
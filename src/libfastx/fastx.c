@@ -15,18 +15,30 @@
     You should have received a copy of the GNU Affero General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
-#include <err.h>
 #include <string.h>
+#include <errno.h>
+#include <err.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/wait.h>
+#include <sys/uio.h>
 #include <fcntl.h>
 
 
+#include "fastx_error.h"
 #include "chomp.h"
 #include "fastx.h"
+#include "fastx_store.h"
+#include "fastx_chunks.h"
+#include "fastx_aio.h"
+#include "fastx_iotune.h"
+#include "fastx_timers.h"
+#include "fastx_metrics.h"
 
 /*
 	valid_sequence_string - 
@@ -58,7 +70,7 @@ static void create_lookup_table(FASTX *pFASTX)
 	int i;
 
 	for (i=0; i<256; i++)
-		pFASTX->allowed_nucleotides[i] = 0 ;
+		pFASTX->allowed_nucleotides[i] = pFASTX->allow_any_base && i>' ' && i<127 ;
 
 	pFASTX->allowed_nucleotides['A'] = 1;
 	pFASTX->allowed_nucleotides['C'] = 1;
@@ -83,6 +95,496 @@ static void create_lookup_table(FASTX *pFASTX)
 	}
 }
 
+#define GZIP_MAGIC_BYTE (0x1f)
+
+/*
+	Runs in a child process: feeds the input stream (including anything
+	already read into its stdio buffer) to "gzip -dc", whose output goes
+	to 'output_fd'. Exits with GZIP's exit code.
+*/
+static void run_input_decompressor(FILE* input, int output_fd)
+{
+	char buffer[65536];
+	int compressed[2];
+	pid_t gzip_pid;
+	size_t count, offset;
+	ssize_t rc;
+	int status;
+
+	if (pipe(compressed)!=0)
+		fastx_err(1,"pipe (for gzip) failed");
+	fastx_iotune_pipe_size(compressed[1]);
+
+	gzip_pid = fork();
+	if (gzip_pid==-1)
+		fastx_err(1,"fork (for gzip) failed");
+	if (gzip_pid==0) {
+		dup2(compressed[0], STDIN_FILENO);
+		dup2(output_fd, STDOUT_FILENO);
+		close(compressed[0]);
+		close(compressed[1]);
+		close(output_fd);
+		execlp("gzip","gzip","-dc",(char*)NULL);
+		fastx_err(1,"execlp(gzip) failed");
+	}
+	close(compressed[0]);
+	close(output_fd);
+
+	while ( (count = fread(buffer, 1, sizeof(buffer), input)) > 0 ) {
+		for (offset=0; offset<count; offset+=rc) {
+			rc = write(compressed[1], buffer+offset, count-offset);
+			if (rc==-1)
+				_exit(1); //GZIP terminated early - its exit code is reported below
+		}
+	}
+	close(compressed[1]);
+
+	if (waitpid(gzip_pid, &status, 0)==-1 || !WIFEXITED(status))
+		_exit(1);
+	_exit(WEXITSTATUS(status));
+}
+
+static void open_input_decompressor(FASTX *pFASTX)
+{
+	int decompressed[2];
+	pid_t child_pid;
+
+	if (pipe(decompressed)!=0)
+		fastx_err(1,"pipe (for gzip) failed");
+
+	//The compressed file is read whole
+	fastx_iotune_input_fd(fileno(pFASTX->input), 0);
+
+	child_pid = fork();
+	if (child_pid==-1)
+		fastx_err(1,"fork (for gzip) failed");
+	if (child_pid==0) {
+		fastx_error_forked_child();
+		close(decompressed[0]);
+		run_input_decompressor(pFASTX->input, decompressed[1]);
+	}
+
+	close(decompressed[1]);
+	fclose(pFASTX->input);
+	free(pFASTX->input_buffer);
+	pFASTX->input_buffer = NULL;
+	pFASTX->input = NULL;
+	if (pFASTX->options.async_io) {
+		pFASTX->input = fastx_aio_open_input(decompressed[0], 0, pFASTX->options.io_buffer_size);
+		if (pFASTX->input!=NULL)
+			close(decompressed[0]);
+	}
+	if (pFASTX->input==NULL) {
+		pFASTX->input = fdopen(decompressed[0], "r");
+		if (pFASTX->input==NULL)
+			fastx_err(1,"fdopen failed");
+		pFASTX->input_buffer = fastx_iotune_set_buffer(pFASTX->input,
+			pFASTX->options.io_buffer_size, pFASTX->options.huge_pages, 0);
+	}
+	pFASTX->input_decompressor_pid = child_pid;
+}
+
+// Called on end-of-file: fail if the input was truncated or corrupted
+static void check_input_decompressor(FASTX *pFASTX)
+{
+	int status;
+
+	if (pFASTX->input_decompressor_pid<=0)
+		return;
+	if (waitpid(pFASTX->input_decompressor_pid, &status, 0)==-1)
+		return; //already reaped (the other mate of an interleaved file)
+	pFASTX->input_decompressor_pid = 0 ;
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status)!=0)
+		fastx_errx(1,"failed to decompress GZIP input file (%s)", pFASTX->input_file_name);
+}
+
+/*
+	Binary read store input - the store is mmap'd, and records are
+	unpacked from it without any parsing or validation.
+*/
+static void open_input_store(FASTX *pFASTX)
+{
+	FASTX_STORE *store;
+	int flags;
+
+	if (pFASTX->input_decompressor_pid>0)
+		fastx_errx(1,"binary read store (%s) can't be compressed", pFASTX->input_file_name);
+
+	store = fastx_store_open_fd(fileno(pFASTX->input), pFASTX->input_file_name);
+	flags = store->header->flags;
+
+	pFASTX->read_fastq = (flags & FASTX_STORE_FASTQ) ? 1 : 0 ;
+	pFASTX->read_fastq_ascii = (flags & FASTX_STORE_FASTQ_ASCII) ? 1 : 0 ;
+
+	if ( pFASTX->read_fastq && pFASTX->allow_input_filetype==FASTA_ONLY )
+		fastx_errx(1,"input file (%s) is FASTQ, but only FASTA input is allowed.",
+			pFASTX->input_file_name);
+	if ( !pFASTX->read_fastq && pFASTX->allow_input_filetype==FASTQ_ONLY )
+		fastx_errx(1,"input file (%s) is FASTA, but only FASTQ input is allowed.",
+			pFASTX->input_file_name);
+	if ( (flags & FASTX_STORE_HAS_N) && !pFASTX->allow_N && !pFASTX->allow_any_base )
+		fastx_errx(1,"input file (%s) contains 'N' bases, which are not allowed.",
+			pFASTX->input_file_name);
+	if ( pFASTX->read_fastq
+	     && store->header->fastq_ascii_quality_offset != pFASTX->fastq_ascii_quality_offset )
+		fastx_errx(1,"input file (%s) was stored with quality offset %d, use '-Q %d'",
+			pFASTX->input_file_name,
+			store->header->fastq_ascii_quality_offset,
+			store->header->fastq_ascii_quality_offset);
+
+	pFASTX->store = store;
+}
+
+static int read_store_record(FASTX *pFASTX)
+{
+	FASTX_STORE *store = pFASTX->store;
+	FASTX_STORE_RECORD view;
+	size_t length;
+
+	if (store->next_record >= fastx_store_records_count(store))
+		return 0;
+	if (pFASTX->input_range_end>=0 && store->next_record >= (size_t)pFASTX->input_range_end)
+		return 0;
+	fastx_store_get_record(store, store->next_record++, &view);
+
+	pFASTX->input_line_number += pFASTX->read_fastq ? 4 : 2 ;
+
+	pFASTX->input_sequence_id_prefix[0] = pFASTX->read_fastq ? '@' : '>' ;
+	length = strlen(view.name);
+	if (length > MAX_SEQ_LINE_LENGTH)
+		length = MAX_SEQ_LINE_LENGTH;
+	memcpy(pFASTX->name, view.name, length);
+	pFASTX->name[length] = 0 ;
+
+	fastx_store_unpack_sequence(&view, pFASTX->nucleotides);
+	pFASTX->sequence_length = view.length;
+	pFASTX->view_start = 0 ;
+	pFASTX->view_end = view.length;
+
+	if (pFASTX->read_fastq) {
+		pFASTX->input_name2_prefix[0] = '+' ;
+		length = strlen(view.name2);
+		if (length > MAX_SEQ_LINE_LENGTH)
+			length = MAX_SEQ_LINE_LENGTH;
+		memcpy(pFASTX->name2, view.name2, length);
+		pFASTX->name2[length] = 0 ;
+
+		fastx_store_unpack_quality(&view, pFASTX->quality);
+		pFASTX->quality_decoded = 1 ;
+		pFASTX->raw_quality = NULL;
+		pFASTX->raw_quality_length = 0 ;
+
+		if (pFASTX->copy_input_fastq_format_to_output)
+			pFASTX->write_fastq_ascii = pFASTX->read_fastq_ascii;
+	}
+
+	pFASTX->num_input_sequences++;
+	pFASTX->num_input_reads += get_reads_count(pFASTX);
+
+	//The store's bytes: names, packed bases, N-mask and quality scores
+	if (fastx_timers.enabled)
+		fastx_timers.bytes_in += strlen(view.name) + strlen(view.name2) + 2
+			+ (view.length+3)/4 + (view.length+7)/8
+			+ (pFASTX->read_fastq ? view.length : 0) ;
+
+	return 1;
+}
+
+/*
+	Default reader/writer options - see fastx_init_reader().
+*/
+static FASTX_IO_OPTIONS default_io_options = { 0, 0, 0, -1, 1, NULL, NULL, 0, FASTX_FIELD_QUALITY, 0,
+			FASTX_IO_BUFFER_SIZE, 0 } ;
+
+void fastx_init_io_options(FASTX_IO_OPTIONS *options)
+{
+	memset(options, 0, sizeof(FASTX_IO_OPTIONS));
+	options->range_end = -1 ;
+	options->reader_threads = 1 ;
+	options->record_fields = FASTX_FIELD_QUALITY ;
+	options->io_buffer_size = FASTX_IO_BUFFER_SIZE ;
+}
+
+void fastx_set_io_options_record_fields(FASTX_IO_OPTIONS *options, unsigned int fields)
+{
+	options->record_fields = fields;
+}
+
+void fastx_set_default_record_fields(unsigned int fields)
+{
+	fastx_set_io_options_record_fields(&default_io_options, fields);
+}
+
+void fastx_set_default_io_options(const FASTX_IO_OPTIONS *options)
+{
+	default_io_options = *options;
+}
+
+/*
+	Input ranges (sharding) - see fastx_set_default_input_shard().
+*/
+void fastx_set_io_options_shard(FASTX_IO_OPTIONS *options, unsigned int index, unsigned int count)
+{
+	if (count==0 || index<1 || index>count)
+		fastx_errx(1,"invalid shard %u/%u (expecting I/N, with 1 <= I <= N)", index, count);
+	options->shard_index = index;
+	options->shard_count = count;
+}
+
+void fastx_set_io_options_byte_range(FASTX_IO_OPTIONS *options, off_t start, off_t end)
+{
+	if (start<0 || end<=start)
+		fastx_errx(1,"invalid byte range %lld:%lld (expecting START:END, with START < END)",
+			(long long)start, (long long)end);
+	options->range_start = start;
+	options->range_end = end;
+}
+
+int fastx_io_options_range_set(const FASTX_IO_OPTIONS *options)
+{
+	return (options->shard_count>0 || options->range_end>=0);
+}
+
+void fastx_set_default_input_shard(unsigned int index, unsigned int count)
+{
+	fastx_set_io_options_shard(&default_io_options, index, count);
+}
+
+void fastx_set_default_input_byte_range(off_t start, off_t end)
+{
+	fastx_set_io_options_byte_range(&default_io_options, start, end);
+}
+
+int fastx_default_input_range_set()
+{
+	return fastx_io_options_range_set(&default_io_options);
+}
+
+/*
+	Reads one line, returns its first character (or -1 on EOF).
+	Used only to find the first record of a range - the line can be longer
+	than MAX_SEQ_LINE_LENGTH.
+*/
+static int skip_input_line(FILE *input)
+{
+	int first, c;
+
+	first = c = getc(input);
+	while (c!='\n' && c!=EOF)
+		c = getc(input);
+	return first;
+}
+
+/*
+	Positions the input stream on the first record which starts at
+	(or after) 'start'.
+
+	A FASTA record starts with a '>' line.
+	A FASTQ record starts with an '@' line, followed two lines later by a
+	'+' line. An ASCII quality line can start with '@' too, but two lines
+	later comes the next record's nucleotides line - so it is never
+	mistaken for a record.
+*/
+static void seek_input_range_start(FASTX *pFASTX, off_t start)
+{
+	off_t line_offset[3];
+	int first_char[3];
+	int lines = 0 ;
+	int i;
+
+	//A record which starts exactly at 'start' belongs to this range,
+	//so look for a line starting after 'start-1'.
+	if (start>0) {
+		if (fseeko(pFASTX->input, start-1, SEEK_SET)!=0)
+			fastx_err(1,"failed to seek in input file '%s'", pFASTX->input_file_name);
+		skip_input_line(pFASTX->input);
+	} else {
+		if (fseeko(pFASTX->input, 0, SEEK_SET)!=0)
+			fastx_err(1,"failed to seek in input file '%s'", pFASTX->input_file_name);
+	}
+
+	while (1) {
+		//Keep the last three lines (of which the record might start at the first)
+		i = lines % 3 ;
+		line_offset[i] = ftello(pFASTX->input);
+		first_char[i] = skip_input_line(pFASTX->input);
+		lines++;
+
+		if (first_char[i]==EOF)
+			return;
+
+		if (!pFASTX->read_fastq && first_char[i]=='>') {
+			if (fseeko(pFASTX->input, line_offset[i], SEEK_SET)!=0)
+				fastx_err(1,"failed to seek in input file '%s'", pFASTX->input_file_name);
+			return;
+		}
+
+		i = (lines-3) % 3 ;
+		if (pFASTX->read_fastq && lines>=3 && first_char[i]=='@'
+		    && first_char[(i+2)%3]=='+') {
+			if (fseeko(pFASTX->input, line_offset[i], SEEK_SET)!=0)
+				fastx_err(1,"failed to seek in input file '%s'", pFASTX->input_file_name);
+			return;
+		}
+	}
+}
+
+static void set_input_range(FASTX *pFASTX)
+{
+	struct stat st;
+	off_t start, end;
+	size_t records;
+
+	pFASTX->input_range_end = -1 ;
+	if (!fastx_io_options_range_set(&pFASTX->options))
+		return;
+
+	if (pFASTX->options.shard_count>0 && pFASTX->options.range_end>=0)
+		fastx_errx(1,"--shard and --byte-range can't be used together");
+
+	if (pFASTX->store!=NULL) {
+		//Binary read store - split by record numbers
+		if (pFASTX->options.range_end>=0)
+			fastx_errx(1,"binary read store (%s) can't be split by bytes, use --shard",
+				pFASTX->input_file_name);
+		records = fastx_store_records_count(pFASTX->store);
+		pFASTX->store->next_record = (size_t)(
+			(unsigned long long)records * (pFASTX->options.shard_index-1)
+				/ pFASTX->options.shard_count );
+		pFASTX->input_range_end = (off_t)(
+			(unsigned long long)records * pFASTX->options.shard_index
+				/ pFASTX->options.shard_count );
+		return;
+	}
+
+	if (pFASTX->input_decompressor_pid>0)
+		fastx_errx(1,"compressed input file (%s) can't be split into shards",
+			pFASTX->input_file_name);
+	if (fstat(fileno(pFASTX->input), &st)!=0)
+		fastx_err(1,"failed to stat input file '%s'", pFASTX->input_file_name);
+	if (!S_ISREG(st.st_mode))
+		fastx_errx(1,"input file (%s) can't be split into shards (not a regular file)",
+			pFASTX->input_file_name);
+
+	if (pFASTX->options.shard_count>0) {
+		start = (off_t)( (unsigned long long)st.st_size
+				* (pFASTX->options.shard_index-1) / pFASTX->options.shard_count );
+		end = (off_t)( (unsigned long long)st.st_size
+				* pFASTX->options.shard_index / pFASTX->options.shard_count );
+	} else {
+		start = pFASTX->options.range_start;
+		end = pFASTX->options.range_end;
+	}
+
+	seek_input_range_start(pFASTX, start);
+	pFASTX->input_range_end = end;
+}
+
+void fastx_set_io_options_reader_threads(FASTX_IO_OPTIONS *options, unsigned int threads)
+{
+	if (threads==0)
+		fastx_errx(1,"invalid number of reader threads (%u)", threads);
+	options->reader_threads = threads;
+}
+
+void fastx_set_default_reader_threads(unsigned int threads)
+{
+	fastx_set_io_options_reader_threads(&default_io_options, threads);
+}
+
+void fastx_set_io_options_async_io(FASTX_IO_OPTIONS *options, int async_io)
+{
+	options->async_io = async_io;
+}
+
+void fastx_set_default_async_io(int async_io)
+{
+	fastx_set_io_options_async_io(&default_io_options, async_io);
+}
+
+void fastx_set_io_options_io_buffers(FASTX_IO_OPTIONS *options, size_t size, int huge_pages)
+{
+	options->io_buffer_size = size;
+	options->huge_pages = huge_pages;
+}
+
+void fastx_set_default_io_buffers(size_t size, int huge_pages)
+{
+	fastx_set_io_options_io_buffers(&default_io_options, size, huge_pages);
+}
+
+/*
+	Asynchronous input (see fastx_aio.h) - continue reading a regular
+	file from the current position with an io_uring stream.
+	Files read by the chunked reader (or mmap'd stores) are left alone.
+*/
+static void start_async_input(FASTX *pFASTX)
+{
+	struct stat st;
+	FILE *input;
+	off_t offset;
+
+	if (!pFASTX->options.async_io || pFASTX->chunks!=NULL || pFASTX->store!=NULL
+	    || pFASTX->input_decompressor_pid>0)
+		return;
+	if (fstat(fileno(pFASTX->input), &st)!=0 || !S_ISREG(st.st_mode)
+	    || (offset = ftello(pFASTX->input)) < 0)
+		return;
+
+	//The stdio buffer was reported with the same size (unless it's the default)
+	input = fastx_aio_open_input(fileno(pFASTX->input), offset,
+			pFASTX->options.io_buffer_size);
+	if (input==NULL)
+		return;
+
+	if (pFASTX->input!=stdin)
+		fclose(pFASTX->input);
+	free(pFASTX->input_buffer);
+	pFASTX->input_buffer = NULL;
+	pFASTX->input = input;
+}
+
+static void start_chunk_reader(FASTX *pFASTX)
+{
+	struct stat st;
+
+	if (pFASTX->options.reader_threads<=1)
+		return;
+	if (pFASTX->store!=NULL || pFASTX->input_decompressor_pid>0)
+		return;
+	if (fstat(fileno(pFASTX->input), &st)!=0 || !S_ISREG(st.st_mode))
+		return;
+
+	pFASTX->chunks = fastx_chunk_reader_new(pFASTX, ftello(pFASTX->input),
+				pFASTX->input_range_end, pFASTX->options.reader_threads);
+}
+
+/*
+	Tell the run metrics (see fastx_metrics.h) how many input bytes this
+	reader will parse (known only for uncompressed regular files).
+*/
+static void report_input_size(FASTX *pFASTX)
+{
+	struct stat st;
+	off_t start, end;
+
+	if (!fastx_metrics.enabled)
+		return;
+
+	if (pFASTX->store!=NULL || pFASTX->input_decompressor_pid>0
+	    || fstat(fileno(pFASTX->input), &st)!=0 || !S_ISREG(st.st_mode)
+	    || (start = ftello(pFASTX->input)) < 0) {
+		fastx_metrics_add_input_size(-1);
+		return;
+	}
+
+	end = st.st_size;
+	if (pFASTX->input_range_end>=0 && pFASTX->input_range_end < end)
+		end = pFASTX->input_range_end;
+	fastx_metrics_add_input_size( (end>start) ? end-start : 0 );
+}
+
 static void detect_input_format(FASTX *pFASTX)
 {
 	//Get the first character in the file,
@@ -93,41 +595,53 @@ static void detect_input_format(FASTX *pFASTX)
 	switch(c) {
 	case '>':	/* FASTA file */
 		if ( pFASTX->allow_input_filetype==FASTQ_ONLY )
-			errx(1,"input file (%s) is FASTA, but only FASTQ input is allowed.", 
+			fastx_errx(1,"input file (%s) is FASTA, but only FASTQ input is allowed.", 
 				pFASTX->input_file_name);
 		pFASTX->read_fastq = 0 ;
 		break;
 
 	case '@':	/* FASTQ file */
 		if ( pFASTX->allow_input_filetype==FASTA_ONLY )
-			errx(1,"input file (%s) is FASTQ, but only FASTA input is allowed.", 
+			fastx_errx(1,"input file (%s) is FASTQ, but only FASTA input is allowed.", 
 				pFASTX->input_file_name);
 		pFASTX->read_fastq = 1;	
 		break;
 	
+	case GZIP_MAGIC_BYTE:	/* GZIP compressed file - decompress, and detect again */
+		if (pFASTX->input_decompressor_pid>0)
+			fastx_errx(1,"input file (%s) is compressed more than once", pFASTX->input_file_name);
+		open_input_decompressor(pFASTX);
+		detect_input_format(pFASTX);
+		break;
+
+	case FASTX_STORE_MAGIC_BYTE:	/* Binary read store */
+		open_input_store(pFASTX);
+		break;
+
 	case -1:   /* EOF as first character - no input */
-		errx(1, "Premature End-Of-File (filename ='%s')", pFASTX->input_file_name);
+		check_input_decompressor(pFASTX);
+		fastx_errx(1, "Premature End-Of-File (filename ='%s')", pFASTX->input_file_name);
 		break; 
 
 	default:
-		errx(1, "input file (%s) has unknown file format (not FASTA or FASTQ), first character = %c (%d)", 
+		fastx_errx(1, "input file (%s) has unknown file format (not FASTA or FASTQ), first character = %c (%d)", 
 			pFASTX->input_file_name, c,c);
 	}
 }
 
-static void convert_ascii_quality_score_line(const char* ascii_quality_scores, FASTX *pFASTX)
+static void convert_ascii_quality_score_line(const char* ascii_quality_scores, size_t length, FASTX *pFASTX)
 {
 	size_t i;
 
-	if (strlen(ascii_quality_scores) != strlen(pFASTX->nucleotides))
-		errx(1,"number of quality values (%zu) doesn't match number of nucleotides (%zu) on line %lld",
-				strlen(ascii_quality_scores), strlen(pFASTX->nucleotides),
+	if (length != pFASTX->sequence_length)
+		fastx_errx(1,"number of quality values (%zu) doesn't match number of nucleotides (%zu) on line %lld",
+				length, pFASTX->sequence_length,
 				pFASTX->input_line_number);
 
-	for (i=0; i<strlen(ascii_quality_scores); i++) {
+	for (i=0; i<length; i++) {
 		pFASTX->quality[i] = (int) (ascii_quality_scores[i] - pFASTX->fastq_ascii_quality_offset ) ;
 		if (pFASTX->quality[i] < MIN_QUALITY_VALUE || pFASTX->quality[i] > MAX_QUALITY_VALUE)
-			errx(1, "Invalid quality score value (char '%c' ord %d quality value %d) on line %lld",
+			fastx_errx(1, "Invalid quality score value (char '%c' ord %d quality value %d) on line %lld",
 				ascii_quality_scores[i], ascii_quality_scores[i],
 				pFASTX->quality[i], pFASTX->input_line_number );
 	}
@@ -147,11 +661,11 @@ static void convert_numeric_quality_score_line ( const char* numeric_quality_lin
 		//read the quality score as an integer value
 		quality_value = strtol(quality_tok, &endptr, 10);
 		if (endptr == quality_tok) 
-			errx(1,"Error: invalid quality score data on line %lld (quality_tok = \"%s\"", 
+			fastx_errx(1,"Error: invalid quality score data on line %lld (quality_tok = \"%s\"", 
 				pFASTX->input_line_number ,quality_tok);
 
 		if (quality_value > 93 || quality_value < -15)
-			errx(1, "invalid quality score value (%d) in line %lld.", 
+			fastx_errx(1, "invalid quality score value (%d) in line %lld.", 
 				quality_value, pFASTX->input_line_number);
 		
 		//convert it ASCII (as per solexa's encoding)
@@ -161,41 +675,172 @@ static void convert_numeric_quality_score_line ( const char* numeric_quality_lin
 	} while (quality_tok != NULL && *quality_tok!='\0') ;
 
 	if (index != strlen(pFASTX->nucleotides)) {
-		errx(1,"number of quality values (%zu) doesn't match number of nucleotides (%zu) on line %lld",
+		fastx_errx(1,"number of quality values (%zu) doesn't match number of nucleotides (%zu) on line %lld",
 				index, strlen(pFASTX->nucleotides), pFASTX->input_line_number );
 	}
 }
 
+void fastx_decode_quality(FASTX *pFASTX)
+{
+	if (pFASTX->quality_decoded || !pFASTX->read_fastq)
+		return;
+
+	if (pFASTX->read_fastq_ascii)
+		convert_ascii_quality_score_line(pFASTX->raw_quality, pFASTX->raw_quality_length, pFASTX);
+	else
+		//Numeric quality lines are always read into 'raw_quality_buffer' (NULL-terminated)
+		convert_numeric_quality_score_line(pFASTX->raw_quality_buffer, pFASTX);
+	pFASTX->quality_decoded = 1 ;
+}
+
+static void open_input_stream(FASTX *pFASTX, FILE* input, const char* name)
+{
+	off_t offset;
+
+	pFASTX->input = input;
+	strncpy(pFASTX->input_file_name, name, sizeof(pFASTX->input_file_name)-1);
+
+	detect_input_format(pFASTX);
+
+	set_input_range(pFASTX);
+
+	//Sequential read hints (files), or a larger pipe
+	if (pFASTX->store==NULL && fileno(pFASTX->input)>=0) {
+		offset = ftello(pFASTX->input);
+		fastx_iotune_input_fd(fileno(pFASTX->input), (offset>0) ? offset : 0);
+	}
+
+	report_input_size(pFASTX);
+
+	start_chunk_reader(pFASTX);
+
+	start_async_input(pFASTX);
+}
+
+static void open_input_file(FASTX *pFASTX, const char* filename)
+{
+	FILE* input;
+
+	if (strncmp(filename,"-",1)==0) {
+		input = stdin;	
+	} else {
+		input = fopen(filename, "r");
+		if (input==NULL)
+			fastx_err(1, "failed to open input file '%s'", filename);
+	}
+	pFASTX->input_buffer = fastx_iotune_set_buffer(input, pFASTX->options.io_buffer_size,
+					pFASTX->options.huge_pages, 0);
+
+	open_input_stream(pFASTX, input, filename);
+}
+
+/*
+	Multiple input files - at the end of each file, fill in its statistics
+	and continue with the next file.
+	Returns 1 if the next file was opened, 0 if there are no more files.
+*/
+static int open_next_input_file(FASTX *pFASTX)
+{
+	FASTX_INPUT_FILE *file;
+	int read_fastq = pFASTX->read_fastq;
+
+	if (pFASTX->options.input_files==NULL
+	    || pFASTX->input_file_index >= pFASTX->options.input_files_count)
+		return 0;
+
+	file = &pFASTX->options.input_files[pFASTX->input_file_index];
+	file->sequences = pFASTX->num_input_sequences - pFASTX->input_file_first_sequence;
+	file->reads = pFASTX->num_input_reads - pFASTX->input_file_first_read;
+
+	pFASTX->input_file_index++;
+	if (pFASTX->input_file_index == pFASTX->options.input_files_count)
+		return 0;
+
+	fastx_close_reader(pFASTX);
+
+	file++;
+	memset(pFASTX->input_file_name, 0, sizeof(pFASTX->input_file_name));
+	pFASTX->input_line_number = 0 ;
+	pFASTX->input_file_first_sequence = pFASTX->num_input_sequences;
+	pFASTX->input_file_first_read = pFASTX->num_input_reads;
+	pFASTX->read_fastq = 0 ;
+	open_input_file(pFASTX, file->filename);
+
+	if (pFASTX->read_fastq != read_fastq)
+		fastx_errx(1,"input file (%s) is %s, but the previous input files are %s",
+			file->filename, pFASTX->read_fastq ? "FASTQ" : "FASTA",
+			read_fastq ? "FASTQ" : "FASTA");
+	return 1;
+}
+
 void fastx_init_reader(FASTX *pFASTX, const char* filename, 
 		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
 		ALLOWED_INPUT_BASES allow_bases,
 		ALLOWED_INPUT_CASE allow_lowercase,
 		int fastq_ascii_quality_offset)
+{
+	fastx_init_reader_with_options(pFASTX, filename, allowed_input_filetype,
+			allow_bases, allow_lowercase, fastq_ascii_quality_offset,
+			&default_io_options);
+}
+
+static void init_reader(FASTX *pFASTX,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset,
+		const FASTX_IO_OPTIONS *options)
 {
 	if (pFASTX==NULL)
-		errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
+		fastx_errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
 
 	memset(pFASTX, 0, sizeof(FASTX));
-
-	if (strncmp(filename,"-",1)==0) {
-		pFASTX->input = stdin;	
-	} else {
-		pFASTX->input = fopen(filename, "r");
-		if (pFASTX->input==NULL)
-			err(1, "failed to open input file '%s'", filename);
-	}
-
-	strncpy(pFASTX->input_file_name, filename, sizeof(pFASTX->input_file_name)-1);
+	pFASTX->options = *options;
 
 	pFASTX->allow_input_filetype = allowed_input_filetype;
 	pFASTX->allow_lowercase = allow_lowercase;
 	pFASTX->allow_N = ((allow_bases & ALLOW_N)!=0) ;
 	pFASTX->allow_U = ((allow_bases & ALLOW_U)!=0) ;
+	pFASTX->allow_any_base = ((allow_bases & ALLOW_ANY_BASE)!=0) ;
 	pFASTX->fastq_ascii_quality_offset = fastq_ascii_quality_offset ;
 
 	create_lookup_table(pFASTX);
+}
 
-	detect_input_format(pFASTX);
+void fastx_init_reader_with_options(FASTX *pFASTX, const char* filename,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset,
+		const FASTX_IO_OPTIONS *options)
+{
+	init_reader(pFASTX, allowed_input_filetype, allow_bases, allow_lowercase,
+			fastq_ascii_quality_offset, options);
+
+	//Only the reader of the first input file continues with the others
+	if (pFASTX->options.input_files!=NULL
+	    && strcmp(filename, pFASTX->options.input_files[0].filename)!=0) {
+		pFASTX->options.input_files = NULL;
+		pFASTX->options.input_files_count = 0 ;
+	}
+
+	open_input_file(pFASTX, filename);
+}
+
+void fastx_init_stream_reader(FASTX *pFASTX, FILE* input, const char* name,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset,
+		const FASTX_IO_OPTIONS *options)
+{
+	init_reader(pFASTX, allowed_input_filetype, allow_bases, allow_lowercase,
+			fastq_ascii_quality_offset, options);
+
+	pFASTX->options.input_files = NULL;
+	pFASTX->options.input_files_count = 0 ;
+
+	open_input_stream(pFASTX, input, name);
 }
 
 int open_output_file(const char* filename)
@@ -206,28 +851,30 @@ int open_output_file(const char* filename)
 	} else {
 		fd = open(filename, O_CREAT | O_WRONLY | O_TRUNC, 0666 );
 		if (fd==-1)
-			err(1, "Failed to create output file (%s)", filename);
+			fastx_err(1, "Failed to create output file (%s)", filename);
 	}
 	return fd;
 }
 
-int open_output_compressor(FASTX __attribute__((unused)) *pFASTX, const char* filename)
+int open_output_compressor(FASTX *pFASTX, const char* filename)
 {
 	int fd;
 	pid_t child_pid;
 	int parent_pipe[2];
 	if (pipe(parent_pipe)!=0)
-		err(1,"pipe (for gzip) failed");
+		fastx_err(1,"pipe (for gzip) failed");
 		
 	child_pid = fork();
 	if (child_pid>0) {
 		/* The parent process */
 		fd = parent_pipe[1];
 		close(parent_pipe[0]);
+		pFASTX->output_compressor_pid = child_pid;
 		return fd;
 	}
 
 	/* The child process */
+	fastx_error_forked_child();
 
 	//the compressor's STDIN is the pipe from the parent
 	dup2(parent_pipe[0], STDIN_FILENO);
@@ -237,38 +884,85 @@ int open_output_compressor(FASTX __attribute__((unused)) *pFASTX, const char* fi
 	//(which can be the parent's STDOUT, too)
 	fd = open_output_file(filename);
 	dup2(fd, STDOUT_FILENO);
+	fastx_iotune_pipe_size(STDOUT_FILENO);
 	
 	//Run GZIP
 	execlp("gzip","gzip",(char*)NULL);
 
 	//Should never get here...
-	err(1,"execlp(gzip) failed");
+	fastx_err(1,"execlp(gzip) failed");
 
 	return 0; //just to please the compiler
 }
 
 
-void fastx_init_writer(FASTX *pFASTX,
-		const char *filename,
-		OUTPUT_FILE_TYPE output_type, 
-		int compress_output)
+void fastx_set_io_options_quality_bins(FASTX_IO_OPTIONS *options, const int *bins)
 {
-	int fd;
+	options->quality_bins = bins;
+}
 
-	if (pFASTX==NULL)
-		errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
-	if (pFASTX->input==NULL)
-		errx(1,"Internal error: pFASTX not initialized (%s:%d)", __FILE__, __LINE__);
+void fastx_set_default_quality_bins(const int *bins)
+{
+	fastx_set_io_options_quality_bins(&default_io_options, bins);
+}
 
-	pFASTX->compress_output = compress_output;
-	if (pFASTX->compress_output)
-		fd = open_output_compressor(pFASTX, filename);
-	else	
-		fd = open_output_file(filename);
+void fastx_set_quality_bins(FASTX *pFASTX, const int *bins)
+{
+	pFASTX->quality_bins = bins;
+}
 
-	pFASTX->output = fdopen(fd,"w");
-	if (pFASTX->output==NULL)
-		err(1,"fdopen failed");
+static const char* parse_quality_value(const char* spec, const char* p, char terminator, int *value)
+{
+	char *endptr;
+	long l;
+
+	l = strtol(p, &endptr, 10);
+	if (endptr==p || *endptr!=terminator)
+		fastx_errx(1,"invalid quality bins '%s' (expecting LOW-HIGH:VALUE,...)", spec);
+	if (l<MIN_QUALITY_VALUE || l>MAX_QUALITY_VALUE)
+		fastx_errx(1,"invalid quality value (%ld) in quality bins '%s' (valid range is %d to %d)",
+			l, spec, MIN_QUALITY_VALUE, MAX_QUALITY_VALUE);
+	*value = (int)l;
+	return endptr+1;
+}
+
+void fastx_parse_quality_bins(const char* spec, int bins[QUALITY_BINS_TABLE_SIZE])
+{
+	/* Illumina's 8-level binning (scores below 2 are not changed) */
+	static const char* illumina8 = "2-9:6,10-19:15,20-24:22,25-29:27,30-34:33,35-39:37,40-93:40";
+	const char* p;
+	char *endptr;
+	int low, high, value, q;
+
+	for (q=0; q<QUALITY_BINS_TABLE_SIZE; q++)
+		bins[q] = q + MIN_QUALITY_VALUE;
+
+	if (strcmp(spec,"illumina8")==0)
+		spec = illumina8;
+
+	p = spec;
+	while (1) {
+		p = parse_quality_value(spec, p, '-', &low);
+		p = parse_quality_value(spec, p, ':', &high);
+		value = (int)strtol(p, &endptr, 10);
+		if (endptr==p || value<MIN_QUALITY_VALUE || value>MAX_QUALITY_VALUE || low>high)
+			fastx_errx(1,"invalid quality bins '%s'", spec);
+		p = endptr;
+
+		for (q=low; q<=high; q++)
+			bins[q - MIN_QUALITY_VALUE] = value;
+
+		if (*p==0)
+			break;
+		if (*p!=',')
+			fastx_errx(1,"invalid quality bins '%s' (expecting LOW-HIGH:VALUE,...)", spec);
+		p++;
+	}
+}
+
+void fastx_set_output_type(FASTX *pFASTX, OUTPUT_FILE_TYPE output_type)
+{
+	pFASTX->quality_bins = pFASTX->options.quality_bins;
 
 	switch(output_type)
 	{
@@ -279,7 +973,7 @@ void fastx_init_writer(FASTX *pFASTX,
 
 	case OUTPUT_FASTQ_ASCII_QUAL:
 		if (! pFASTX->read_fastq) 
-			errx(1,"Can't output FASTQ when input is FASTA.");
+			fastx_errx(1,"Can't output FASTQ when input is FASTA.");
 		pFASTX->write_fastq = 1;
 		pFASTX->write_fastq_ascii = 1;
 		pFASTX->output_sequence_id_prefix = '@';
@@ -287,7 +981,7 @@ void fastx_init_writer(FASTX *pFASTX,
 	
 	case OUTPUT_FASTQ_NUMERIC_QUAL:
 		if (! pFASTX->read_fastq) 
-			errx(1,"Can't output FASTQ when input is FASTA.");
+			fastx_errx(1,"Can't output FASTQ when input is FASTA.");
 		pFASTX->write_fastq = 1;
 		pFASTX->write_fastq_ascii = 0;
 		pFASTX->output_sequence_id_prefix = '@';
@@ -306,43 +1000,279 @@ void fastx_init_writer(FASTX *pFASTX,
 		break;
 
 	default:
-		errx(1, __FILE__ ":%d: Unknown output_type (%d)", 
+		fastx_errx(1, __FILE__ ":%d: Unknown output_type (%d)", 
 			__LINE__, output_type ) ;
 	}
 }
-	
-int fastx_read_next_record(FASTX *pFASTX)
+
+/*
+	Raw records (see fastx_write_record() ) - the run of consecutive records
+	which wasn't written yet. Per-thread, like the writers.
+*/
+#define PENDING_OUTPUT_LIMIT (1024*1024)
+
+static __thread struct {
+	FILE	*output;
+	const char *data;
+	size_t	length;
+} pending_output;
+
+static pthread_once_t pending_output_once = PTHREAD_ONCE_INIT;
+
+// Returns 0 on success, -1 on errors
+static int write_span(FILE* output, const char* data, size_t length)
+{
+	struct stat st;
+	struct iovec iov;
+	ssize_t rc;
+
+	if (fflush(output)!=0)
+		return -1;
+
+	//Pass the pages to the pipe, without copying them.
+	//(the input file is mapped read-only, so they're never changed)
+	if (fileno(output)>=0 && fstat(fileno(output), &st)==0 && S_ISFIFO(st.st_mode)) {
+		while (length>0) {
+			iov.iov_base = (void*)data;
+			iov.iov_len = length;
+			rc = vmsplice(fileno(output), &iov, 1, 0);
+			if (rc==-1 && errno==EINTR)
+				continue;
+			if (rc<=0)
+				break; //let fwrite() try (and report the error)
+			data += rc;
+			length -= rc;
+		}
+	}
+
+	if (length>0 && fwrite(data, 1, length, output)!=length)
+		return -1;
+	return 0;
+}
+
+static void write_pending_output()
+{
+	size_t length = pending_output.length;
+
+	if (length==0)
+		return;
+	pending_output.length = 0 ;
+	if (write_span(pending_output.output, pending_output.data, length)!=0)
+		fastx_err(1,"writing output file failed");
+}
+
+static void write_pending_output_at_exit()
+{
+	size_t length = pending_output.length;
+
+	if (length==0)
+		return;
+	pending_output.length = 0 ;
+	//exit() can't be called again from here
+	if (write_span(pending_output.output, pending_output.data, length)!=0) {
+		warn("writing output file failed");
+		_exit(1);
+	}
+}
+
+static void register_pending_output_at_exit()
 {
-	char temp_qual[MAX_SEQ_LINE_LENGTH+1];
+	atexit(write_pending_output_at_exit);
+}
+
+// Add the (unmodified) record to the run of consecutive records
+static void add_pending_output(const FASTX *pFASTX)
+{
+	if (pending_output.length>0
+	    && (pending_output.output != pFASTX->output
+	        || pending_output.data + pending_output.length != pFASTX->raw_record
+	        || pending_output.length >= PENDING_OUTPUT_LIMIT))
+		write_pending_output();
+
+	if (pending_output.length==0) {
+		pthread_once(&pending_output_once, register_pending_output_at_exit);
+		pending_output.output = pFASTX->output;
+		pending_output.data = pFASTX->raw_record;
+	}
+	pending_output.length += pFASTX->raw_record_length;
+}
 
-	temp_qual[MAX_SEQ_LINE_LENGTH] = 0;
+// Is the record written exactly as it was read?
+static int raw_record_unchanged(const FASTX *pFASTX)
+{
+	if (pFASTX->view_start!=0 || pFASTX->view_end!=pFASTX->sequence_length)
+		return 0;
+	if (pFASTX->write_fastq!=pFASTX->read_fastq)
+		return 0;
+	if (pFASTX->write_fastq && (!pFASTX->write_fastq_ascii || pFASTX->quality_bins!=NULL))
+		return 0;
+	return 1;
+}
 
+void fastx_init_writer(FASTX *pFASTX,
+		const char *filename,
+		OUTPUT_FILE_TYPE output_type, 
+		int compress_output)
+{
+	int fd;
+
+	if (pFASTX==NULL)
+		fastx_errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
+	if (pFASTX->input==NULL)
+		fastx_errx(1,"Internal error: pFASTX not initialized (%s:%d)", __FILE__, __LINE__);
+
+	pFASTX->compress_output = compress_output;
+	if (pFASTX->compress_output)
+		fd = open_output_compressor(pFASTX, filename);
+	else	
+		fd = open_output_file(filename);
+
+	pFASTX->output = NULL;
+	if (pFASTX->options.async_io) {
+		pFASTX->output = fastx_aio_open_output(fd, pFASTX->options.io_buffer_size);
+		//STDOUT stays open (see fastx_close_writer() )
+		if (pFASTX->output!=NULL && fd!=STDOUT_FILENO)
+			close(fd);
+	}
+	if (pFASTX->output==NULL) {
+		pFASTX->output = fdopen(fd,"w");
+		if (pFASTX->output==NULL)
+			fastx_err(1,"fdopen failed");
+		pFASTX->output_buffer = fastx_iotune_set_buffer(pFASTX->output,
+			pFASTX->options.io_buffer_size, pFASTX->options.huge_pages, 1);
+	}
+	fastx_iotune_output_fd(fd);
+
+	fastx_set_output_type(pFASTX, output_type);
+}
+
+void fastx_init_stream_writer(FASTX *pFASTX, FILE* output, OUTPUT_FILE_TYPE output_type)
+{
 	if (pFASTX==NULL)
-		errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
+		fastx_errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
+	if (pFASTX->input==NULL)
+		fastx_errx(1,"Internal error: pFASTX not initialized (%s:%d)", __FILE__, __LINE__);
+
+	pFASTX->compress_output = 0 ;
+	pFASTX->output = output;
+
+	fastx_set_output_type(pFASTX, output_type);
+}
+
+void fastx_close_reader(FASTX *pFASTX)
+{
+	//Collected raw records point into the chunked reader's file
+	write_pending_output();
+
+	if (pFASTX->chunks!=NULL) {
+		fastx_chunk_reader_free(pFASTX->chunks);
+		pFASTX->chunks = NULL;
+	}
+	if (pFASTX->store!=NULL) {
+		fastx_store_close(pFASTX->store);
+		pFASTX->store = NULL;
+	}
+	if (pFASTX->input!=NULL && pFASTX->input!=stdin) {
+		fclose(pFASTX->input);
+		free(pFASTX->input_buffer);
+	}
+	pFASTX->input = NULL;
+	pFASTX->input_buffer = NULL;
+
+	//Closing the pipe stops the decompressor (if it didn't finish already)
+	if (pFASTX->input_decompressor_pid>0) {
+		waitpid(pFASTX->input_decompressor_pid, NULL, 0);
+		pFASTX->input_decompressor_pid = 0 ;
+	}
+}
+
+void fastx_close_writer(FASTX *pFASTX)
+{
+	int status;
+	int rc;
+
+	if (pFASTX->output==NULL)
+		return;
+
+	write_pending_output();
+
+	//Don't close STDOUT - other writers might use it, too
+	//(asynchronous streams write to a duplicate of it, and are closed).
+	//STDOUT keeps its buffer (stdio flushes it at exit).
+	if (fileno(pFASTX->output)==STDOUT_FILENO) {
+		rc = fflush(pFASTX->output);
+	} else {
+		rc = fclose(pFASTX->output);
+		free(pFASTX->output_buffer);
+	}
+	pFASTX->output_buffer = NULL;
+	if (rc!=0)
+		fastx_err(1,"failed to write output file");
+	pFASTX->output = NULL;
+
+	if (pFASTX->output_compressor_pid>0) {
+		if (waitpid(pFASTX->output_compressor_pid, &status, 0)!=-1
+		    && (!WIFEXITED(status) || WEXITSTATUS(status)!=0))
+			fastx_errx(1,"failed to compress output file (GZIP failed)");
+		pFASTX->output_compressor_pid = 0 ;
+	}
+}
+	
+// Count the (unchomped) input line, for the timers report
+static inline void count_input_line(const char* line)
+{
+	if (fastx_timers.enabled)
+		fastx_timers.bytes_in += strlen(line);
+}
+
+static int read_next_record(FASTX *pFASTX)
+{
+	int rc;
+
+	//Only the chunked reader has the records' bytes
+	pFASTX->raw_record = NULL;
+
+	if (pFASTX->store!=NULL)
+		return read_store_record(pFASTX);
+
+	if (pFASTX->chunks!=NULL) {
+		rc = fastx_chunk_reader_next(pFASTX->chunks, pFASTX);
+		if (rc>=0)
+			return rc;
+		//Otherwise, the sequential reader continues from the same record
+	}
+
+	//End of the input range - the next record belongs to the next shard
+	if (pFASTX->input_range_end>=0 && ftello(pFASTX->input) >= pFASTX->input_range_end)
+		return 0;
 
 	pFASTX->input_line_number++;
-	if (fgets(pFASTX->dummy_read_id_buffer, MAX_SEQ_LINE_LENGTH, pFASTX->input) == NULL)
-		return 0; //assume end-of-file, if we couldn't read the first line of the foursome
+	if (fgets(pFASTX->dummy_read_id_buffer, MAX_SEQ_LINE_LENGTH, pFASTX->input) == NULL) {
+		//assume end-of-file, if we couldn't read the first line of the foursome
+		check_input_decompressor(pFASTX);
+		return 0;
+	}
 
+	count_input_line(pFASTX->dummy_read_id_buffer);
 	chomp(pFASTX->name);
 
 	// quick sanity check - 
 	//   FASTQ files should start with '@' in the identifier line
 	//   FASTA files should start with '>' in the identifier line
 	if ( pFASTX->read_fastq && (pFASTX->input_sequence_id_prefix[0] != '@' ) )
-		errx(1,"Invalid input: expecting FASTQ prefix character '@' on line %lld. Is this a valid FASTQ file?\n",
+		fastx_errx(1,"Invalid input: expecting FASTQ prefix character '@' on line %lld. Is this a valid FASTQ file?\n",
 				pFASTX->input_line_number) ;
 	if ( !pFASTX->read_fastq && (pFASTX->input_sequence_id_prefix[0] != '>') )  {
 		//Extra friendly check, warn users if they fed us a multiline FASTA file
 		if ( validate_nucleotides_string ( pFASTX->allowed_nucleotides, pFASTX->input_sequence_id_prefix ) ) 
-			errx(1,"Invalid input: This looks like a multi-line FASTA file.\n" \
+			fastx_errx(1,"Invalid input: This looks like a multi-line FASTA file.\n" \
 				"Line %lld contains a nucleotides string instead of a '>' prefix.\n" \
 				"FASTX-Toolkit can't handle multi-line FASTA files.\n" \
 				"Please use the FASTA-Formatter tool to convert this file into a single-line FASTA.\n", 
 				pFASTX->input_line_number) ;
 		
 		// Otherwise, assume it's just bad input file
-		errx(1,"Invalid input: expecting FASTA prefix character '>' on line %lld. Is this a valid FASTA file?\n",
+		fastx_errx(1,"Invalid input: expecting FASTA prefix character '>' on line %lld. Is this a valid FASTA file?\n",
 				pFASTX->input_line_number) ;
 	}
 
@@ -352,41 +1282,57 @@ int fastx_read_next_record(FASTX *pFASTX)
 	pFASTX->input_line_number++;
 
 	if (fgets(pFASTX->nucleotides,  MAX_SEQ_LINE_LENGTH, pFASTX->input) == NULL) 
-		errx(1,"Failed to read complete record, missing 2nd line (nucleotides), on line %lld\n",
+		fastx_errx(1,"Failed to read complete record, missing 2nd line (nucleotides), on line %lld\n",
 			pFASTX->input_line_number);
 
+	count_input_line(pFASTX->nucleotides);
 	chomp(pFASTX->nucleotides);
 
 	/* Disallow empty nucleotide strings */
-	if (strlen(pFASTX->nucleotides)==0)
-		errx(1,"found empty nucleotide sequence on line %lld\n",pFASTX->input_line_number);
+	pFASTX->sequence_length = strlen(pFASTX->nucleotides);
+	if (pFASTX->sequence_length==0)
+		fastx_errx(1,"found empty nucleotide sequence on line %lld\n",pFASTX->input_line_number);
 
+	pFASTX->view_start = 0 ;
+	pFASTX->view_end = pFASTX->sequence_length ;
+
+	fastx_timer_switch(FASTX_TIMER_VALIDATE);
 	if (!validate_nucleotides_string(pFASTX->allowed_nucleotides, pFASTX->nucleotides)) 
-		errx(1,"found invalid nucleotide sequence (%s) on line %lld\n",
+		fastx_errx(1,"found invalid nucleotide sequence (%s) on line %lld\n",
 				pFASTX->nucleotides,pFASTX->input_line_number);
+	fastx_timer_switch(FASTX_TIMER_PARSE);
 	
 	if (pFASTX->read_fastq) {
 		pFASTX->input_line_number++;
 		if (fgets(pFASTX->dummy_read_id2_buffer,  MAX_SEQ_LINE_LENGTH, pFASTX->input) == NULL) 
-			errx(1,"Failed to read complete record, missing 3rd line (name-2), on line %lld\n",
+			fastx_errx(1,"Failed to read complete record, missing 3rd line (name-2), on line %lld\n",
 				pFASTX->input_line_number);
 		
 		pFASTX->input_line_number++;
-		if (fgets(temp_qual, sizeof(temp_qual), pFASTX->input) == NULL)
-			errx(1,"Failed to read complete record, missing 4th line (quality), on line %lld\n",
+		if (fgets(pFASTX->raw_quality_buffer, MAX_SEQ_LINE_LENGTH, pFASTX->input) == NULL)
+			fastx_errx(1,"Failed to read complete record, missing 4th line (quality), on line %lld\n",
 				pFASTX->input_line_number);
 
+		count_input_line(pFASTX->dummy_read_id2_buffer);
+		count_input_line(pFASTX->raw_quality_buffer);
 		chomp(pFASTX->name2);
-		chomp(temp_qual);
-		
-		if (strlen(temp_qual) == strlen(pFASTX->nucleotides)) {
-			//Assume this is an ASCII quality score line, convert it to values
-			convert_ascii_quality_score_line ( temp_qual, pFASTX ) ;
-			pFASTX->read_fastq_ascii = 1 ;
-		} else {
-			//Assume this is a numeric quality score line, convert it to values
-			convert_numeric_quality_score_line ( temp_qual, pFASTX ) ;
-			pFASTX->read_fastq_ascii = 0 ;
+		chomp(pFASTX->raw_quality_buffer);
+		pFASTX->raw_quality = pFASTX->raw_quality_buffer;
+		pFASTX->raw_quality_length = strlen(pFASTX->raw_quality_buffer);
+
+		//Assume a line with one character per nucleotide has ASCII quality scores,
+		//and anything else has numeric quality scores
+		pFASTX->read_fastq_ascii = (pFASTX->raw_quality_length == pFASTX->sequence_length);
+		pFASTX->quality_decoded = 0 ;
+
+		//A line of another length must be a valid numeric quality line -
+		//always decode those (the check that the record is well-formed),
+		//only ASCII lines are left for fastx_decode_quality()
+		if ((pFASTX->options.record_fields & FASTX_FIELD_QUALITY)
+		    || !pFASTX->read_fastq_ascii) {
+			fastx_timer_switch(FASTX_TIMER_QUALITY);
+			fastx_decode_quality(pFASTX);
+			fastx_timer_switch(FASTX_TIMER_PARSE);
 		}
 
 		//Copy the input format to the output format flag
@@ -403,73 +1349,222 @@ int fastx_read_next_record(FASTX *pFASTX)
 	return 1;
 }
 
-static void write_ascii_qual_string(FASTX *pFASTX, int length)
+int fastx_read_next_record(FASTX *pFASTX)
 {
-	int i;
 	int rc;
 
-	for (i=0; i<length; i++) {
-		rc = fprintf(pFASTX->output, "%c", pFASTX->quality[i] + pFASTX->fastq_ascii_quality_offset ) ;
-		if (rc<=0)
-			err(1,"writing quality scores failed");
+	if (pFASTX==NULL)
+		fastx_errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
+
+	fastx_timed_call_begin(FASTX_TIMED_READ, FASTX_TIMER_PARSE);
+	while ( (rc = read_next_record(pFASTX))==0 && open_next_input_file(pFASTX) )
+		;
+	if (fastx_timers.enabled && rc==1)
+		fastx_timers.sequences_in++;
+	fastx_timed_call_end();
+	fastx_metrics_tick();
+
+	return rc;
+}
+
+// Returns the number of bytes written
+static size_t write_ascii_qual_string(FASTX *pFASTX, const int *quality, size_t length)
+{
+	char ascii_quality[MAX_SEQ_LINE_LENGTH+1];
+	size_t i;
+
+	if (pFASTX->quality_bins!=NULL) {
+		for (i=0; i<length; i++)
+			ascii_quality[i] = (char)(pFASTX->quality_bins[quality[i] - MIN_QUALITY_VALUE]
+					+ pFASTX->fastq_ascii_quality_offset) ;
+	} else {
+		for (i=0; i<length; i++)
+			ascii_quality[i] = (char)(quality[i] + pFASTX->fastq_ascii_quality_offset) ;
 	}
-	rc = fprintf(pFASTX->output, "\n");
-	if (rc<=0)
-		err(1,"writing quality scores failed");
+	ascii_quality[length] = '\n';
+
+	if (fwrite(ascii_quality, 1, length+1, pFASTX->output) != length+1)
+		fastx_err(1,"writing quality scores failed");
+	return length+1;
 }
 
-static void write_numeric_qual_string(FASTX *pFASTX, int length)
+// Copy the quality line as read (the part inside the view).
+// Returns the number of bytes written
+static size_t write_raw_qual_string(FASTX *pFASTX, size_t length)
 {
-	int i;
+	if (fwrite(pFASTX->raw_quality + pFASTX->view_start, 1, length, pFASTX->output) != length
+	    || fputc('\n', pFASTX->output) == EOF)
+		fastx_err(1,"writing quality scores failed");
+	return length+1;
+}
+
+// Returns the number of bytes written
+static size_t write_numeric_qual_string(FASTX *pFASTX, const int *quality, size_t length)
+{
+	size_t i;
+	size_t bytes = 0 ;
 	int rc;
 	for (i=0; i<length; i++) {
-		rc = fprintf(pFASTX->output, "%d", pFASTX->quality[i] ) ;
+		rc = fprintf(pFASTX->output, "%d", (pFASTX->quality_bins!=NULL) ?
+				pFASTX->quality_bins[quality[i] - MIN_QUALITY_VALUE] : quality[i] ) ;
 		if (rc<=0)
-			err(1,"writing quality scores failed");
+			fastx_err(1,"writing quality scores failed");
+		bytes += rc;
 		if (i<length-1) {
 			rc = fprintf(pFASTX->output," ");
 			if (rc<=0)
-				err(1,"writing quality scores failed");
+				fastx_err(1,"writing quality scores failed");
+			bytes += rc;
 		}
 	}
 	rc = fprintf(pFASTX->output, "\n");
 	if (rc<=0)
-		err(1,"writing quality scores failed");
+		fastx_err(1,"writing quality scores failed");
+	return bytes + rc;
 }
 
-void fastx_write_record(FASTX *pFASTX)
+// Returns the number of bytes written
+static size_t write_formatted_record(FASTX *pFASTX)
 {
-	int len;
+	size_t len;
+	size_t bytes;
 	int rc;
 
-	if (pFASTX==NULL)
-		errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
-
-	
 	rc = fprintf(pFASTX->output, "%c%s\n", 
 			pFASTX->output_sequence_id_prefix,
 			pFASTX->name ) ;
 	if (rc<=0)
-		err(1,"writing sequence identifier failed");
-	
-	rc = fprintf(pFASTX->output, "%s\n", pFASTX->nucleotides);
-	if (rc<=0)
-		err(1,"writing nucleotides failed");
+		fastx_err(1,"writing sequence identifier failed");
+	bytes = rc;
+
+	//Write only the bases inside the record's view
+	len = fastx_view_length(pFASTX);
+	if (fwrite(pFASTX->nucleotides + pFASTX->view_start, 1, len, pFASTX->output) != len
+	    || fputc('\n', pFASTX->output) == EOF)
+		fastx_err(1,"writing nucleotides failed");
+	bytes += len+1;
 
 	if (pFASTX->write_fastq) {
 		rc = fprintf(pFASTX->output, "+%s\n", pFASTX->name2 ) ;
 		if (rc<=0)
-			err(1,"writing 2nd sequence identifier failed");
+			fastx_err(1,"writing 2nd sequence identifier failed");
+		bytes += rc;
+
+		//Quality scores which weren't decoded weren't changed, either -
+		//copy them as read, if the output format is the same
+		if (!pFASTX->quality_decoded && pFASTX->write_fastq_ascii
+		    && pFASTX->read_fastq_ascii && pFASTX->quality_bins==NULL)
+			bytes += write_raw_qual_string(pFASTX, len);
+		else {
+			if (!pFASTX->quality_decoded) {
+				fastx_timer_switch(FASTX_TIMER_QUALITY);
+				fastx_decode_quality(pFASTX);
+				fastx_timer_switch(FASTX_TIMER_WRITE);
+			}
+			if (pFASTX->write_fastq_ascii)
+				bytes += write_ascii_qual_string(pFASTX, fastx_view_quality(pFASTX), len);
+			else
+				bytes += write_numeric_qual_string(pFASTX, fastx_view_quality(pFASTX), len);
+		}
+	}
+	return bytes;
+}
+
+void fastx_write_record(FASTX *pFASTX)
+{
+	size_t bytes;
+
+	if (pFASTX==NULL)
+		fastx_errx(1,"Internal error: pFASTX==NULL (%s:%d)", __FILE__,__LINE__);
+
+	fastx_timed_call_begin(FASTX_TIMED_WRITE, FASTX_TIMER_WRITE);
 
-		len = strlen(pFASTX->nucleotides);	
-		if (pFASTX->write_fastq_ascii)
-			write_ascii_qual_string(pFASTX, len);
-		else
-			write_numeric_qual_string(pFASTX, len);
+	if (pFASTX->raw_record!=NULL && raw_record_unchanged(pFASTX)) {
+		add_pending_output(pFASTX);
+		bytes = pFASTX->raw_record_length;
+	} else {
+		write_pending_output();
+		bytes = write_formatted_record(pFASTX);
 	}
 
 	pFASTX->num_output_sequences++;
 	pFASTX->num_output_reads += get_reads_count(pFASTX);
+
+	if (fastx_timers.enabled) {
+		fastx_timers.bytes_out += bytes;
+		fastx_timers.sequences_out++;
+	}
+	fastx_timed_call_end();
+	fastx_metrics_tick();
+}
+
+void fastx_write_record_to(FASTX *pFASTX, FILE* output, OUTPUT_FILE_TYPE output_type)
+{
+	FILE*	saved_output = pFASTX->output;
+	int	saved_write_fastq = pFASTX->write_fastq;
+	int	saved_write_fastq_ascii = pFASTX->write_fastq_ascii;
+	int	saved_copy_format = pFASTX->copy_input_fastq_format_to_output;
+	char	saved_prefix = pFASTX->output_sequence_id_prefix;
+	size_t	saved_sequences = pFASTX->num_output_sequences;
+	size_t	saved_reads = pFASTX->num_output_reads;
+	const char *saved_raw_record = pFASTX->raw_record;
+
+	//Format the record now, 'output' might not be used again
+	pFASTX->raw_record = NULL;
+	fastx_set_output_type(pFASTX, output_type);
+	if (pFASTX->copy_input_fastq_format_to_output)
+		pFASTX->write_fastq_ascii = pFASTX->read_fastq_ascii;
+	pFASTX->output = output;
+
+	fastx_write_record(pFASTX);
+
+	pFASTX->output = saved_output;
+	pFASTX->write_fastq = saved_write_fastq;
+	pFASTX->write_fastq_ascii = saved_write_fastq_ascii;
+	pFASTX->copy_input_fastq_format_to_output = saved_copy_format;
+	pFASTX->output_sequence_id_prefix = saved_prefix;
+	pFASTX->num_output_sequences = saved_sequences;
+	pFASTX->num_output_reads = saved_reads;
+	pFASTX->raw_record = saved_raw_record;
+}
+
+size_t fastx_view_length(const FASTX *pFASTX)
+{
+	return pFASTX->view_end - pFASTX->view_start;
+}
+
+const char* fastx_view_nucleotides(const FASTX *pFASTX)
+{
+	return pFASTX->nucleotides + pFASTX->view_start;
+}
+
+const int* fastx_view_quality(const FASTX *pFASTX)
+{
+	return pFASTX->quality + pFASTX->view_start;
+}
+
+void fastx_trim_start(FASTX *pFASTX, size_t count)
+{
+	if (count > fastx_view_length(pFASTX))
+		count = fastx_view_length(pFASTX);
+	pFASTX->view_start += count;
+}
+
+void fastx_trim_end(FASTX *pFASTX, size_t count)
+{
+	if (count > fastx_view_length(pFASTX))
+		count = fastx_view_length(pFASTX);
+	pFASTX->view_end -= count;
+}
+
+void fastx_set_view(FASTX *pFASTX, size_t start, size_t end)
+{
+	if (end > pFASTX->sequence_length)
+		end = pFASTX->sequence_length;
+	if (start > end)
+		start = end;
+	pFASTX->view_start = start;
+	pFASTX->view_end = end;
 }
 
 int get_reads_count(const FASTX *pFASTX)
@@ -494,6 +1589,140 @@ int get_reads_count(const FASTX *pFASTX)
 	return 1;
 }
 
+void fastx_init_paired_reader(FASTX *pFASTX1, FASTX *pFASTX2,
+		const char* filename1, const char* filename2,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset)
+{
+	fastx_init_paired_reader_with_options(pFASTX1, pFASTX2, filename1, filename2,
+			allowed_input_filetype, allow_bases, allow_lowercase,
+			fastq_ascii_quality_offset, &default_io_options);
+}
+
+void fastx_init_paired_reader_with_options(FASTX *pFASTX1, FASTX *pFASTX2,
+		const char* filename1, const char* filename2,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset,
+		const FASTX_IO_OPTIONS *options)
+{
+	//The mates of a pair could end up in different shards
+	if (fastx_io_options_range_set(options))
+		fastx_errx(1,"paired-end input files can't be split into shards");
+	if (options->input_files!=NULL)
+		fastx_errx(1,"paired-end input can't be read from multiple input files");
+
+	if (filename2==NULL) {
+		//Interleaved input - both mates are read from the same stream
+		fastx_init_reader_with_options(pFASTX1, filename1, allowed_input_filetype,
+				allow_bases, allow_lowercase, fastq_ascii_quality_offset, options);
+		memcpy(pFASTX2, pFASTX1, sizeof(FASTX));
+		return;
+	}
+
+	if (strcmp(filename1,"-")==0 && strcmp(filename2,"-")==0)
+		fastx_errx(1,"Can't read both paired-end files from STDIN");
+
+	fastx_init_reader_with_options(pFASTX1, filename1, allowed_input_filetype,
+			allow_bases, allow_lowercase, fastq_ascii_quality_offset, options);
+	fastx_init_reader_with_options(pFASTX2, filename2, allowed_input_filetype,
+			allow_bases, allow_lowercase, fastq_ascii_quality_offset, options);
+
+	if (pFASTX1->read_fastq != pFASTX2->read_fastq)
+		fastx_errx(1,"paired-end input files (%s, %s) are not in the same format (FASTA/FASTQ)",
+			filename1, filename2);
+}
+
+void fastx_init_paired_writer(FASTX *pFASTX1, FASTX *pFASTX2,
+		const char* filename1, const char* filename2,
+		OUTPUT_FILE_TYPE output_type,
+		int compress_output)
+{
+	if (filename2==NULL) {
+		//Interleaved output - both mates are written to the same stream
+		fastx_init_writer(pFASTX1, filename1, output_type, compress_output);
+		pFASTX2->compress_output = pFASTX1->compress_output;
+		pFASTX2->output = pFASTX1->output;
+		fastx_set_output_type(pFASTX2, output_type);
+		return;
+	}
+
+	if (strcmp(filename1,"-")==0 && strcmp(filename2,"-")==0)
+		fastx_errx(1,"Can't write both paired-end files to STDOUT");
+
+	fastx_init_writer(pFASTX1, filename1, output_type, compress_output);
+	fastx_init_writer(pFASTX2, filename2, output_type, compress_output);
+}
+
+int fastx_mate_names_match(const char* name1, const char* name2)
+{
+	size_t length1 = strcspn(name1, " \t");
+	size_t length2 = strcspn(name2, " \t");
+
+	//Old-style Illumina identifiers: "@READ/1" and "@READ/2"
+	if (length1==length2 && length1>2
+	    && name1[length1-2]=='/' && name2[length2-2]=='/') {
+		length1 -= 2;
+		length2 -= 2;
+	}
+
+	return ( length1==length2 && memcmp(name1, name2, length1)==0 ) ;
+}
+
+static int read_next_interleaved_pair(FASTX *pFASTX1, FASTX *pFASTX2)
+{
+	//Both mates share the input stream - each continues from the other's
+	//line number (and keeps its own record's, for the error messages)
+	pFASTX1->input_line_number = pFASTX2->input_line_number;
+	if (!fastx_read_next_record(pFASTX1))
+		return 0;
+
+	pFASTX2->input_line_number = pFASTX1->input_line_number;
+	if (!fastx_read_next_record(pFASTX2))
+		fastx_errx(1,"interleaved input file '%s' has an odd number of reads (%zu)",
+			pFASTX1->input_file_name, 2*num_input_sequences(pFASTX1) - 1);
+
+	return 1;
+}
+
+int fastx_read_next_pair(FASTX *pFASTX1, FASTX *pFASTX2)
+{
+	int more1, more2;
+
+	if (pFASTX1->input == pFASTX2->input) {
+		if (!read_next_interleaved_pair(pFASTX1, pFASTX2))
+			return 0;
+		more1 = more2 = 1;
+	} else {
+		more1 = fastx_read_next_record(pFASTX1);
+		more2 = fastx_read_next_record(pFASTX2);
+	}
+
+	if (more1 != more2)
+		fastx_errx(1,"paired-end input file '%s' ended after %zu reads, but '%s' has more reads",
+			more1 ? pFASTX2->input_file_name : pFASTX1->input_file_name,
+			more1 ? num_input_sequences(pFASTX2) : num_input_sequences(pFASTX1),
+			more1 ? pFASTX1->input_file_name : pFASTX2->input_file_name);
+	if (!more1)
+		return 0;
+
+	if (!fastx_mate_names_match(pFASTX1->name, pFASTX2->name))
+		fastx_errx(1,"paired-end reads are not synchronized: '%s' (%s line %lld) and '%s' (%s line %lld)",
+			pFASTX1->name, pFASTX1->input_file_name, pFASTX1->input_line_number,
+			pFASTX2->name, pFASTX2->input_file_name, pFASTX2->input_line_number);
+
+	return 1;
+}
+
+void fastx_write_pair(FASTX *pFASTX1, FASTX *pFASTX2)
+{
+	fastx_write_record(pFASTX1);
+	fastx_write_record(pFASTX2);
+}
+
 size_t num_input_sequences(const FASTX *pFASTX)
 {
 	return pFASTX->num_input_sequences;
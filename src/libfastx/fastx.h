@@ -24,6 +24,8 @@ extern "C" {
 
 /* for PATH_MAX */
 #include <limits.h>
+#include <stdio.h>
+#include <sys/types.h>
 
 #define MIN_QUALITY_VALUE (-15)
 #define MAX_QUALITY_VALUE 93
@@ -43,7 +45,8 @@ typedef enum {
 typedef enum {
 	DISALLOW_N=0,
 	ALLOW_N=1,
-	ALLOW_U=2	
+	ALLOW_U=2,
+	ALLOW_ANY_BASE=4	// any printable character (e.g. '.' or IUPAC codes)
 } ALLOWED_INPUT_BASES;
 
 typedef enum {
@@ -58,7 +61,71 @@ typedef enum {
 	OUTPUT_SAME_AS_INPUT=3
 } OUTPUT_FILE_TYPE;
 
-#pragma pack(1) 
+/*
+	Multiple input files - read back to back, as one input.
+	The reader fills in each file's statistics when it reaches its end.
+*/
+typedef struct
+{
+	const char* filename;
+	size_t	sequences;
+	size_t	reads;
+} FASTX_INPUT_FILE;
+
+/*
+	Reader/writer options -
+	Copied into each FASTX when its reader is initialized (see
+	fastx_init_reader_with_options() ), and used by its writer, too.
+	fastx_init_reader() uses the default options, which are changed by
+	the fastx_set_default_* functions below.
+*/
+typedef struct
+{
+	unsigned int shard_index;	// 1 to shard_count (0 = no shard)
+	unsigned int shard_count;
+	off_t	range_start;		// byte range (range_end=-1 = no byte range)
+	off_t	range_end;
+	unsigned int reader_threads;	// more than one = parallel chunked reader
+	const int *quality_bins;	// quality binning table for output, or NULL
+	FASTX_INPUT_FILE *input_files;	// a reader whose file is input_files[0] continues with the
+	size_t	input_files_count;	// other files when it reaches its end (NULL = no other files)
+	unsigned int record_fields;	// FASTX_FIELD_* flags - the record fields the program uses
+	int	async_io;		// 1 = read and write with io_uring (see fastx_aio.h)
+	size_t	io_buffer_size;		// stdio buffer size (0 = stdio's default, see fastx_iotune.h)
+	int	huge_pages;		// 1 = put the stdio buffers on huge pages
+} FASTX_IO_OPTIONS;
+
+/*
+	Record fields -
+	Programs declare which fields of the FASTQ records they use, and the
+	reader skips the work for the others. Names and nucleotides are always
+	read and validated.
+
+	FASTX_FIELD_QUALITY     - numeric quality scores ('quality', fastx_view_quality() ).
+	                          Without it, ASCII quality lines are only checked to be as
+	                          long as the sequence - their scores are not decoded or
+	                          validated, unless the record is written in another format
+	                          (or with quality binning), then they're decoded on demand.
+	                          Numeric quality lines are always decoded.
+	FASTX_FIELD_RAW_RECORD  - the record's bytes, as read ('raw_record').
+	                          Programs which use it promise not to change the
+	                          names, nucleotides or quality scores (only the view).
+
+	The quality line, as read ('raw_quality'), is always kept for FASTQ input,
+	whatever the fields are.
+	Records which are written as read (OUTPUT_SAME_AS_INPUT, ASCII quality
+	scores) copy the raw quality line to the output.
+	With FASTX_FIELD_RAW_RECORD, records whose view wasn't trimmed are not
+	formatted at all - their original bytes are copied (see fastx_write_record() ).
+	Raw records are available only from the parallel chunked reader
+	(see fastx_set_default_reader_threads() ) - with other inputs the
+	flag has no effect.
+	The default is FASTX_FIELD_QUALITY.
+*/
+#define FASTX_FIELD_QUALITY	(1)
+#define FASTX_FIELD_RAW_RECORD	(4)
+
+#pragma pack(push,1)
 typedef struct 
 {
 	/* Record data - common for FASTA/FASTQ */
@@ -83,10 +150,18 @@ typedef struct
 					       //      numeric quality scores and ASCII quality scores
 					       //      are automatically converted to numbers (-15 to 93)
 
+	/* Record view - the part of the record which will be written.
+	   Set to the entire sequence by fastx_read_next_record(), and narrowed
+	   (in O(1), without moving any data) by the fastx_trim_* functions. */
+	size_t	sequence_length;	// length of 'nucleotides' (the entire sequence, as read)
+	size_t	view_start;		// index of the first base in the view
+	size_t	view_end;		// index one past the last base in the view
+
 	/* Configuration */
 	int	allow_input_filetype;	// 0 = Allow only FASTA
 	int	allow_N;		// 1 = N is valid nucleotide, 0 = only A/G/C/T are valid
 	int	allow_U;		// 1 = U is a valid nucleotide
+	int	allow_any_base;		// 1 = any printable character is a valid nucleotide
 	int	allow_lowercase;	
 	int	read_fastq;		// 1 = Input is FASTQ (only if allow_input_fastq==1)
 	int	read_fastq_ascii;	// 1 = Input is FASTQ with ASCII quality scores (0 = with numeric quality scores)
@@ -114,7 +189,36 @@ typedef struct
 
 	FILE*	input;
 	FILE*	output;
+
+	pid_t	input_decompressor_pid;	// GZIP input is piped through a decompressor process (0 = none)
+	struct fastx_store *store;	// Binary read store input (see fastx_store.h), or NULL
+	const int *quality_bins;	// Quality binning table for output (see fastx_set_quality_bins), or NULL
+	off_t	input_range_end;	// Stop before the first record which starts at this offset
+					// (record number, for binary read stores), -1 = no limit
+	struct fastx_chunk_reader *chunks;	// Parallel chunked reader (see fastx_chunks.h), or NULL
+	pid_t	output_compressor_pid;	// GZIP output is piped through a compressor process (0 = none)
+	FASTX_IO_OPTIONS options;
+	size_t	input_file_index;	// the current file in options.input_files
+	size_t	input_file_first_sequence;	// num_input_sequences/reads when the current file was opened
+	size_t	input_file_first_read;
+
+	/* The quality line, as read (only for FASTQ input, always kept) */
+	const char *raw_quality;		// NOT NULL-terminated, use raw_quality_length
+	size_t	raw_quality_length;
+	int	quality_decoded;		// 1 = 'quality' holds the current record's scores
+	char	raw_quality_buffer[MAX_SEQ_LINE_LENGTH+1];
+
+	/* The record's bytes in the chunked reader's mmap'd input file (see
+	   FASTX_FIELD_RAW_RECORD), or NULL (other readers, and records with
+	   CR/LF line endings) */
+	const char *raw_record;
+	size_t	raw_record_length;
+
+	/* The input/output streams' buffers (see fastx_iotune.h), or NULL */
+	char	*input_buffer;
+	char	*output_buffer;
 } FASTX ;
+#pragma pack(pop)
 
 
 void fastx_init_reader(FASTX *pFASTX, const char* filename, 
@@ -123,6 +227,27 @@ void fastx_init_reader(FASTX *pFASTX, const char* filename,
 		ALLOWED_INPUT_CASE allow_lowercase,
 		int fastq_ascii_quality_offset);
 
+void fastx_init_reader_with_options(FASTX *pFASTX, const char* filename,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset,
+		const FASTX_IO_OPTIONS *options);
+
+/*
+	Read from an open stream (e.g. a memory buffer, see fmemopen(3)) instead
+	of a file. The reader owns the stream, fastx_close_reader() closes it.
+	'name' is used in error messages.
+	Streams without a file descriptor can't be split into shards or read
+	by several reader threads.
+*/
+void fastx_init_stream_reader(FASTX *pFASTX, FILE* input, const char* name,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset,
+		const FASTX_IO_OPTIONS *options);
+
 // If the sequence identifier is collapsed (= "N-N") returns the reads_count,
 // otherwise, returns 1
 int get_reads_count(const FASTX *pFASTX);
@@ -131,11 +256,200 @@ void fastx_init_writer(FASTX *pFASTX,
 		const char* filename,
 		OUTPUT_FILE_TYPE output_type,
 		int compress_output);
-	
+
+// Write to an open stream (e.g. a memory buffer, see open_memstream(3)),
+// which fastx_close_writer() closes.
+void fastx_init_stream_writer(FASTX *pFASTX, FILE* output, OUTPUT_FILE_TYPE output_type);
+
+// Set the output format without opening an output file
+// (for writers which manage their own output, see fastx_sinks.h)
+void fastx_set_output_type(FASTX *pFASTX, OUTPUT_FILE_TYPE output_type);
+
+// Close the input stream (and stop the decompressor/reader threads, if any)
+void fastx_close_reader(FASTX *pFASTX);
+
+// Flush and close the output stream, and wait for the output compressor (if any)
+void fastx_close_writer(FASTX *pFASTX);
+
+// Initialize reader/writer options (no shard, one reader thread, no quality binning)
+void fastx_init_io_options(FASTX_IO_OPTIONS *options);
+
+// Set all the default options at once (see fastx_init_reader() )
+void fastx_set_default_io_options(const FASTX_IO_OPTIONS *options);
+
+/*
+	Quality binning -
+	When set, fastx_write_record() maps every quality score through the
+	binning table before writing it (binned quality strings compress much
+	better). The table has QUALITY_BINS_TABLE_SIZE entries, indexed by
+	(quality - MIN_QUALITY_VALUE).
+
+	The default table (set by fastx_parse_cmdline() for '--quality-bins')
+	is used by writers initialized afterwards.
+*/
+#define QUALITY_BINS_TABLE_SIZE (256)
+
+// Parse "illumina8", or a list of LOW-HIGH:VALUE ranges (e.g. "0-19:10,20-93:30").
+// Quality values outside the ranges are not changed.
+void fastx_parse_quality_bins(const char* spec, int bins[QUALITY_BINS_TABLE_SIZE]);
+
+void fastx_set_quality_bins(FASTX *pFASTX, const int *bins);
+void fastx_set_default_quality_bins(const int *bins);
+void fastx_set_io_options_quality_bins(FASTX_IO_OPTIONS *options, const int *bins);
+
+/*
+	Input ranges (sharding) -
+	A reader can process only the records which start inside a range of
+	its input file: it seeks to the start of the range, skips to the first
+	complete record, and stops before the first record which starts at (or
+	after) the end of the range. N jobs can thus split a file between them,
+	each reading only its part, and every record is processed exactly once.
+
+	A shard I/N is the I-th of N equal byte ranges (1 <= I <= N).
+	Binary read stores (see fastx_store.h) are split by record numbers.
+	Compressed input, STDIN pipes and paired-end input can't be split.
+	A reader of several input files (see FASTX_IO_OPTIONS.input_files)
+	applies the range to each file: concatenating the shards gives all the
+	records, but not in the order of the whole input.
+
+	The default range (set by fastx_parse_cmdline() for '--shard' and
+	'--byte-range') is used by readers initialized afterwards.
+*/
+void fastx_set_default_input_shard(unsigned int index, unsigned int count);
+void fastx_set_default_input_byte_range(off_t start, off_t end);
+int fastx_default_input_range_set();
+
+void fastx_set_io_options_shard(FASTX_IO_OPTIONS *options, unsigned int index, unsigned int count);
+void fastx_set_io_options_byte_range(FASTX_IO_OPTIONS *options, off_t start, off_t end);
+int fastx_io_options_range_set(const FASTX_IO_OPTIONS *options);
+
+/*
+	Parallel reading -
+	With more than one reader thread, uncompressed regular input files
+	are parsed by a pool of worker threads (see fastx_chunks.h), and
+	fastx_read_next_record() returns the records in the same order.
+	Other input files are read sequentially.
+
+	The default (set by fastx_parse_cmdline() for '--reader-threads') is
+	used by readers initialized afterwards.
+*/
+void fastx_set_default_reader_threads(unsigned int threads);
+void fastx_set_io_options_reader_threads(FASTX_IO_OPTIONS *options, unsigned int threads);
+
+/*
+	Asynchronous I/O -
+	Readers of uncompressed regular files (which don't use the chunked
+	reader) and of GZIP files, and all the writers, use io_uring streams
+	(see fastx_aio.h), whose reads and writes overlap with the processing.
+	Without io_uring support, the regular (blocking) streams are used.
+
+	The default (set by fastx_parse_cmdline() for '--async-io') is
+	used by readers initialized afterwards, and by their writers.
+*/
+void fastx_set_default_async_io(int async_io);
+void fastx_set_io_options_async_io(FASTX_IO_OPTIONS *options, int async_io);
+
+/*
+	I/O buffers and hints -
+	The streams which the readers and writers open are read and written
+	in blocks of 'size' bytes (0 = stdio's default buffers), optionally
+	on huge pages. Input files are read with sequential access hints, and
+	pipes are enlarged (see fastx_iotune.h). The default is
+	FASTX_IO_BUFFER_SIZE, without huge pages.
+	The io_uring streams (see fastx_set_default_async_io() ) use buffers of
+	the same size (FASTX_AIO_BUFFER_SIZE instead of stdio's default).
+
+	The default (set by fastx_parse_cmdline() for '--io-buffer-size' and
+	'--huge-pages') is used by readers initialized afterwards, and by their writers.
+*/
+void fastx_set_default_io_buffers(size_t size, int huge_pages);
+void fastx_set_io_options_io_buffers(FASTX_IO_OPTIONS *options, size_t size, int huge_pages);
+
 int fastx_read_next_record(FASTX *pFASTX);
 
+// Decode the current record's quality scores, if the reader didn't
+// (see FASTX_FIELD_QUALITY)
+void fastx_decode_quality(FASTX *pFASTX);
+
+// The record fields used by readers initialized afterwards (FASTX_FIELD_* flags)
+void fastx_set_default_record_fields(unsigned int fields);
+void fastx_set_io_options_record_fields(FASTX_IO_OPTIONS *options, unsigned int fields);
+
+/*
+	Raw records -
+	Records which are written exactly as read (see FASTX_FIELD_RAW_RECORD)
+	are not formatted: runs of consecutive records are collected, and
+	written at once, as one span of the mmap'd input file. If the output
+	is a pipe, the span's pages are passed to it with vmsplice(2),
+	without copying them.
+
+	The collected records are written before anything else is written
+	with fastx_write_record() (in the same thread), by fastx_close_writer()
+	and fastx_close_reader(), or at exit - programs must not write to the
+	output stream in other ways.
+*/
 void fastx_write_record(FASTX *pFASTX);
 
+// Write the current record to another stream, in the given format
+// (the FASTX's own output and output counters are not changed).
+void fastx_write_record_to(FASTX *pFASTX, FILE* output, OUTPUT_FILE_TYPE output_type);
+
+/*
+	Record views -
+	Trimming a record only adjusts the view's start/end offsets.
+	The nucleotides/quality arrays are never modified, and fastx_write_record()
+	writes only the bases (and quality scores) inside the view.
+
+	NOTE: the view's nucleotides are NOT NULL-terminated, use fastx_view_length().
+*/
+size_t fastx_view_length(const FASTX *pFASTX);
+const char* fastx_view_nucleotides(const FASTX *pFASTX);
+const int* fastx_view_quality(const FASTX *pFASTX);
+
+// Remove 'count' bases from the start/end of the view (the view can become empty)
+void fastx_trim_start(FASTX *pFASTX, size_t count);
+void fastx_trim_end(FASTX *pFASTX, size_t count);
+
+// Set the view to bases [start,end) of the entire sequence (clipped to the sequence length)
+void fastx_set_view(FASTX *pFASTX, size_t start, size_t end);
+
+/*
+	Paired-end files -
+	Two FASTX streams (one per mate) which are read and written in lockstep.
+	fastx_read_next_pair() stops with an error if one file ends before the
+	other, or if the mates' identifiers don't match.
+
+	Interleaved files - if 'filename2' is NULL, both mates are read from
+	(or written to) 'filename1', as consecutive records.
+*/
+void fastx_init_paired_reader(FASTX *pFASTX1, FASTX *pFASTX2,
+		const char* filename1, const char* filename2,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset);
+
+void fastx_init_paired_reader_with_options(FASTX *pFASTX1, FASTX *pFASTX2,
+		const char* filename1, const char* filename2,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase,
+		int fastq_ascii_quality_offset,
+		const FASTX_IO_OPTIONS *options);
+
+void fastx_init_paired_writer(FASTX *pFASTX1, FASTX *pFASTX2,
+		const char* filename1, const char* filename2,
+		OUTPUT_FILE_TYPE output_type,
+		int compress_output);
+
+int fastx_read_next_pair(FASTX *pFASTX1, FASTX *pFASTX2);
+
+void fastx_write_pair(FASTX *pFASTX1, FASTX *pFASTX2);
+
+// Compare read identifiers up to the first whitespace,
+// ignoring "/1" and "/2" suffixes. Returns 1 if they belong to the same pair.
+int fastx_mate_names_match(const char* name1, const char* name2);
+
 size_t num_input_sequences(const FASTX *pFASTX);
 size_t num_input_reads(const FASTX *pFASTX);
 size_t num_output_sequences(const FASTX *pFASTX);
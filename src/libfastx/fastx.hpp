@@ -0,0 +1,341 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_HPP__
+#define __FASTX_HPP__
+
+#include <stdio.h>
+#include <errno.h>
+#include <string.h>
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+
+#include "fastx.h"
+#include "fastx_error.h"
+
+/*
+	C++ interface to libfastx (header-only, requires C++11).
+
+	    fastx::reader input("reads.fastq");
+	    fastx::writer output("clipped.fastq");
+
+	    for (fastx::record &rec : input) {
+		    rec.trim_end(10);
+		    if (rec.length() >= 20)
+			    output.write(rec);
+	    }
+
+	Records are views of the reader's buffers: nothing is copied, and a
+	record is valid only until the next one is read. Trimming a record
+	(or running the stages of fastx_stages.h and clipper_stage.h on
+	record::get() ) only narrows its view, exactly like in the C API.
+
+	Readers and writers can use memory buffers instead of files.
+
+	Errors (invalid input, I/O errors) throw fastx::error - the program is
+	never terminated (see fastx_error.h). To call other libfastx functions
+	safely, wrap them with fastx::call().
+*/
+namespace fastx {
+
+class error : public std::runtime_error
+{
+public:
+	explicit error(const std::string& message) : std::runtime_error(message) { }
+};
+
+namespace detail {
+	template<typename Function>
+	void invoke(void* function)
+	{
+		(*static_cast<Function*>(function))();
+	}
+}
+
+/*
+	Run 'function' (usually a lambda which calls libfastx),
+	and throw its error (if any) as fastx::error.
+
+	NOTE: an error longjmp()s out of 'function' - it must not create
+	objects with destructors (e.g. std::string).
+*/
+template<typename Function>
+void call(Function function)
+{
+	char message[1024];
+
+	if (fastx_call(&detail::invoke<Function>, &function, message, sizeof(message))!=0)
+		throw error(message);
+}
+
+class record
+{
+	FASTX *fastx;
+
+public:
+	explicit record(FASTX *pFASTX) : fastx(pFASTX) { }
+
+	// The identifier, without the '>' or '@' prefix
+	const char* name() const { return fastx->name; }
+
+	// The bases in the view - NOT NULL-terminated, see length()
+	const char* sequence() const { return fastx_view_nucleotides(fastx); }
+	size_t length() const { return fastx_view_length(fastx); }
+	std::string sequence_string() const { return std::string(sequence(), length()); }
+
+	// Numeric quality scores of the bases in the view (NULL for FASTA input),
+	// decoded on demand if the reader skipped them (see FASTX_FIELD_QUALITY)
+	bool has_quality() const { return fastx->read_fastq!=0; }
+	const int* quality() const
+	{
+		FASTX *pFASTX = fastx;
+
+		if (!has_quality())
+			return NULL;
+		call([&] { fastx_decode_quality(pFASTX); });
+		return fastx_view_quality(fastx);
+	}
+
+	// Number of reads for collapsed FASTA identifiers ("N-COUNT"), otherwise 1
+	int reads_count() const { return get_reads_count(fastx); }
+
+	void trim_start(size_t count) { fastx_trim_start(fastx, count); }
+	void trim_end(size_t count) { fastx_trim_end(fastx, count); }
+	void set_view(size_t start, size_t end) { fastx_set_view(fastx, start, end); }
+
+	// For the C API (e.g. fastx_trimmer_process(), FastxClipper::process() )
+	FASTX* get() const { return fastx; }
+};
+
+struct reader_options
+{
+	ALLOWED_INPUT_FILE_TYPES file_types;
+	ALLOWED_INPUT_BASES bases;
+	ALLOWED_INPUT_CASE letter_case;
+	int quality_offset;
+	FASTX_IO_OPTIONS io;	// see fastx_set_io_options_*()
+
+	reader_options() :
+		file_types(FASTA_OR_FASTQ),
+		bases(ALLOW_N),
+		letter_case(ALLOW_LOWERCASE),
+		quality_offset(33)
+	{
+		fastx_init_io_options(&io);
+	}
+};
+
+class reader
+{
+	FASTX *fastx;
+	record current;
+	bool reading;		// false after the last record (or an error)
+
+	// Closing a reader flushes its pending output (see fastx_close_reader() ),
+	// which can fail - there's no one to report it to, so it's dropped
+	static void close_quietly(FASTX *pFASTX)
+	{
+		try {
+			call([&] { fastx_close_reader(pFASTX); });
+		} catch (const error&) {
+		}
+	}
+
+	void open(FILE* input, const char* name, const reader_options& options)
+	{
+		FASTX *pFASTX = fastx;
+		try {
+			if (input==NULL)
+				call([&] { fastx_init_reader_with_options(pFASTX, name,
+						options.file_types, options.bases, options.letter_case,
+						options.quality_offset, &options.io); });
+			else
+				call([&] { fastx_init_stream_reader(pFASTX, input, name,
+						options.file_types, options.bases, options.letter_case,
+						options.quality_offset, &options.io); });
+		} catch (...) {
+			if (input!=NULL && fastx->input==NULL)
+				fclose(input);
+			close_quietly(fastx);
+			delete fastx;
+			throw;
+		}
+	}
+
+public:
+	class iterator
+	{
+		reader *owner;	// NULL = end
+	public:
+		typedef std::input_iterator_tag iterator_category;
+		typedef record value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef record* pointer;
+		typedef record& reference;
+
+		explicit iterator(reader *r) : owner(r) { }
+
+		record& operator*() const { return owner->current; }
+		record* operator->() const { return &owner->current; }
+		iterator& operator++()
+		{
+			if (!owner->next())
+				owner = NULL;
+			return *this;
+		}
+		void operator++(int) { ++*this; }
+		bool operator==(const iterator& other) const { return owner==other.owner; }
+		bool operator!=(const iterator& other) const { return owner!=other.owner; }
+	};
+
+	// Read a FASTA/FASTQ file (or a GZIP compressed file, or "-" for STDIN)
+	explicit reader(const std::string& filename, const reader_options& options = reader_options())
+		: fastx(new FASTX), current(fastx), reading(false)
+	{
+		open(NULL, filename.c_str(), options);
+	}
+
+	// Read from a memory buffer, which must not change while it is read
+	reader(const void* data, size_t size, const reader_options& options = reader_options())
+		: fastx(new FASTX), current(fastx), reading(false)
+	{
+		FILE* input = fmemopen(const_cast<void*>(data), size, "r");
+		if (input==NULL) {
+			delete fastx;
+			throw error(std::string("failed to open memory buffer: ") + strerror(errno));
+		}
+		open(input, "(memory buffer)", options);
+	}
+
+	reader(const reader&) = delete;
+	reader& operator=(const reader&) = delete;
+
+	~reader()
+	{
+		close_quietly(fastx);
+		delete fastx;
+	}
+
+	// Read the next record (see record() ). Returns false at the end of the input.
+	bool next()
+	{
+		FASTX *pFASTX = fastx;
+		int rc = 0 ;
+
+		reading = false;
+		call([&] { rc = fastx_read_next_record(pFASTX); });
+		reading = (rc==1);
+		return reading;
+	}
+
+	// The last record read by next()
+	record& get_record() { return current; }
+
+	// Reads the first record - a reader can be iterated only once
+	iterator begin() { return iterator(next() ? this : NULL); }
+	iterator end() { return iterator(NULL); }
+
+	size_t sequences() const { return num_input_sequences(fastx); }
+	size_t reads() const { return num_input_reads(fastx); }
+	bool is_fastq() const { return fastx->read_fastq!=0; }
+
+	FASTX* get() const { return fastx; }
+};
+
+class writer
+{
+	FILE* output;
+	OUTPUT_FILE_TYPE output_type;
+	char* buffer;		// memory writers (see open_memstream(3) )
+	size_t buffer_size;
+	size_t records;
+
+public:
+	// Write to a file ("-" for STDOUT). OUTPUT_SAME_AS_INPUT writes
+	// each record in the format of its input file.
+	explicit writer(const std::string& filename, OUTPUT_FILE_TYPE type = OUTPUT_SAME_AS_INPUT)
+		: output(NULL), output_type(type), buffer(NULL), buffer_size(0), records(0)
+	{
+		if (filename=="-")
+			output = stdout;
+		else
+			output = fopen(filename.c_str(), "w");
+		if (output==NULL)
+			throw error("failed to create output file '" + filename + "': " + strerror(errno));
+	}
+
+	// Write to a memory buffer, see str()
+	explicit writer(OUTPUT_FILE_TYPE type = OUTPUT_SAME_AS_INPUT)
+		: output(NULL), output_type(type), buffer(NULL), buffer_size(0), records(0)
+	{
+		output = open_memstream(&buffer, &buffer_size);
+		if (output==NULL)
+			throw error(std::string("failed to open memory buffer: ") + strerror(errno));
+	}
+
+	writer(const writer&) = delete;
+	writer& operator=(const writer&) = delete;
+
+	~writer()
+	{
+		if (output!=NULL && output!=stdout)
+			fclose(output);
+		free(buffer);
+	}
+
+	void write(const record& rec)
+	{
+		FILE* out = output;
+		OUTPUT_FILE_TYPE type = output_type;
+
+		if (output==NULL)
+			throw error("write to a closed writer");
+		call([&] { fastx_write_record_to(rec.get(), out, type); });
+		records++;
+	}
+
+	// The records written so far (memory writers only, empty for files)
+	std::string str()
+	{
+		if (output!=NULL && fflush(output)!=0)
+			throw error(std::string("failed to write output: ") + strerror(errno));
+		if (buffer==NULL)
+			return std::string();
+		return std::string(buffer, buffer_size);
+	}
+
+	// Flush and close the output (str() is still available afterwards)
+	void close()
+	{
+		int rc;
+
+		if (output==NULL)
+			return;
+		rc = (output==stdout) ? fflush(output) : fclose(output);
+		output = NULL;
+		if (rc!=0)
+			throw error(std::string("failed to write output: ") + strerror(errno));
+	}
+
+	size_t count() const { return records; }
+};
+
+}
+
+#endif
@@ -0,0 +1,782 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#define _GNU_SOURCE
+#include <config.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <err.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#endif
+
+#include "fastx_aio.h"
+#include "fastx_iotune.h"
+
+#if defined(HAVE_LINUX_IO_URING_H) && defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+
+/*
+	A minimal io_uring, with the raw system calls (no liburing).
+	Only the readv/writev operations are used (available since Linux 5.1).
+*/
+struct aio_ring
+{
+	int	fd;
+
+	void	*sq_map;
+	size_t	sq_map_size;
+	unsigned *sq_head;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t	sqes_size;
+
+	void	*cq_map;
+	size_t	cq_map_size;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+enum aio_buffer_state
+{
+	AIO_BUFFER_FREE = 0,
+	AIO_BUFFER_IN_FLIGHT,
+	AIO_BUFFER_DONE
+};
+
+struct aio_buffer
+{
+	char	*data;
+	enum aio_buffer_state state;
+	off_t	offset;		// file offset of data[0] (seekable files)
+	size_t	requested;	// reads: bytes requested
+	size_t	length;		// reads: bytes read, writes: bytes in the buffer
+	size_t	done;		// reads: bytes returned to stdio, writes: bytes written
+	int	result;		// the last completion's result (-errno on error)
+	struct iovec iov;
+};
+
+typedef struct aio_stream
+{
+	struct aio_ring ring;
+	int	fd;
+	int	seekable;	// 0 = pipes and O_APPEND files - one buffer in flight
+	off_t	offset;		// reads: offset of the next read-ahead, writes: of the next write
+	off_t	position;	// reads: offset of the next byte returned to stdio
+	int	error;		// errno of the first failed operation
+	int	eof;
+
+	struct aio_buffer buffers[FASTX_AIO_BUFFERS];
+	size_t	buffer_size;
+	unsigned int next;	// reads: the buffer being returned, writes: the buffer being filled
+	unsigned int queued;	// reads: buffers read (or being read) ahead, starting at 'next'
+	unsigned int in_flight;
+
+	/* Output streams - open streams are listed, and finished at exit */
+	FILE	*file;
+	int	synchronous;	// 1 = finished at exit - later writes are blocking
+	struct aio_stream *next_output;
+} AIO_STREAM;
+
+static int ring_setup(struct aio_ring *ring, unsigned int entries)
+{
+	struct io_uring_params params;
+
+	memset(ring, 0, sizeof(struct aio_ring));
+	memset(&params, 0, sizeof(params));
+
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+	if (ring->fd<0)
+		return -1;
+
+	ring->sq_map_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	ring->cq_map_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+	if (params.features & IORING_FEAT_SINGLE_MMAP) {
+		if (ring->cq_map_size > ring->sq_map_size)
+			ring->sq_map_size = ring->cq_map_size;
+		ring->cq_map_size = 0 ;
+	}
+
+	ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ|PROT_WRITE,
+				MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+	if (ring->sq_map==MAP_FAILED)
+		goto failed;
+	if (ring->cq_map_size==0) {
+		ring->cq_map = ring->sq_map;
+	} else {
+		ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ|PROT_WRITE,
+				MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+		if (ring->cq_map==MAP_FAILED)
+			goto failed;
+	}
+	ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+	ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ|PROT_WRITE,
+				MAP_SHARED|MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+	if (ring->sqes==MAP_FAILED)
+		goto failed;
+
+	ring->sq_head  = (unsigned*)((char*)ring->sq_map + params.sq_off.head);
+	ring->sq_tail  = (unsigned*)((char*)ring->sq_map + params.sq_off.tail);
+	ring->sq_mask  = (unsigned*)((char*)ring->sq_map + params.sq_off.ring_mask);
+	ring->sq_array = (unsigned*)((char*)ring->sq_map + params.sq_off.array);
+	ring->cq_head  = (unsigned*)((char*)ring->cq_map + params.cq_off.head);
+	ring->cq_tail  = (unsigned*)((char*)ring->cq_map + params.cq_off.tail);
+	ring->cq_mask  = (unsigned*)((char*)ring->cq_map + params.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe*)((char*)ring->cq_map + params.cq_off.cqes);
+	return 0;
+
+failed:
+	if (ring->sq_map!=NULL && ring->sq_map!=MAP_FAILED)
+		munmap(ring->sq_map, ring->sq_map_size);
+	if (ring->cq_map_size>0 && ring->cq_map!=NULL && ring->cq_map!=MAP_FAILED)
+		munmap(ring->cq_map, ring->cq_map_size);
+	close(ring->fd);
+	return -1;
+}
+
+static void ring_free(struct aio_ring *ring)
+{
+	munmap(ring->sqes, ring->sqes_size);
+	if (ring->cq_map_size>0)
+		munmap(ring->cq_map, ring->cq_map_size);
+	munmap(ring->sq_map, ring->sq_map_size);
+	close(ring->fd);
+}
+
+static int ring_enter(struct aio_ring *ring, unsigned int to_submit,
+		unsigned int min_complete, unsigned int flags)
+{
+	int rc;
+
+	do {
+		rc = (int)syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete,
+				flags, NULL, 0);
+	} while (rc==-1 && errno==EINTR);
+	return rc;
+}
+
+/*
+	Submit a readv/writev of the buffer's iovec.
+	Returns 0, or -1 (with errno) if the request couldn't be submitted.
+*/
+static int submit_buffer(AIO_STREAM *stream, unsigned int index, int opcode, off_t offset)
+{
+	struct aio_ring *ring = &stream->ring;
+	struct aio_buffer *buffer = &stream->buffers[index];
+	struct io_uring_sqe *sqe;
+	unsigned int tail, slot;
+
+	tail = *ring->sq_tail;
+	slot = tail & *ring->sq_mask;
+	sqe = &ring->sqes[slot];
+
+	memset(sqe, 0, sizeof(struct io_uring_sqe));
+	sqe->opcode = (unsigned char)opcode;
+	sqe->fd = stream->fd;
+	sqe->off = (uint64_t)offset;
+	sqe->addr = (uint64_t)(uintptr_t)&buffer->iov;
+	sqe->len = 1;
+	sqe->user_data = index;
+
+	ring->sq_array[slot] = slot;
+	__atomic_store_n(ring->sq_tail, tail+1, __ATOMIC_RELEASE);
+
+	if (ring_enter(ring, 1, 0, 0)!=1) {
+		//not consumed by the kernel - take it back
+		__atomic_store_n(ring->sq_tail, tail, __ATOMIC_RELEASE);
+		return -1;
+	}
+
+	buffer->state = AIO_BUFFER_IN_FLIGHT;
+	stream->in_flight++;
+	return 0;
+}
+
+/*
+	Wait for one request to complete, and mark its buffer as done.
+	Returns the buffer's index, or -1 (with errno) on failure.
+*/
+static int wait_completion(AIO_STREAM *stream)
+{
+	struct aio_ring *ring = &stream->ring;
+	struct io_uring_cqe *cqe;
+	unsigned int head, index;
+
+	while (1) {
+		head = *ring->cq_head;
+		if (head != __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE))
+			break;
+		if (ring_enter(ring, 0, 1, IORING_ENTER_GETEVENTS)==-1)
+			return -1;
+	}
+
+	cqe = &ring->cqes[head & *ring->cq_mask];
+	index = (unsigned int)cqe->user_data;
+	stream->buffers[index].result = cqe->res;
+	stream->buffers[index].state = AIO_BUFFER_DONE;
+	stream->in_flight--;
+	__atomic_store_n(ring->cq_head, head+1, __ATOMIC_RELEASE);
+	return (int)index;
+}
+
+static void set_error(AIO_STREAM *stream, int error)
+{
+	if (stream->error==0)
+		stream->error = error;
+}
+
+// Wait for all the requests in flight (their results are ignored)
+static void drain(AIO_STREAM *stream)
+{
+	while (stream->in_flight>0)
+		if (wait_completion(stream)==-1) {
+			set_error(stream, errno);
+			break;
+		}
+}
+
+static AIO_STREAM* stream_new(int fd, size_t buffer_size)
+{
+	AIO_STREAM *stream;
+	struct stat st;
+	unsigned int i;
+	int flags;
+
+	stream = calloc(1, sizeof(AIO_STREAM));
+	if (stream==NULL)
+		return NULL;
+
+	if (ring_setup(&stream->ring, FASTX_AIO_BUFFERS)!=0) {
+		free(stream);
+		return NULL;
+	}
+
+	stream->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if (stream->fd==-1)
+		goto failed;
+
+	flags = fcntl(fd, F_GETFL);
+	stream->seekable = (fstat(fd, &st)==0 && S_ISREG(st.st_mode)
+				&& flags!=-1 && (flags & O_APPEND)==0);
+
+	stream->buffer_size = (buffer_size>0) ? buffer_size : FASTX_AIO_BUFFER_SIZE ;
+	for (i=0; i<FASTX_AIO_BUFFERS; i++) {
+		stream->buffers[i].data = malloc(stream->buffer_size);
+		if (stream->buffers[i].data==NULL)
+			goto failed;
+	}
+	return stream;
+
+failed:
+	for (i=0; i<FASTX_AIO_BUFFERS; i++)
+		free(stream->buffers[i].data);
+	if (stream->fd!=-1)
+		close(stream->fd);
+	ring_free(&stream->ring);
+	free(stream);
+	return NULL;
+}
+
+static int stream_free(AIO_STREAM *stream)
+{
+	unsigned int i;
+	int rc = 0 ;
+
+	drain(stream);
+	if (close(stream->fd)!=0)
+		set_error(stream, errno);
+	ring_free(&stream->ring);
+	for (i=0; i<FASTX_AIO_BUFFERS; i++)
+		free(stream->buffers[i].data);
+
+	if (stream->error!=0) {
+		errno = stream->error;
+		rc = -1;
+	}
+	free(stream);
+	return rc;
+}
+
+/*
+	Input streams -
+	Buffers are read ahead in a cycle: 'next' is the one being returned to
+	stdio, followed by 'queued'-1 buffers which are being (or were) read.
+*/
+static void read_ahead(AIO_STREAM *stream)
+{
+	unsigned int index;
+	struct aio_buffer *buffer;
+
+	while (stream->queued < FASTX_AIO_BUFFERS && !stream->eof && stream->error==0) {
+		if (!stream->seekable && stream->in_flight>0)
+			return;
+
+		index = (stream->next + stream->queued) % FASTX_AIO_BUFFERS;
+		buffer = &stream->buffers[index];
+		buffer->offset = stream->offset;
+		buffer->requested = stream->buffer_size;
+		buffer->length = 0 ;
+		buffer->done = 0 ;
+		buffer->iov.iov_base = buffer->data;
+		buffer->iov.iov_len = buffer->requested;
+
+		if (submit_buffer(stream, index, IORING_OP_READV,
+				stream->seekable ? stream->offset : 0)!=0) {
+			set_error(stream, errno);
+			return;
+		}
+		stream->queued++;
+		stream->offset += buffer->requested;
+	}
+}
+
+// Drop the read-ahead buffers, and continue reading from 'offset'
+static void restart_read_ahead(AIO_STREAM *stream, off_t offset)
+{
+	unsigned int i;
+
+	drain(stream);
+	for (i=0; i<FASTX_AIO_BUFFERS; i++)
+		stream->buffers[i].state = AIO_BUFFER_FREE;
+	stream->queued = 0 ;
+	stream->eof = 0 ;
+	stream->offset = offset;
+	stream->position = offset;
+}
+
+static ssize_t aio_read(void *cookie, char *data, size_t size)
+{
+	AIO_STREAM *stream = (AIO_STREAM*)cookie;
+	struct aio_buffer *buffer;
+	size_t count;
+
+	while (1) {
+		read_ahead(stream);
+
+		if (stream->queued==0) {
+			if (stream->error!=0) {
+				errno = stream->error;
+				return -1;
+			}
+			return 0; //EOF
+		}
+
+		buffer = &stream->buffers[stream->next];
+		while (buffer->state==AIO_BUFFER_IN_FLIGHT)
+			if (wait_completion(stream)==-1) {
+				set_error(stream, errno);
+				errno = stream->error;
+				return -1;
+			}
+
+		if (buffer->result<0) {
+			if (buffer->result==-EINTR || buffer->result==-EAGAIN) {
+				//retry the same read
+				restart_read_ahead(stream, stream->position);
+				continue;
+			}
+			set_error(stream, -buffer->result);
+			restart_read_ahead(stream, stream->position);
+			errno = stream->error;
+			return -1;
+		}
+		buffer->length = (size_t)buffer->result;
+
+		if (buffer->done < buffer->length) {
+			count = buffer->length - buffer->done;
+			if (count > size)
+				count = size;
+			memcpy(data, buffer->data + buffer->done, count);
+			buffer->done += count;
+			stream->position += count;
+			return (ssize_t)count;
+		}
+
+		if (buffer->length==0) {
+			//End of file - stop reading ahead
+			stream->eof = 1 ;
+			return 0;
+		}
+
+		//This buffer was returned to stdio - reuse it
+		buffer->state = AIO_BUFFER_FREE;
+		stream->next = (stream->next+1) % FASTX_AIO_BUFFERS;
+		stream->queued--;
+
+		//A short read of a regular file leaves a gap before the next buffer
+		if (stream->seekable && buffer->length < buffer->requested)
+			restart_read_ahead(stream, stream->position);
+	}
+}
+
+static int aio_seek_input(void *cookie, off64_t *offset, int whence)
+{
+	AIO_STREAM *stream = (AIO_STREAM*)cookie;
+	struct stat st;
+	off64_t position;
+
+	switch (whence) {
+	case SEEK_SET:
+		position = *offset;
+		break;
+	case SEEK_CUR:
+		position = stream->position + *offset;
+		break;
+	case SEEK_END:
+		if (fstat(stream->fd, &st)!=0)
+			return -1;
+		position = st.st_size + *offset;
+		break;
+	default:
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (position==stream->position) {
+		*offset = position;
+		return 0;
+	}
+	if (!stream->seekable || position<0) {
+		errno = ESPIPE;
+		return -1;
+	}
+
+	restart_read_ahead(stream, position);
+	*offset = position;
+	return 0;
+}
+
+static int aio_close(void *cookie)
+{
+	return stream_free((AIO_STREAM*)cookie);
+}
+
+FILE* fastx_aio_open_input(int fd, off_t offset, size_t buffer_size)
+{
+	cookie_io_functions_t functions = { aio_read, NULL, aio_seek_input, aio_close };
+	AIO_STREAM *stream;
+	FILE *input;
+
+	stream = stream_new(fd, buffer_size);
+	if (stream==NULL)
+		return NULL;
+	if (stream->seekable)
+		stream->offset = stream->position = offset;
+
+	input = fopencookie(stream, "r", functions);
+	if (input==NULL) {
+		stream_free(stream);
+		return NULL;
+	}
+	fastx_iotune_report_buffer_size(stream->buffer_size, 0);
+	return input;
+}
+
+/*
+	Output streams -
+	'next' is the buffer being filled. Full buffers are written in the
+	background, and reused once the write completes.
+*/
+static int wait_write(AIO_STREAM *stream, int index);
+
+static int wait_writes(AIO_STREAM *stream)
+{
+	while (stream->in_flight>0)
+		if (wait_write(stream, -1)!=0)
+			return -1;
+	return 0;
+}
+
+static int submit_write(AIO_STREAM *stream, unsigned int index)
+{
+	struct aio_buffer *buffer = &stream->buffers[index];
+
+	//Pipes: one write at a time, in order
+	if (!stream->seekable && wait_writes(stream)!=0)
+		return -1;
+
+	buffer->iov.iov_base = buffer->data + buffer->done;
+	buffer->iov.iov_len = buffer->length - buffer->done;
+	if (submit_buffer(stream, index, IORING_OP_WRITEV,
+			stream->seekable ? buffer->offset + (off_t)buffer->done : 0)!=0) {
+		set_error(stream, errno);
+		return -1;
+	}
+	return 0;
+}
+
+// Handle one completed write (short writes are resubmitted)
+static void complete_write(AIO_STREAM *stream, unsigned int index)
+{
+	struct aio_buffer *buffer = &stream->buffers[index];
+
+	if (buffer->result<0 && buffer->result!=-EINTR && buffer->result!=-EAGAIN) {
+		set_error(stream, -buffer->result);
+		buffer->state = AIO_BUFFER_FREE;
+		return;
+	}
+	if (buffer->result==0) {
+		set_error(stream, EIO);
+		buffer->state = AIO_BUFFER_FREE;
+		return;
+	}
+	if (buffer->result>0)
+		buffer->done += (size_t)buffer->result;
+
+	if (buffer->done < buffer->length) {
+		if (submit_write(stream, index)!=0)
+			buffer->state = AIO_BUFFER_FREE;
+		return;
+	}
+	buffer->state = AIO_BUFFER_FREE;
+}
+
+/*
+	Handle completed writes until the buffer is free
+	(or until one write completes, if index==-1).
+*/
+static int wait_write(AIO_STREAM *stream, int index)
+{
+	int completed;
+
+	while (stream->in_flight>0
+		&& (index==-1 || stream->buffers[index].state!=AIO_BUFFER_FREE)) {
+		completed = wait_completion(stream);
+		if (completed==-1) {
+			set_error(stream, errno);
+			return -1;
+		}
+		complete_write(stream, (unsigned int)completed);
+		if (index==-1)
+			break;
+	}
+	return (stream->error!=0) ? -1 : 0 ;
+}
+
+static int flush_buffer(AIO_STREAM *stream)
+{
+	struct aio_buffer *buffer = &stream->buffers[stream->next];
+
+	if (buffer->length==0)
+		return 0;
+
+	buffer->offset = stream->offset;
+	buffer->done = 0 ;
+	stream->offset += (off_t)buffer->length;
+	if (submit_write(stream, stream->next)!=0)
+		return -1;
+
+	stream->next = (stream->next+1) % FASTX_AIO_BUFFERS;
+	if (wait_write(stream, (int)stream->next)!=0)
+		return -1;
+	stream->buffers[stream->next].length = 0 ;
+	return 0;
+}
+
+// Write the last buffer, and wait for all the writes to complete
+static void finish_output(AIO_STREAM *stream)
+{
+	if (stream->error==0)
+		flush_buffer(stream);
+	wait_writes(stream);
+
+	//Leave the (shared) file position after the written data
+	if (stream->seekable && stream->error==0
+	    && lseek(stream->fd, stream->offset, SEEK_SET)==-1)
+		set_error(stream, errno);
+}
+
+// Blocking writes (after finish_output() )
+static ssize_t write_synchronous(AIO_STREAM *stream, const char *data, size_t size)
+{
+	size_t written = 0 ;
+	ssize_t rc;
+
+	while (written < size) {
+		rc = write(stream->fd, data + written, size - written);
+		if (rc==-1 && errno==EINTR)
+			continue;
+		if (rc<=0)
+			return (written>0) ? (ssize_t)written : -1;
+		written += (size_t)rc;
+	}
+	return (ssize_t)written;
+}
+
+static ssize_t aio_write(void *cookie, const char *data, size_t size)
+{
+	AIO_STREAM *stream = (AIO_STREAM*)cookie;
+	struct aio_buffer *buffer;
+	size_t written = 0 ;
+	size_t count;
+
+	if (stream->synchronous)
+		return write_synchronous(stream, data, size);
+
+	while (written < size) {
+		if (stream->error!=0) {
+			errno = stream->error;
+			return (written>0) ? (ssize_t)written : -1;
+		}
+
+		buffer = &stream->buffers[stream->next];
+		count = stream->buffer_size - buffer->length;
+		if (count > size-written)
+			count = size-written;
+		memcpy(buffer->data + buffer->length, data + written, count);
+		buffer->length += count;
+		written += count;
+
+		//Errors are reported by the next write (or by fclose)
+		if (buffer->length==stream->buffer_size)
+			flush_buffer(stream);
+	}
+	return (ssize_t)written;
+}
+
+/*
+	At exit, stdio flushes the streams but doesn't close them - finish the
+	open output streams here (atexit handlers run before stdio's flush),
+	and let anything written later go straight to the files.
+*/
+static pthread_mutex_t output_streams_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t output_streams_once = PTHREAD_ONCE_INIT;
+static AIO_STREAM *output_streams = NULL;
+
+static void finish_output_streams_at_exit()
+{
+	AIO_STREAM *stream;
+
+	pthread_mutex_lock(&output_streams_lock);
+	for (stream=output_streams; stream!=NULL; stream=stream->next_output) {
+		//Failed streams were reported by their writer (which is probably exiting)
+		if (stream->error!=0)
+			continue;
+		fflush(stream->file);
+		finish_output(stream);
+		stream->synchronous = 1 ;
+		//exit() can't be called again from here
+		if (stream->error!=0) {
+			errno = stream->error;
+			warn("writing output file failed");
+			_exit(1);
+		}
+	}
+	pthread_mutex_unlock(&output_streams_lock);
+}
+
+static void register_output_streams_at_exit()
+{
+	atexit(finish_output_streams_at_exit);
+}
+
+static void add_output_stream(AIO_STREAM *stream)
+{
+	pthread_once(&output_streams_once, register_output_streams_at_exit);
+
+	pthread_mutex_lock(&output_streams_lock);
+	stream->next_output = output_streams;
+	output_streams = stream;
+	pthread_mutex_unlock(&output_streams_lock);
+}
+
+static void remove_output_stream(AIO_STREAM *stream)
+{
+	AIO_STREAM **p;
+
+	pthread_mutex_lock(&output_streams_lock);
+	for (p=&output_streams; *p!=NULL; p=&(*p)->next_output)
+		if (*p==stream) {
+			*p = stream->next_output;
+			break;
+		}
+	pthread_mutex_unlock(&output_streams_lock);
+}
+
+static int aio_close_output(void *cookie)
+{
+	AIO_STREAM *stream = (AIO_STREAM*)cookie;
+
+	remove_output_stream(stream);
+	if (!stream->synchronous)
+		finish_output(stream);
+	return stream_free(stream);
+}
+
+FILE* fastx_aio_open_output(int fd, size_t buffer_size)
+{
+	cookie_io_functions_t functions = { NULL, aio_write, NULL, aio_close_output };
+	AIO_STREAM *stream;
+	FILE *output;
+
+	stream = stream_new(fd, buffer_size);
+	if (stream==NULL)
+		return NULL;
+	if (stream->seekable) {
+		stream->offset = lseek(fd, 0, SEEK_CUR);
+		if (stream->offset==-1)
+			stream->seekable = 0 ;
+	}
+
+	output = fopencookie(stream, "w", functions);
+	if (output==NULL) {
+		stream_free(stream);
+		return NULL;
+	}
+	stream->file = output;
+	add_output_stream(stream);
+	fastx_iotune_report_buffer_size(stream->buffer_size, 1);
+	return output;
+}
+
+#else
+
+/*
+	No io_uring - always use regular streams.
+*/
+FILE* fastx_aio_open_input(int fd, off_t offset, size_t buffer_size)
+{
+	(void)fd;
+	(void)offset;
+	(void)buffer_size;
+	return NULL;
+}
+
+FILE* fastx_aio_open_output(int fd, size_t buffer_size)
+{
+	(void)fd;
+	(void)buffer_size;
+	return NULL;
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_AIO_H__
+#define __FASTX_AIO_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/*
+	Asynchronous I/O (see fastx_set_default_async_io() ) -
+	Streams whose reads and writes are done by io_uring, in the
+	background, so that the I/O overlaps with the processing (on the
+	same thread).
+
+	Input streams keep FASTX_AIO_BUFFERS reads in flight (read-ahead),
+	output streams collect the written data into FASTX_AIO_BUFFERS
+	buffers, and write each one when it fills (write-behind).
+	Each buffer is 'buffer_size' bytes (0 = FASTX_AIO_BUFFER_SIZE) - the
+	size is reported with the stage timers (see fastx_timers.h).
+	Regular files are read and written at explicit offsets, with all the
+	buffers in flight; pipes (and files opened with O_APPEND) one buffer
+	at a time, to keep the order.
+
+	The streams are regular stdio streams (see fopencookie(3) ), so the
+	readers and writers use them as usual - except that fileno() returns -1.
+
+	The functions return NULL if io_uring isn't available (not built in,
+	or not allowed by the kernel) - callers then use a regular stdio
+	stream, with blocking read(2)/write(2) calls.
+*/
+
+#define FASTX_AIO_BUFFERS	(4)
+#define FASTX_AIO_BUFFER_SIZE	(1024*1024)
+
+/*
+	Read 'fd' from 'offset' (for pipes: from the current position).
+	'fd' is duplicated - the caller still owns (and closes) it.
+*/
+FILE* fastx_aio_open_input(int fd, off_t offset, size_t buffer_size);
+
+/*
+	Write to 'fd' (regular files: from the current position).
+	'fd' is duplicated - the caller still owns (and closes) it.
+	When a regular file is closed, its position is moved past the written data.
+*/
+FILE* fastx_aio_open_output(int fd, size_t buffer_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
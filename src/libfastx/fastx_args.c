@@ -15,15 +15,11 @@
     You should have received a copy of the GNU Affero General Public License
     along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
-#include <err.h>
 #include <stdio.h>
-#include <stdlib.h>
-#include <unistd.h>
-#include <sys/types.h>
-#include <string.h>
-#include <getopt.h>
 
+#include "fastx.h"
 #include "fastx_args.h"
+#include "fastx_context.h"
 
 /*
  * Each program should specify its own usage string
@@ -32,113 +28,93 @@ extern char* usage;
 
 
 /*
- * globals.. yuck
- *
- * some day this will be a stand alone class
+ * The default context, for the programs which use the functions below
+ * (see fastx_context.h)
  */
-const char* input_filename = "-";
-const char* output_filename = "-";
-int verbose = 0;
-int compress_output = 0 ;
-int fastq_ascii_quality_offset = 33 ;
-FILE* report_file;
+static FASTX_CONTEXT default_context;
+static int default_context_ready = 0 ;
+
+static FASTX_CONTEXT* get_default_context()
+{
+	if (!default_context_ready) {
+		fastx_context_init(&default_context);
+		default_context_ready = 1 ;
+	}
+	return &default_context;
+}
 
 int get_fastq_ascii_quality_offset()
 {
-	return fastq_ascii_quality_offset;
+	return get_default_context()->fastq_ascii_quality_offset;
 }
 
 const char* get_input_filename()
 {
-	return input_filename;
+	return get_default_context()->input_filename;
 }
 
 const char* get_output_filename()
 {
-	return output_filename;
+	return get_default_context()->output_filename;
 }
 
 int verbose_flag()
 {
-	return verbose;
+	return get_default_context()->verbose;
 }
 
 int compress_output_flag()
 {
-	return compress_output ;
+	return get_default_context()->compress_output ;
+}
+
+void fastx_allow_paired_files()
+{
+	get_default_context()->allow_paired_files = 1;
+}
+
+int paired_files_flag()
+{
+	return (get_default_context()->input2_filename != NULL
+		|| get_default_context()->interleaved) ;
+}
+
+const char* get_input2_filename()
+{
+	return get_default_context()->input2_filename;
+}
+
+const char* get_output2_filename()
+{
+	return get_default_context()->output2_filename;
 }
 
 FILE* get_report_file()
 {
-	return report_file;
+	return get_default_context()->report_file;
+}
+
+size_t get_input_files_count()
+{
+	return get_default_context()->input_files_count;
 }
 
 int fastx_parse_cmdline( int argc, char* argv[],
 			 const char* program_options,
 			 parse_argument_func program_parse_args ) 
 {
-	int opt;
-
-	char combined_options_string[100];
-
-	strcpy(combined_options_string, "Q:zhvi:o:");
-	strcat(combined_options_string, program_options);
-	
-	report_file = stderr ; //since the default output is STDOUT, the report goes by default to STDERR
-
-	while ( (opt = getopt(argc, argv, combined_options_string) ) != -1 ) {
-		
-		// Parse the program's custom options
-		if ( strchr(program_options, opt) != NULL ) {
-			if (!program_parse_args(optind, opt, optarg))
-				return 0;
-			continue;
-		}
-
-		//Parse the default options
-		switch(opt) {
-		case 'h':
-			printf("%s", usage);
-			exit(1);
-		
-		case 'v':
-			verbose = 1 ;
-			break ;
-
-		case 'z':
-			compress_output = 1 ;
-			break ;
-
-
-		case 'i':
-			if (optarg==NULL)
-				errx(1,"[-i] option requires FILENAME argument");
-			input_filename = optarg;
-			break;
-
-		case 'o':
-			if (optarg==NULL)
-				errx(1,"[-o] option requires FILENAME argument");
-			output_filename = optarg;
-			
-			//The user specified a specific output file, so the report can go to STDOUT
-			report_file = stdout;
-			break;
-			
-		case 'Q':
-			if (optarg==NULL)
-				errx(1,"[-Q] option requires VALUE argument");
-			fastq_ascii_quality_offset = atoi(optarg);
-			break;
-
-		default:
-			printf("use '-h' for usage information.\n");
-			exit(1);
-			break;
-
-		}
-	}
+	FASTX_CONTEXT *ctx = get_default_context();
+
+	ctx->usage = usage;
+	if (!fastx_context_parse_cmdline(ctx, argc, argv, program_options, program_parse_args))
+		return 0;
 
+	//Readers initialized with fastx_init_reader() use the default options
+	fastx_set_default_io_options(&ctx->io_options);
 	return 1;
 }
 
+void fastx_report_timings()
+{
+	fastx_context_report_timings(get_default_context());
+}
@@ -18,11 +18,75 @@
 #ifndef __FASTX_ARGS__
 #define __FASTX_ARGS__
 
+#include <stdio.h>
+
+#include "fastx_context.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-//One day this would all be OO :-)
+/*
+	The command-line options of programs which use a single (default)
+	context - see fastx_context.h for programs which need more than one.
+*/
+
+/*
+	Usage text of the options every program accepts (parsed by
+	fastx_parse_cmdline() and fastx_context_parse_cmdline() ).
+	Programs append one of these to their own usage string:
+	FASTX_COMMON_OPTIONS_USAGE if they write OUTFILE with libfastx's writer,
+	FASTX_COMMON_INPUT_OPTIONS_USAGE if they write their output themselves.
+*/
+#define FASTX_USAGE_INPUT_SELECTION \
+"   [--input-list FILE]\n" \
+"                = Read the input file names from FILE (one per line). All the input files\n" \
+"                  (and repeated [-i INFILE] options) are processed back to back, as one input.\n" \
+"   [--shard I/N]\n" \
+"                = Process only the I-th of N equal parts of INFILE (for splitting\n" \
+"                  the work between N jobs, each processing a different part).\n" \
+"                  With several input files, each file is split separately: the\n" \
+"                  shards hold the same records as the whole input, in another order.\n" \
+"   [--byte-range START:END]\n" \
+"                = Process only the records which start in bytes START to END-1 of INFILE\n" \
+"                  (of each input file).\n" \
+"   [--reader-threads N]\n" \
+"                = Parse INFILE with N threads (uncompressed files only).\n"
+
+#define FASTX_USAGE_REPORTS \
+"   [--timings-json FILE]\n" \
+"                = Write the time spent in each stage (parsing, processing, writing...)\n" \
+"                  and the number of bytes in/out, as JSON, to FILE ([-v] reports them too).\n" \
+"   [--metrics-file FILE]\n" \
+"                = Write a snapshot of the progress (records, records/s, input\n" \
+"                  bytes consumed, estimated time left, memory) to FILE while\n" \
+"                  running, as JSON (or in Prometheus format, if FILE ends with '.prom').\n" \
+"   [--metrics-interval SECONDS]\n" \
+"                = Write the metrics snapshot every SECONDS seconds (default 10).\n"
+
+#define FASTX_COMMON_OPTIONS_USAGE \
+FASTX_USAGE_INPUT_SELECTION \
+"   [--async-io]\n" \
+"                = Read INFILE and write OUTFILE with io_uring, overlapping the\n" \
+"                  I/O with the processing (regular I/O if not supported).\n" \
+"   [--io-buffer-size N]\n" \
+"                = Read and write in blocks of N bytes (K/M suffixes, default 1M,\n" \
+"                  0 = the system default).\n" \
+"   [--huge-pages]\n" \
+"                = Put the I/O buffers on huge pages (if the system allows).\n" \
+FASTX_USAGE_REPORTS
+
+#define FASTX_COMMON_INPUT_OPTIONS_USAGE \
+FASTX_USAGE_INPUT_SELECTION \
+"   [--async-io]\n" \
+"                = Read INFILE with io_uring, overlapping the input with the\n" \
+"                  processing (regular I/O if not supported).\n" \
+"   [--io-buffer-size N]\n" \
+"                = Read in blocks of N bytes (K/M suffixes, default 1M,\n" \
+"                  0 = the system default).\n" \
+"   [--huge-pages]\n" \
+"                = Put the input buffer on huge pages (if the system allows).\n" \
+FASTX_USAGE_REPORTS
 
 const char* get_input_filename();
 const char* get_output_filename();
@@ -31,7 +95,25 @@ int compress_output_flag();
 int get_fastq_ascii_quality_offset();
 FILE* get_report_file();
 
-typedef int (*parse_argument_func)(int optind, int optc, char* optarg)  ;
+// Paired-end files ([-I] and [-O]) and interleaved paired-end files ([-P]).
+// Programs which can process paired-end files call fastx_allow_paired_files()
+// before fastx_parse_cmdline(). The second filenames are NULL if not given,
+// meaning the mates are interleaved in the first file
+// (see fastx_init_paired_reader() ).
+void fastx_allow_paired_files();
+int paired_files_flag();
+const char* get_input2_filename();
+const char* get_output2_filename();
+
+// Number of input files ([-i] can be repeated, see fastx_context.h).
+// The readers of get_input_filename() read all of them, back to back.
+size_t get_input_files_count();
+
+// Print the per-file input counts (with [-v] and multiple input files)
+// and the stage timers report (with [-v]), write the JSON timings file
+// (with [--timings-json FILE]), and the final run metrics snapshot
+// (with [--metrics-file FILE]). Programs call this after their own report.
+void fastx_report_timings();
 
 int fastx_parse_cmdline( int argc, char* argv[],
 			 const char* program_options,
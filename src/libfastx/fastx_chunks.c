@@ -0,0 +1,484 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "fastx_error.h"
+#include "fastx.h"
+#include "fastx_chunks.h"
+#include "fastx_timers.h"
+
+/*
+	Worker thread functions
+*/
+
+/*
+	Returns the offset of the first record which starts at (or after)
+	'offset', or the file size if there is none.
+	This is the same rule the sequential reader uses to find the first
+	record of an input range (see seek_input_range_start() in fastx.c).
+*/
+static off_t find_record_start(const FASTX_CHUNK_READER *reader, off_t offset)
+{
+	const char *data_end = reader->data + reader->data_size;
+	const char *line[3];
+	const char *p;
+	size_t lines = 0 ;
+	size_t i;
+
+	p = reader->data + offset ;
+	if (offset>0) {
+		p = memchr(p-1, '\n', data_end - (p-1));
+		if (p==NULL)
+			return reader->data_size;
+		p++;
+	}
+
+	while (p < data_end) {
+		//Keep the last three lines (of which the record might start at the first)
+		i = lines % 3 ;
+		line[i] = p ;
+		lines++;
+
+		if (!reader->read_fastq && *p=='>')
+			return p - reader->data;
+
+		i = (lines-3) % 3 ;
+		if (reader->read_fastq && lines>=3 && *line[i]=='@' && *line[(i+2)%3]=='+')
+			return line[i] - reader->data;
+
+		p = memchr(p, '\n', data_end - p);
+		if (p==NULL)
+			break;
+		p++;
+	}
+	return reader->data_size;
+}
+
+/*
+	Gets the next line, without the CR/LF (same as fgets()+chomp() ).
+	Returns 0 at the end of the file, or if the line is too long
+	(fgets() would split it).
+*/
+static int next_line(const FASTX_CHUNK_READER *reader, const char **p,
+		const char **line, unsigned int *length)
+{
+	const char *data_end = reader->data + reader->data_size;
+	const char *eol, *next, *cr;
+
+	if (*p >= data_end)
+		return 0;
+
+	eol = memchr(*p, '\n', data_end - *p);
+	next = (eol!=NULL) ? eol+1 : data_end ;
+	if (next - *p >= MAX_SEQ_LINE_LENGTH-1)
+		return 0;
+
+	//chomp() ends the line at the first CR or LF
+	cr = memchr(*p, '\r', next - *p);
+	if (cr==NULL)
+		cr = (eol!=NULL) ? eol : data_end ;
+
+	*line = *p;
+	*length = cr - *p;
+	*p = next;
+	return 1;
+}
+
+/*
+	Parse and validate the record at 'p'.
+	Returns 0 (leaving 'p' unchanged) if the record can't be handled here.
+*/
+static int parse_record(const FASTX_CHUNK_READER *reader, const char **p,
+		struct fastx_chunk_record *record)
+{
+	const char *q = *p;
+	const char *line;
+	unsigned int length, i;
+	int quality;
+
+	if (!next_line(reader, &q, &line, &length) || length==0
+	    || line[0] != (reader->read_fastq ? '@' : '>'))
+		return 0;
+	record->name = line+1;
+	record->name_length = length-1;
+
+	if (!next_line(reader, &q, &line, &length) || length==0)
+		return 0;
+	for (i=0; i<length; i++)
+		if (!reader->allowed_nucleotides[(unsigned char)line[i]])
+			return 0;
+	record->nucleotides = line;
+	record->length = length;
+
+	if (reader->read_fastq) {
+		if (!next_line(reader, &q, &line, &length) || length==0 || line[0]!='+')
+			return 0;
+		record->name2 = line+1;
+		record->name2_length = length-1;
+
+		//Numeric quality scores are left for the sequential reader
+		if (!next_line(reader, &q, &line, &length) || length!=record->length)
+			return 0;
+		for (i=0; reader->decode_quality && i<length; i++) {
+			quality = line[i] - reader->fastq_ascii_quality_offset;
+			if (quality < MIN_QUALITY_VALUE || quality > MAX_QUALITY_VALUE)
+				return 0;
+		}
+		record->quality = line;
+	}
+
+	record->bytes = q - *p;
+	*p = q;
+	return 1;
+}
+
+static void parse_chunk(const FASTX_CHUNK_READER *reader, size_t chunk,
+		struct fastx_chunk_batch *batch)
+{
+	off_t chunk_start = reader->start + (off_t)chunk * FASTX_CHUNK_SIZE ;
+	off_t chunk_end = chunk_start + FASTX_CHUNK_SIZE ;
+	struct timespec started, finished;
+	const char *p;
+
+	if (chunk_end > reader->end)
+		chunk_end = reader->end;
+
+	batch->chunk = chunk;
+	batch->fallback = 0 ;
+	batch->records_count = 0 ;
+	batch->start_offset = (chunk==0) ? reader->start : find_record_start(reader, chunk_start);
+
+	if (fastx_timers.enabled)
+		clock_gettime(CLOCK_MONOTONIC, &started);
+
+	p = reader->data + batch->start_offset;
+	while (p < reader->data + chunk_end) {
+		if (batch->records_count == batch->records_capacity) {
+			batch->records_capacity = (batch->records_capacity>0) ? batch->records_capacity*2 : 4096 ;
+			batch->records = realloc(batch->records,
+					batch->records_capacity * sizeof(struct fastx_chunk_record));
+			if (batch->records==NULL)
+				fastx_err(1,"failed to allocate input chunk");
+		}
+		if (!parse_record(reader, &p, &batch->records[batch->records_count])) {
+			batch->fallback = 1 ;
+			break;
+		}
+		batch->records_count++;
+	}
+	batch->end_offset = p - reader->data;
+
+	//Whole chunks are timed (a couple of clock reads per FASTX_CHUNK_SIZE bytes)
+	if (fastx_timers.enabled) {
+		clock_gettime(CLOCK_MONOTONIC, &finished);
+		__atomic_fetch_add(&fastx_timers.reader_threads_nanoseconds,
+			(uint64_t)(finished.tv_sec - started.tv_sec) * 1000000000ULL
+				+ finished.tv_nsec - started.tv_nsec,
+			__ATOMIC_RELAXED);
+	}
+}
+
+static void* chunk_worker_thread(void *arg)
+{
+	FASTX_CHUNK_READER *reader = (FASTX_CHUNK_READER*)arg;
+	struct fastx_chunk_batch *batch;
+	size_t chunk;
+
+	pthread_mutex_lock(&reader->lock);
+	while (!reader->stop && reader->next_chunk < reader->chunks_count) {
+		//Wait until the chunk's batch is no longer used
+		if (reader->next_chunk >= reader->current_chunk + reader->batches_count) {
+			pthread_cond_wait(&reader->batch_free, &reader->lock);
+			continue;
+		}
+		chunk = reader->next_chunk++;
+		batch = &reader->batches[chunk % reader->batches_count];
+		pthread_mutex_unlock(&reader->lock);
+
+		parse_chunk(reader, chunk, batch);
+
+		pthread_mutex_lock(&reader->lock);
+		batch->ready = 1 ;
+		pthread_cond_signal(&reader->batch_ready);
+	}
+	pthread_mutex_unlock(&reader->lock);
+	return NULL;
+}
+
+/*
+	Reading thread functions
+*/
+FASTX_CHUNK_READER* fastx_chunk_reader_new(const FASTX *pFASTX, off_t start, off_t end,
+		unsigned int threads)
+{
+	FASTX_CHUNK_READER *reader;
+	struct stat st;
+	void *data;
+	size_t i;
+
+	//Without a mapping (e.g. a virtual memory limit, see 'ulimit -v'),
+	//the sequential reader reads the file
+	if (fstat(fileno(pFASTX->input), &st)!=0 || st.st_size==0)
+		return NULL;
+	data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(pFASTX->input), 0);
+	if (data==MAP_FAILED)
+		return NULL;
+	madvise(data, st.st_size, MADV_SEQUENTIAL);
+
+	reader = calloc(1, sizeof(FASTX_CHUNK_READER));
+	if (reader==NULL)
+		fastx_err(1,"failed to allocate input chunks");
+
+	reader->input = pFASTX->input;
+	reader->data = (const char*)data;
+	reader->data_size = st.st_size;
+
+	reader->read_fastq = pFASTX->read_fastq;
+	reader->fastq_ascii_quality_offset = pFASTX->fastq_ascii_quality_offset;
+	reader->decode_quality = (pFASTX->options.record_fields & FASTX_FIELD_QUALITY)!=0 ;
+	reader->raw_records = (pFASTX->options.record_fields & FASTX_FIELD_RAW_RECORD)!=0 ;
+	memcpy(reader->allowed_nucleotides, pFASTX->allowed_nucleotides,
+		sizeof(reader->allowed_nucleotides));
+
+	reader->page_size = (size_t)sysconf(_SC_PAGESIZE);
+	reader->start = start;
+	reader->released = 0 ;
+	reader->end = (end<0 || end>st.st_size) ? st.st_size : end ;
+	if (reader->end > reader->start)
+		reader->chunks_count = (reader->end - reader->start + FASTX_CHUNK_SIZE - 1) / FASTX_CHUNK_SIZE ;
+
+	reader->threads_count = (threads < reader->chunks_count) ? threads : reader->chunks_count ;
+	if (reader->threads_count==0) {
+		reader->finished = 1 ;
+		return reader;
+	}
+
+	//Two batches per worker: one being parsed, one ready for the reading thread
+	reader->batches_count = reader->threads_count * 2 ;
+	reader->batches = calloc(reader->batches_count, sizeof(struct fastx_chunk_batch));
+	reader->threads = calloc(reader->threads_count, sizeof(pthread_t));
+	if (reader->batches==NULL || reader->threads==NULL)
+		fastx_err(1,"failed to allocate input chunks");
+
+	if (fastx_timers.enabled)
+		__atomic_fetch_add(&fastx_timers.reader_threads, reader->threads_count,
+				__ATOMIC_RELAXED);
+
+	pthread_mutex_init(&reader->lock, NULL);
+	pthread_cond_init(&reader->batch_ready, NULL);
+	pthread_cond_init(&reader->batch_free, NULL);
+	for (i=0; i<reader->threads_count; i++)
+		if (pthread_create(&reader->threads[i], NULL, chunk_worker_thread, reader)!=0)
+			fastx_errx(1,"failed to start input reader thread");
+
+	return reader;
+}
+
+// Stop the workers, and release everything but the reader itself
+static void stop_chunk_reader(FASTX_CHUNK_READER *reader)
+{
+	size_t i;
+
+	pthread_mutex_lock(&reader->lock);
+	reader->stop = 1 ;
+	pthread_cond_broadcast(&reader->batch_free);
+	pthread_mutex_unlock(&reader->lock);
+
+	for (i=0; i<reader->threads_count; i++)
+		pthread_join(reader->threads[i], NULL);
+
+	for (i=0; i<reader->batches_count; i++)
+		free(reader->batches[i].records);
+	free(reader->batches);
+	free(reader->threads);
+	reader->batches = NULL;
+	reader->threads = NULL;
+
+	//The file stays mapped until fastx_chunk_reader_free() -
+	//raw records (see FASTX_FIELD_RAW_RECORD) might still be written from it
+}
+
+void fastx_chunk_reader_free(FASTX_CHUNK_READER *reader)
+{
+	if (reader->threads!=NULL)
+		stop_chunk_reader(reader);
+	if (reader->data!=NULL)
+		munmap((void*)reader->data, reader->data_size);
+	if (reader->batches_count>0) {
+		pthread_mutex_destroy(&reader->lock);
+		pthread_cond_destroy(&reader->batch_ready);
+		pthread_cond_destroy(&reader->batch_free);
+	}
+	free(reader);
+}
+
+static void switch_to_sequential(FASTX_CHUNK_READER *reader, off_t offset)
+{
+	stop_chunk_reader(reader);
+	if (fseeko(reader->input, offset, SEEK_SET)!=0)
+		fastx_err(1,"failed to seek in input file");
+	reader->sequential = 1 ;
+}
+
+// The size of the record, as written by fastx_write_record()
+static size_t record_size(int fastq, const struct fastx_chunk_record *record)
+{
+	size_t size = record->name_length + 2 + record->length + 1 ;
+
+	if (fastq)
+		size += record->name2_length + 2 + record->length + 1 ;
+	return size;
+}
+
+static void fill_record(const FASTX_CHUNK_READER *reader,
+		const struct fastx_chunk_record *record, FASTX *pFASTX)
+{
+	unsigned int i;
+
+	pFASTX->input_line_number += 2 ;
+
+	pFASTX->input_sequence_id_prefix[0] = reader->read_fastq ? '@' : '>' ;
+	memcpy(pFASTX->name, record->name, record->name_length);
+	pFASTX->name[record->name_length] = 0 ;
+
+	memcpy(pFASTX->nucleotides, record->nucleotides, record->length);
+	pFASTX->nucleotides[record->length] = 0 ;
+	pFASTX->sequence_length = record->length;
+	pFASTX->view_start = 0 ;
+	pFASTX->view_end = record->length;
+
+	if (reader->read_fastq) {
+		pFASTX->input_line_number += 2 ;
+
+		pFASTX->input_name2_prefix[0] = '+' ;
+		memcpy(pFASTX->name2, record->name2, record->name2_length);
+		pFASTX->name2[record->name2_length] = 0 ;
+
+		pFASTX->raw_quality = record->quality;
+		pFASTX->raw_quality_length = record->length;
+		pFASTX->read_fastq_ascii = 1 ;
+		pFASTX->quality_decoded = reader->decode_quality;
+		if (pFASTX->quality_decoded) {
+			fastx_timer_switch(FASTX_TIMER_QUALITY);
+			for (i=0; i<record->length; i++)
+				pFASTX->quality[i] = record->quality[i] - reader->fastq_ascii_quality_offset;
+			fastx_timer_switch(FASTX_TIMER_PARSE);
+		}
+
+		if (pFASTX->copy_input_fastq_format_to_output)
+			pFASTX->write_fastq_ascii = pFASTX->read_fastq_ascii;
+	}
+
+	//The record's bytes can be written as-is only if its lines
+	//end with a LF (without a CR), like fastx_write_record() writes them
+	if (reader->raw_records
+	    && record->bytes == record_size(reader->read_fastq, record)) {
+		pFASTX->raw_record = record->name - 1 ;
+		pFASTX->raw_record_length = record->bytes;
+	}
+
+	pFASTX->num_input_sequences++;
+	pFASTX->num_input_reads += get_reads_count(pFASTX);
+
+	if (fastx_timers.enabled)
+		fastx_timers.bytes_in += record->bytes;
+}
+
+/*
+	Release the pages of the records which were read (up to 'offset'),
+	so that the resident memory doesn't grow with the input file.
+	The mapping stays valid - records which still point into the released
+	pages (e.g. raw records waiting to be written) read them again from the
+	page cache.
+*/
+static void release_read_pages(FASTX_CHUNK_READER *reader, off_t offset)
+{
+	off_t end = offset & ~((off_t)reader->page_size - 1);
+
+	if (end <= reader->released)
+		return;
+	madvise((char*)reader->data + reader->released, end - reader->released, MADV_DONTNEED);
+	reader->released = end;
+}
+
+int fastx_chunk_reader_next(FASTX_CHUNK_READER *reader, FASTX *pFASTX)
+{
+	struct fastx_chunk_batch *batch;
+	off_t next_offset;
+
+	if (reader->sequential)
+		return -1;
+	if (reader->finished)
+		return 0;
+
+	while (1) {
+		batch = &reader->batches[reader->current_chunk % reader->batches_count];
+
+		pthread_mutex_lock(&reader->lock);
+		while (!batch->ready)
+			pthread_cond_wait(&reader->batch_ready, &reader->lock);
+		pthread_mutex_unlock(&reader->lock);
+
+		if (reader->current_record < batch->records_count) {
+			fill_record(reader, &batch->records[reader->current_record++], pFASTX);
+			return 1;
+		}
+
+		if (batch->fallback) {
+			switch_to_sequential(reader, batch->end_offset);
+			return -1;
+		}
+
+		//Move to the next chunk
+		next_offset = batch->end_offset;
+		pthread_mutex_lock(&reader->lock);
+		batch->ready = 0 ;
+		reader->current_chunk++;
+		pthread_cond_broadcast(&reader->batch_free);
+		pthread_mutex_unlock(&reader->lock);
+		reader->current_record = 0 ;
+		release_read_pages(reader, next_offset);
+
+		if (reader->current_chunk == reader->chunks_count) {
+			stop_chunk_reader(reader);
+			reader->finished = 1 ;
+			return 0;
+		}
+
+		//The next chunk should start exactly where this one ended.
+		//If it doesn't (only possible with invalid input), let the
+		//sequential reader continue (and find the problem).
+		batch = &reader->batches[reader->current_chunk % reader->batches_count];
+		pthread_mutex_lock(&reader->lock);
+		while (!batch->ready)
+			pthread_cond_wait(&reader->batch_ready, &reader->lock);
+		pthread_mutex_unlock(&reader->lock);
+
+		if (batch->start_offset != next_offset) {
+			switch_to_sequential(reader, next_offset);
+			return -1;
+		}
+	}
+}
@@ -0,0 +1,138 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_CHUNKS_H__
+#define __FASTX_CHUNKS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "fastx.h"
+
+/*
+	Parallel chunked reader -
+	For uncompressed regular input files (see fastx_set_default_reader_threads()).
+
+	The input file is mmap'd and divided into fixed-size chunks. Worker
+	threads parse and validate the records which start in each chunk
+	(finding the first record like the input ranges do, see
+	fastx_set_default_input_shard()), and fastx_read_next_record() returns
+	the parsed records in the file's order.
+
+	The workers only handle the common case (ASCII quality scores, lines
+	shorter than MAX_SEQ_LINE_LENGTH, a '+' 3rd line). On anything else -
+	including invalid records - the chunk reader stops, and the sequential
+	reader continues from the same record (reporting the same errors,
+	on the same line numbers, as it would have without the chunk reader).
+*/
+
+#define FASTX_CHUNK_SIZE (4*1024*1024)
+
+// A parsed record - pointers into the mmap'd file
+struct fastx_chunk_record
+{
+	const char	*name;		// without the '@'/'>' prefix
+	const char	*nucleotides;
+	const char	*name2;		// without the '+' prefix (FASTQ only)
+	const char	*quality;	// ASCII quality scores (FASTQ only)
+	unsigned int	name_length;
+	unsigned int	name2_length;
+	unsigned int	length;		// number of nucleotides (and quality scores)
+	unsigned int	bytes;		// size of the record in the file
+};
+
+struct fastx_chunk_batch
+{
+	size_t	chunk;			// chunk number
+	int	ready;			// 1 = parsed, waiting for the reading thread
+	int	fallback;		// 1 = the record at 'end_offset' must be read sequentially
+	off_t	start_offset;		// offset of the first record
+	off_t	end_offset;		// offset following the last record
+
+	struct fastx_chunk_record *records;
+	size_t	records_count;
+	size_t	records_capacity;
+};
+
+typedef struct fastx_chunk_reader
+{
+	FILE	*input;			// the sequential reader's stream (for fallback)
+	const char *data;		// the mmap'd input file
+	size_t	data_size;
+	size_t	page_size;
+	off_t	released;		// the pages before this offset were released (see MADV_DONTNEED)
+
+	/* Parsing configuration, copied from the reader's FASTX */
+	int	read_fastq;
+	int	fastq_ascii_quality_offset;
+	int	decode_quality;		// see FASTX_FIELD_QUALITY
+	int	raw_records;		// see FASTX_FIELD_RAW_RECORD
+	int	allowed_nucleotides[256];
+
+	off_t	start;			// offset of the first record
+	off_t	end;			// stop before records starting at this offset
+	size_t	chunks_count;
+
+	/* Batches in flight (chunk N uses batch N % batches_count), protected by 'lock' */
+	pthread_mutex_t lock;
+	pthread_cond_t	batch_ready;
+	pthread_cond_t	batch_free;
+	struct fastx_chunk_batch *batches;
+	size_t	batches_count;
+	size_t	next_chunk;		// next chunk to be parsed
+	size_t	current_chunk;		// chunk being read by the reading thread
+	int	stop;
+
+	pthread_t *threads;
+	size_t	threads_count;
+
+	/* Owned by the reading thread */
+	size_t	current_record;
+	int	sequential;		// 1 = switched to the sequential reader
+	int	finished;		// 1 = all the records were read
+} FASTX_CHUNK_READER;
+
+/*
+	Start reading the records from 'start' (which must be the beginning
+	of a record) until 'end' (-1 = end of file), with 'threads' workers.
+	The input stream must be a regular file.
+	Returns NULL if the file can't be mmap'd - the sequential reader reads it.
+*/
+FASTX_CHUNK_READER* fastx_chunk_reader_new(const FASTX *pFASTX, off_t start, off_t end,
+		unsigned int threads);
+
+/*
+	Fill the next record into pFASTX.
+	Returns 1 on success, 0 at the end of the input, and -1 if the
+	remaining records must be read by the sequential reader (the input
+	stream is then positioned at the next record).
+*/
+int fastx_chunk_reader_next(FASTX_CHUNK_READER *reader, FASTX *pFASTX);
+
+// Stop the workers (if they're still running), and free the reader
+void fastx_chunk_reader_free(FASTX_CHUNK_READER *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,525 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "fastx_error.h"
+#include "fastx.h"
+#include "fastx_context.h"
+#include "fastx_timers.h"
+#include "fastx_metrics.h"
+
+/*
+ * Long options, common to all programs
+ * (values above 255 don't collide with the programs' option letters)
+ */
+enum {
+	OPT_QUALITY_BINS = 256,
+	OPT_SHARD,
+	OPT_BYTE_RANGE,
+	OPT_READER_THREADS,
+	OPT_TIMINGS_JSON,
+	OPT_METRICS_FILE,
+	OPT_METRICS_INTERVAL,
+	OPT_INPUT_LIST,
+	OPT_ASYNC_IO,
+	OPT_IO_BUFFER_SIZE,
+	OPT_HUGE_PAGES
+};
+
+static const struct option common_long_options[] = {
+	{ "quality-bins",     required_argument, NULL, OPT_QUALITY_BINS },
+	{ "shard",            required_argument, NULL, OPT_SHARD },
+	{ "byte-range",       required_argument, NULL, OPT_BYTE_RANGE },
+	{ "reader-threads",   required_argument, NULL, OPT_READER_THREADS },
+	{ "timings-json",     required_argument, NULL, OPT_TIMINGS_JSON },
+	{ "metrics-file",     required_argument, NULL, OPT_METRICS_FILE },
+	{ "metrics-interval", required_argument, NULL, OPT_METRICS_INTERVAL },
+	{ "input-list",       required_argument, NULL, OPT_INPUT_LIST },
+	{ "async-io",         no_argument,       NULL, OPT_ASYNC_IO },
+	{ "io-buffer-size",   required_argument, NULL, OPT_IO_BUFFER_SIZE },
+	{ "huge-pages",       no_argument,       NULL, OPT_HUGE_PAGES },
+	{ NULL,               0,                 NULL, 0 }
+};
+
+void fastx_context_init(FASTX_CONTEXT *ctx)
+{
+	memset(ctx, 0, sizeof(FASTX_CONTEXT));
+
+	ctx->program_name = "";
+	ctx->usage = "";
+	ctx->input_filename = "-";
+	ctx->output_filename = "-";
+	ctx->fastq_ascii_quality_offset = 33 ;
+	ctx->report_file = stderr ; //since the default output is STDOUT, the report goes by default to STDERR
+	ctx->metrics_interval = 10 ;
+	fastx_init_io_options(&ctx->io_options);
+}
+
+FASTX_CONTEXT* fastx_context_new()
+{
+	FASTX_CONTEXT *ctx;
+
+	ctx = malloc(sizeof(FASTX_CONTEXT));
+	if (ctx==NULL)
+		fastx_err(1,"failed to allocate FASTX context");
+	fastx_context_init(ctx);
+	return ctx;
+}
+
+static FASTX* add_stream(FASTX_CONTEXT *ctx)
+{
+	FASTX *pFASTX;
+
+	if (ctx->streams_count == ctx->streams_capacity) {
+		ctx->streams_capacity = (ctx->streams_capacity>0) ? ctx->streams_capacity*2 : 4 ;
+		ctx->streams = realloc(ctx->streams, ctx->streams_capacity * sizeof(FASTX*));
+		if (ctx->streams==NULL)
+			fastx_err(1,"failed to allocate FASTX context streams");
+	}
+
+	pFASTX = calloc(1, sizeof(FASTX));
+	if (pFASTX==NULL)
+		fastx_err(1,"failed to allocate FASTX reader");
+	ctx->streams[ctx->streams_count++] = pFASTX;
+	return pFASTX;
+}
+
+/*
+	Interleaved paired-end mates share their input (and output) streams -
+	returns 1 if one of the streams before 'index' uses the same input/output.
+*/
+static int input_shared(const FASTX_CONTEXT *ctx, size_t index)
+{
+	size_t i;
+
+	for (i=0; i<index; i++)
+		if (ctx->streams[i]->input == ctx->streams[index]->input)
+			return 1;
+	return 0;
+}
+
+static int output_shared(const FASTX_CONTEXT *ctx, size_t index)
+{
+	size_t i;
+
+	for (i=0; i<index; i++)
+		if (ctx->streams[i]->output == ctx->streams[index]->output)
+			return 1;
+	return 0;
+}
+
+void fastx_context_free(FASTX_CONTEXT *ctx)
+{
+	size_t i;
+
+	if (ctx==NULL)
+		return;
+
+	//Close the shared streams only once (with the first mate), but check
+	//all the streams before closing any
+	for (i=ctx->streams_count; i>0; i--) {
+		if (ctx->streams[i-1]->output!=NULL && output_shared(ctx, i-1))
+			ctx->streams[i-1]->output = NULL;
+		if (ctx->streams[i-1]->input!=NULL && input_shared(ctx, i-1)) {
+			ctx->streams[i-1]->input = NULL;
+			ctx->streams[i-1]->input_buffer = NULL;
+			ctx->streams[i-1]->chunks = NULL;
+			ctx->streams[i-1]->store = NULL;
+			ctx->streams[i-1]->input_decompressor_pid = 0 ;
+		}
+	}
+
+	for (i=0; i<ctx->streams_count; i++) {
+		fastx_close_writer(ctx->streams[i]);
+		fastx_close_reader(ctx->streams[i]);
+		free(ctx->streams[i]);
+	}
+	free(ctx->streams);
+
+	for (i=0; i<ctx->input_files_count; i++)
+		free((char*)ctx->input_files[i].filename);
+	free(ctx->input_files);
+	free(ctx);
+}
+
+FASTX* fastx_context_open_reader(FASTX_CONTEXT *ctx, const char* filename,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase)
+{
+	FASTX *pFASTX = add_stream(ctx);
+
+	fastx_init_reader_with_options(pFASTX, filename, allowed_input_filetype,
+			allow_bases, allow_lowercase, ctx->fastq_ascii_quality_offset,
+			&ctx->io_options);
+	return pFASTX;
+}
+
+void fastx_context_open_writer(FASTX_CONTEXT *ctx, FASTX *pFASTX,
+		const char* filename, OUTPUT_FILE_TYPE output_type)
+{
+	fastx_init_writer(pFASTX, filename, output_type, ctx->compress_output);
+}
+
+void fastx_context_open_paired_reader(FASTX_CONTEXT *ctx, FASTX **mate1, FASTX **mate2,
+		const char* filename1, const char* filename2,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase)
+{
+	*mate1 = add_stream(ctx);
+	*mate2 = add_stream(ctx);
+
+	fastx_init_paired_reader_with_options(*mate1, *mate2, filename1, filename2,
+			allowed_input_filetype, allow_bases, allow_lowercase,
+			ctx->fastq_ascii_quality_offset, &ctx->io_options);
+}
+
+void fastx_context_open_paired_writer(FASTX_CONTEXT *ctx, FASTX *mate1, FASTX *mate2,
+		const char* filename1, const char* filename2,
+		OUTPUT_FILE_TYPE output_type)
+{
+	fastx_init_paired_writer(mate1, mate2, filename1, filename2,
+			output_type, ctx->compress_output);
+}
+
+static void add_input_file(FASTX_CONTEXT *ctx, const char* filename)
+{
+	FASTX_INPUT_FILE *file;
+
+	if (ctx->input_files_count == ctx->input_files_capacity) {
+		ctx->input_files_capacity = (ctx->input_files_capacity>0) ? ctx->input_files_capacity*2 : 16 ;
+		ctx->input_files = realloc(ctx->input_files,
+				ctx->input_files_capacity * sizeof(FASTX_INPUT_FILE));
+		if (ctx->input_files==NULL)
+			fastx_err(1,"failed to allocate input files list");
+	}
+
+	file = &ctx->input_files[ctx->input_files_count++];
+	memset(file, 0, sizeof(FASTX_INPUT_FILE));
+	file->filename = strdup(filename);
+	if (file->filename==NULL)
+		fastx_err(1,"failed to allocate input files list");
+}
+
+// Read the input file names from a file (--input-list), one per line.
+// Empty lines, and lines starting with '#', are ignored.
+static void read_input_list(FASTX_CONTEXT *ctx, const char* list_filename)
+{
+	FILE *list;
+	char line[PATH_MAX+2];
+	size_t length;
+	size_t count = ctx->input_files_count;
+
+	list = fopen(list_filename, "r");
+	if (list==NULL)
+		fastx_err(1,"failed to open input list file '%s'", list_filename);
+
+	while (fgets(line, sizeof(line), list)!=NULL) {
+		length = strlen(line);
+		if (length>0 && line[length-1]=='\n')
+			line[--length] = 0 ;
+		else if (!feof(list))
+			fastx_errx(1,"input file name is too long, in input list file '%s'", list_filename);
+		if (length>0 && line[length-1]=='\r')
+			line[--length] = 0 ;
+
+		if (length==0 || line[0]=='#')
+			continue;
+		add_input_file(ctx, line);
+	}
+	if (ferror(list))
+		fastx_err(1,"failed to read input list file '%s'", list_filename);
+	fclose(list);
+
+	if (ctx->input_files_count == count)
+		fastx_errx(1,"no input files in input list file '%s'", list_filename);
+}
+
+// Fail before processing any input file, if one of them can't be read
+static void check_input_files(const FASTX_CONTEXT *ctx)
+{
+	size_t i;
+	int stdin_count = 0 ;
+
+	for (i=0; i<ctx->input_files_count; i++) {
+		if (strcmp(ctx->input_files[i].filename,"-")==0) {
+			if (++stdin_count > 1)
+				fastx_errx(1,"STDIN ('-') can be given only once as an input file");
+			continue;
+		}
+		if (access(ctx->input_files[i].filename, R_OK)!=0)
+			fastx_err(1,"failed to open input file '%s'", ctx->input_files[i].filename);
+	}
+}
+
+// Parse "I/N" (--shard)
+static void parse_shard(FASTX_CONTEXT *ctx, const char* spec)
+{
+	unsigned long index, count;
+	const char* p;
+	char *endptr;
+
+	index = strtoul(spec, &endptr, 10);
+	if (endptr==spec || *endptr!='/' || index>UINT_MAX)
+		fastx_errx(1,"invalid shard '%s' (expecting I/N, e.g. '--shard 3/10')", spec);
+	p = endptr+1;
+	count = strtoul(p, &endptr, 10);
+	if (endptr==p || *endptr!=0 || count>UINT_MAX)
+		fastx_errx(1,"invalid shard '%s' (expecting I/N, e.g. '--shard 3/10')", spec);
+
+	fastx_set_io_options_shard(&ctx->io_options, (unsigned int)index, (unsigned int)count);
+}
+
+// Parse "START:END" (--byte-range)
+static void parse_byte_range(FASTX_CONTEXT *ctx, const char* spec)
+{
+	long long start, end;
+	char *endptr;
+
+	start = strtoll(spec, &endptr, 10);
+	if (endptr==spec || *endptr!=':')
+		fastx_errx(1,"invalid byte range '%s' (expecting START:END)", spec);
+	end = strtoll(endptr+1, &endptr, 10);
+	if (*endptr!=0)
+		fastx_errx(1,"invalid byte range '%s' (expecting START:END)", spec);
+
+	fastx_set_io_options_byte_range(&ctx->io_options, (off_t)start, (off_t)end);
+}
+
+// Parse "N", "NK" or "NM" (--io-buffer-size, 0 = stdio's default buffers)
+static void parse_io_buffer_size(FASTX_CONTEXT *ctx, const char* spec)
+{
+	unsigned long long size;
+	char *endptr;
+
+	size = strtoull(spec, &endptr, 10);
+	if (endptr==spec)
+		fastx_errx(1,"invalid I/O buffer size '%s'", spec);
+	if (*endptr=='K' || *endptr=='k') {
+		size *= 1024;
+		endptr++;
+	} else if (*endptr=='M' || *endptr=='m') {
+		size *= 1024*1024;
+		endptr++;
+	}
+	if (*endptr!=0 || size > 1024ULL*1024*1024)
+		fastx_errx(1,"invalid I/O buffer size '%s'", spec);
+
+	fastx_set_io_options_io_buffers(&ctx->io_options, (size_t)size,
+			ctx->io_options.huge_pages);
+}
+
+int fastx_context_parse_cmdline(FASTX_CONTEXT *ctx, int argc, char* argv[],
+			const char* program_options,
+			parse_argument_func program_parse_args)
+{
+	int opt;
+	unsigned long threads;
+	char *endptr;
+	int metrics_interval_set = 0 ;
+
+	char combined_options_string[100];
+
+	strcpy(combined_options_string, "Q:zhvi:o:");
+	if (ctx->allow_paired_files)
+		strcat(combined_options_string, "I:O:P");
+	strcat(combined_options_string, program_options);
+
+	ctx->program_name = strrchr(argv[0],'/') ? strrchr(argv[0],'/')+1 : argv[0] ;
+
+	while ( (opt = getopt_long(argc, argv, combined_options_string, common_long_options, NULL) ) != -1 ) {
+		
+		// Parse the program's custom options
+		if ( opt < 256 && strchr(program_options, opt) != NULL ) {
+			if (!program_parse_args(optind, opt, optarg))
+				return 0;
+			continue;
+		}
+
+		//Parse the default options
+		switch(opt) {
+		case 'h':
+			printf("%s", ctx->usage);
+			exit(1);
+		
+		case 'v':
+			ctx->verbose = 1 ;
+			break ;
+
+		case 'z':
+			ctx->compress_output = 1 ;
+			break ;
+
+
+		case 'i':
+			if (optarg==NULL)
+				fastx_errx(1,"[-i] option requires FILENAME argument");
+			add_input_file(ctx, optarg);
+			break;
+
+		case 'o':
+			if (optarg==NULL)
+				fastx_errx(1,"[-o] option requires FILENAME argument");
+			ctx->output_filename = optarg;
+			
+			//The user specified a specific output file, so the report can go to STDOUT
+			ctx->report_file = stdout;
+			break;
+			
+		case 'I':
+			if (optarg==NULL)
+				fastx_errx(1,"[-I] option requires FILENAME argument");
+			ctx->input2_filename = optarg;
+			break;
+
+		case 'O':
+			if (optarg==NULL)
+				fastx_errx(1,"[-O] option requires FILENAME argument");
+			ctx->output2_filename = optarg;
+			break;
+
+		case 'P':
+			ctx->interleaved = 1 ;
+			break ;
+
+		case 'Q':
+			if (optarg==NULL)
+				fastx_errx(1,"[-Q] option requires VALUE argument");
+			ctx->fastq_ascii_quality_offset = atoi(optarg);
+			break;
+
+		case OPT_QUALITY_BINS:
+			fastx_parse_quality_bins(optarg, ctx->quality_bins);
+			fastx_set_io_options_quality_bins(&ctx->io_options, ctx->quality_bins);
+			break;
+
+		case OPT_SHARD:
+			parse_shard(ctx, optarg);
+			break;
+
+		case OPT_BYTE_RANGE:
+			parse_byte_range(ctx, optarg);
+			break;
+
+		case OPT_READER_THREADS:
+			threads = strtoul(optarg, &endptr, 10);
+			if (endptr==optarg || *endptr!=0 || threads==0 || threads>1024)
+				fastx_errx(1,"invalid number of reader threads '%s'", optarg);
+			fastx_set_io_options_reader_threads(&ctx->io_options, (unsigned int)threads);
+			break;
+
+		case OPT_ASYNC_IO:
+			fastx_set_io_options_async_io(&ctx->io_options, 1);
+			break;
+
+		case OPT_IO_BUFFER_SIZE:
+			parse_io_buffer_size(ctx, optarg);
+			break;
+
+		case OPT_HUGE_PAGES:
+			fastx_set_io_options_io_buffers(&ctx->io_options,
+				ctx->io_options.io_buffer_size, 1);
+			break;
+
+		case OPT_TIMINGS_JSON:
+			ctx->timings_json_filename = optarg;
+			break;
+
+		case OPT_METRICS_FILE:
+			ctx->metrics_filename = optarg;
+			break;
+
+		case OPT_INPUT_LIST:
+			read_input_list(ctx, optarg);
+			break;
+
+		case OPT_METRICS_INTERVAL:
+			ctx->metrics_interval = strtod(optarg, &endptr);
+			if (endptr==optarg || *endptr!=0 || !(ctx->metrics_interval>0))
+				fastx_errx(1,"invalid metrics interval '%s' (expecting seconds)", optarg);
+			metrics_interval_set = 1 ;
+			break;
+
+		default:
+			printf("use '-h' for usage information.\n");
+			exit(1);
+			break;
+
+		}
+	}
+
+	//With [-P], a missing [-I] or [-O] means the mates are interleaved in the same file
+	if (ctx->input2_filename != NULL && ctx->output2_filename == NULL && !ctx->interleaved)
+		fastx_errx(1,"[-I] requires an output file for the second mates [-O], or interleaved output [-P]");
+	if (ctx->output2_filename != NULL && ctx->input2_filename == NULL && !ctx->interleaved)
+		fastx_errx(1,"[-O] can only be used with paired-end input [-I], or interleaved input [-P]");
+	if (metrics_interval_set && ctx->metrics_filename == NULL)
+		fastx_errx(1,"[--metrics-interval] can only be used with [--metrics-file]");
+
+	if (ctx->input_files_count>0)
+		ctx->input_filename = ctx->input_files[0].filename;
+	if (ctx->input_files_count>1) {
+		check_input_files(ctx);
+		ctx->io_options.input_files = ctx->input_files;
+		ctx->io_options.input_files_count = ctx->input_files_count;
+	}
+
+	if (ctx->verbose || ctx->timings_json_filename!=NULL)
+		fastx_timers_start();
+	if (ctx->metrics_filename!=NULL)
+		fastx_metrics_start(ctx->metrics_filename, ctx->metrics_interval, ctx->program_name);
+
+	return 1;
+}
+
+void fastx_context_report_timings(const FASTX_CONTEXT *ctx)
+{
+	FILE *json;
+	size_t i;
+
+	if (ctx->verbose && ctx->input_files_count>1)
+		for (i=0; i<ctx->input_files_count; i++)
+			fprintf(ctx->report_file, "Input (%s): %zu reads.\n",
+				ctx->input_files[i].filename, ctx->input_files[i].reads);
+
+	if (ctx->verbose)
+		fastx_timers_print(ctx->report_file);
+
+	if (ctx->timings_json_filename!=NULL) {
+		if (strcmp(ctx->timings_json_filename,"-")==0)
+			json = stderr;
+		else {
+			json = fopen(ctx->timings_json_filename, "w");
+			if (json==NULL)
+				fastx_err(1,"failed to create timings file '%s'", ctx->timings_json_filename);
+		}
+		fastx_timers_write_json(json, ctx->program_name);
+		if (json!=stderr && fclose(json)!=0)
+			fastx_err(1,"failed to write timings file '%s'", ctx->timings_json_filename);
+	}
+
+	fastx_metrics_finish();
+}
+
@@ -0,0 +1,125 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_CONTEXT_H__
+#define __FASTX_CONTEXT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+
+#include "fastx.h"
+
+/*
+	FASTX context -
+	Owns a program's options (as parsed from the command line, or set
+	directly), and the readers/writers opened with them.
+
+	Nothing in a context is shared with other contexts, so a program can
+	process several inputs (or use worker threads) with one context each.
+	The exceptions are the process-wide stage timers and run metrics
+	(see fastx_timers.h and fastx_metrics.h), which should be enabled only
+	in single-threaded programs, and the command-line parser itself
+	(getopt isn't reentrant).
+
+	The fastx_args.h functions use a default context, for the programs
+	which were written before contexts.
+*/
+
+// Parses a program-specific option (see fastx_context_parse_cmdline() )
+typedef int (*parse_argument_func)(int optind, int optc, char* optarg)  ;
+
+typedef struct fastx_context
+{
+	/* Options (set by fastx_context_parse_cmdline(), or directly) */
+	const char* program_name;
+	const char* usage;			// printed by [-h]
+	const char* input_filename;		// "-" = STDIN
+	const char* output_filename;		// "-" = STDOUT
+	const char* input2_filename;		// Paired-end second mates (NULL = not given)
+	const char* output2_filename;
+	int	allow_paired_files;		// 1 = accept [-I], [-O] and [-P]
+	int	interleaved;			// [-P]
+	int	verbose;			// [-v]
+	int	compress_output;		// [-z]
+	int	fastq_ascii_quality_offset;	// [-Q]
+	FILE*	report_file;			// STDERR, or STDOUT if [-o] was given
+	const char* timings_json_filename;	// [--timings-json]
+	const char* metrics_filename;		// [--metrics-file]
+	double	metrics_interval;		// [--metrics-interval]
+	int	quality_bins[QUALITY_BINS_TABLE_SIZE]; // [--quality-bins]
+	FASTX_IO_OPTIONS io_options;		// [--quality-bins], [--shard], [--byte-range], [--reader-threads]
+
+	/* Input files ([-i], repeated, and [--input-list]). With more than one,
+	   io_options.input_files points here, and 'input_filename' is the first. */
+	FASTX_INPUT_FILE *input_files;
+	size_t	input_files_count;
+	size_t	input_files_capacity;
+
+	/* Readers/writers owned by the context */
+	FASTX	**streams;
+	size_t	streams_count;
+	size_t	streams_capacity;
+} FASTX_CONTEXT;
+
+// Create a context with the default options (as if the command line was empty)
+FASTX_CONTEXT* fastx_context_new();
+void fastx_context_init(FASTX_CONTEXT *ctx);
+
+// Close the context's readers/writers and free it
+void fastx_context_free(FASTX_CONTEXT *ctx);
+
+// Parse the common options (and the program's, see fastx_args.h)
+int fastx_context_parse_cmdline(FASTX_CONTEXT *ctx, int argc, char* argv[],
+			const char* program_options,
+			parse_argument_func program_parse_args);
+
+// Open a reader with the context's options. The context owns the returned FASTX.
+FASTX* fastx_context_open_reader(FASTX_CONTEXT *ctx, const char* filename,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase);
+
+// Open the writer of a reader opened with fastx_context_open_reader()
+// (compressed if the context's 'compress_output' is set)
+void fastx_context_open_writer(FASTX_CONTEXT *ctx, FASTX *pFASTX,
+		const char* filename, OUTPUT_FILE_TYPE output_type);
+
+// Paired-end files (see fastx_init_paired_reader() ). The context owns both mates.
+void fastx_context_open_paired_reader(FASTX_CONTEXT *ctx, FASTX **mate1, FASTX **mate2,
+		const char* filename1, const char* filename2,
+		ALLOWED_INPUT_FILE_TYPES allowed_input_filetype,
+		ALLOWED_INPUT_BASES allow_bases,
+		ALLOWED_INPUT_CASE allow_lowercase);
+
+void fastx_context_open_paired_writer(FASTX_CONTEXT *ctx, FASTX *mate1, FASTX *mate2,
+		const char* filename1, const char* filename2,
+		OUTPUT_FILE_TYPE output_type);
+
+// Print the per-file input counts (with [-v] and multiple input files)
+// and the stage timers report (with [-v]), write the JSON timings file
+// (with [--timings-json FILE]), and the final run metrics snapshot
+// (with [--metrics-file FILE]). Programs call this after their own report.
+void fastx_context_report_timings(const FASTX_CONTEXT *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
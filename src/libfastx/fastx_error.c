@@ -0,0 +1,102 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <errno.h>
+#include <err.h>
+#include <setjmp.h>
+
+#include "fastx_error.h"
+
+struct fastx_error_context
+{
+	jmp_buf	jump;
+	char	*error;
+	size_t	error_size;
+	struct fastx_error_context *previous;
+};
+
+// The innermost fastx_call() of this thread, or NULL
+static __thread struct fastx_error_context *error_context = NULL;
+
+static void report_error(int eval, int errnum, const char* format, va_list args)
+	__attribute__ ((noreturn, format (printf, 3, 0)));
+
+static void report_error(int eval, int errnum, const char* format, va_list args)
+{
+	struct fastx_error_context *context = error_context;
+	size_t length;
+
+	if (context==NULL) {
+		if (errnum!=0) {
+			errno = errnum;
+			verr(eval, format, args);
+		}
+		verrx(eval, format, args);
+	}
+
+	if (context->error!=NULL && context->error_size>0) {
+		vsnprintf(context->error, context->error_size, format, args);
+		length = strlen(context->error);
+		if (errnum!=0 && length < context->error_size)
+			snprintf(context->error+length, context->error_size-length,
+				": %s", strerror(errnum));
+	}
+	error_context = context->previous;
+	longjmp(context->jump, 1);
+}
+
+void fastx_err(int eval, const char* format, ...)
+{
+	int errnum = errno;
+	va_list args;
+
+	va_start(args, format);
+	report_error(eval, errnum, format, args);
+}
+
+void fastx_errx(int eval, const char* format, ...)
+{
+	va_list args;
+
+	va_start(args, format);
+	report_error(eval, 0, format, args);
+}
+
+int fastx_call(void (*function)(void*), void* argument, char* error, size_t error_size)
+{
+	struct fastx_error_context context;
+
+	context.error = error;
+	context.error_size = error_size;
+	context.previous = error_context;
+	if (setjmp(context.jump)!=0)
+		return -1;
+
+	error_context = &context;
+	function(argument);
+	error_context = context.previous;
+	return 0;
+}
+
+void fastx_error_forked_child()
+{
+	error_context = NULL;
+}
@@ -0,0 +1,64 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_ERROR_H__
+#define __FASTX_ERROR_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/*
+	Error reporting -
+	libfastx reports errors with fastx_err()/fastx_errx(), which take the
+	same arguments as err(3)/errx(3). By default, they print the message
+	and exit, exactly like err/errx.
+
+	Programs which embed libfastx run the library calls inside fastx_call():
+	an error then stops the call, and fastx_call() returns -1 with the
+	message in 'error', instead of terminating the program.
+	Anything the interrupted call was in the middle of (e.g. a reader which
+	failed to open its input) should be closed and not used again.
+
+	The error context is per-thread - errors in threads (and processes)
+	started by libfastx itself (the chunked reader's workers, the GZIP
+	helpers) still terminate them.
+*/
+void fastx_err(int eval, const char* format, ...)
+	__attribute__ ((noreturn, format (printf, 2, 3)));
+void fastx_errx(int eval, const char* format, ...)
+	__attribute__ ((noreturn, format (printf, 2, 3)));
+
+/*
+	Call 'function(argument)'. Returns 0 if it returned normally,
+	or -1 if it reported an error (the message is copied to 'error',
+	truncated to 'error_size' bytes. 'error' can be NULL).
+	Calls can be nested.
+*/
+int fastx_call(void (*function)(void*), void* argument, char* error, size_t error_size);
+
+// Forked child processes must call this: errors in the child exit the
+// child, and never return to the parent's fastx_call()
+void fastx_error_forked_child();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,148 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "fastx_iotune.h"
+#include "fastx_timers.h"
+
+static char *stdin_buffer = NULL;
+
+/*
+	The sizes are reported only when timing (see fastx_timers.h) - readers
+	and writers may be opened on several threads (one context each, see
+	fastx_context.h), so the global timers are updated atomically.
+*/
+static inline void update_max(uint64_t *value, uint64_t size)
+{
+	uint64_t current;
+
+	if (!fastx_timers.enabled)
+		return;
+	current = __atomic_load_n(value, __ATOMIC_RELAXED);
+	while (size > current
+	       && !__atomic_compare_exchange_n(value, &current, size, 0,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED))
+		;
+}
+
+size_t fastx_iotune_pipe_size(int fd)
+{
+	struct stat st;
+	int size;
+
+	if (fd<0 || fstat(fd, &st)!=0 || !S_ISFIFO(st.st_mode))
+		return 0;
+
+#ifdef F_SETPIPE_SZ
+	//Unprivileged processes are limited to /proc/sys/fs/pipe-max-size
+	for (size=FASTX_PIPE_SIZE; size>=65536; size/=2)
+		if (fcntl(fd, F_SETPIPE_SZ, size)!=-1)
+			break;
+	size = fcntl(fd, F_GETPIPE_SZ);
+	return (size>0) ? (size_t)size : 0 ;
+#else
+	(void)size;
+	return 65536; //the Linux default, as good a guess as any
+#endif
+}
+
+void fastx_iotune_input_fd(int fd, off_t offset)
+{
+	struct stat st;
+
+	if (fd<0 || fstat(fd, &st)!=0)
+		return;
+
+	if (S_ISREG(st.st_mode)) {
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(fd, offset, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+#ifdef __linux__
+		readahead(fd, offset, FASTX_READAHEAD_SIZE);
+#endif
+		return;
+	}
+
+	update_max(&fastx_timers.input_pipe_size, fastx_iotune_pipe_size(fd));
+}
+
+void fastx_iotune_output_fd(int fd)
+{
+	update_max(&fastx_timers.output_pipe_size, fastx_iotune_pipe_size(fd));
+}
+
+void fastx_iotune_report_buffer_size(size_t size, int output)
+{
+	if (output)
+		update_max(&fastx_timers.output_buffer_size, size);
+	else
+		update_max(&fastx_timers.input_buffer_size, size);
+}
+
+static char* allocate_buffer(size_t size, int huge_pages)
+{
+	void *buffer;
+	size_t alignment = (size_t)sysconf(_SC_PAGESIZE);
+
+	if (huge_pages) {
+		//Whole huge pages (transparent huge pages are used if enabled,
+		//see /sys/kernel/mm/transparent_hugepage/enabled)
+		alignment = FASTX_HUGE_PAGE_SIZE;
+		size = (size + FASTX_HUGE_PAGE_SIZE-1) & ~((size_t)FASTX_HUGE_PAGE_SIZE-1);
+	}
+	if (posix_memalign(&buffer, alignment, size)!=0)
+		return NULL;
+#ifdef MADV_HUGEPAGE
+	if (huge_pages && madvise(buffer, size, MADV_HUGEPAGE)==0 && fastx_timers.enabled)
+		__atomic_store_n(&fastx_timers.huge_pages, 1, __ATOMIC_RELAXED);
+#endif
+	return (char*)buffer;
+}
+
+char* fastx_iotune_set_buffer(FILE* stream, size_t size, int huge_pages, int output)
+{
+	char *buffer;
+
+	if (size==0 || stream==NULL || fileno(stream)<0 || isatty(fileno(stream)))
+		return NULL;
+	if (stream==stdin && stdin_buffer!=NULL)
+		return NULL;
+
+	buffer = allocate_buffer(size, huge_pages);
+	if (buffer==NULL)
+		return NULL;
+	if (setvbuf(stream, buffer, _IOFBF, size)!=0) {
+		free(buffer);
+		return NULL;
+	}
+
+	fastx_iotune_report_buffer_size(size, output);
+
+	if (stream==stdin) {
+		stdin_buffer = buffer;
+		return NULL;
+	}
+	return buffer;
+}
@@ -0,0 +1,80 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_IOTUNE_H__
+#define __FASTX_IOTUNE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <sys/types.h>
+
+/*
+	I/O tuning (see fastx_set_default_io_buffers() ) -
+	for the streams which libfastx opens itself:
+
+	- Input files are read sequentially: the kernel is told so
+	  (posix_fadvise), and starts reading ahead right away (readahead).
+	- Pipes (STDIN/STDOUT pipes, and the pipes to and from GZIP) are
+	  enlarged to FASTX_PIPE_SIZE (or as much as the system allows, see
+	  /proc/sys/fs/pipe-max-size), so that the writer and the reader
+	  switch less often.
+	- stdio buffers are large (aligned to the page size, or to huge
+	  pages), so that each read/write system call moves a large block.
+
+	All the hints are best-effort - failures are ignored.
+	The effective sizes are reported with the stage timers (see fastx_timers.h).
+*/
+
+#define FASTX_IO_BUFFER_SIZE	(1024*1024)
+#define FASTX_PIPE_SIZE		(1024*1024)
+#define FASTX_READAHEAD_SIZE	(8*1024*1024)
+#define FASTX_HUGE_PAGE_SIZE	(2*1024*1024)
+
+// Read hints for a regular file (read from 'offset'), or enlarge a pipe
+void fastx_iotune_input_fd(int fd, off_t offset);
+
+// Enlarge a pipe (for output - only the size is reported)
+void fastx_iotune_output_fd(int fd);
+
+/*
+	Enlarge a pipe (either end). Returns its capacity, or 0 if 'fd'
+	isn't a pipe.
+*/
+size_t fastx_iotune_pipe_size(int fd);
+
+/*
+	Set the stream's buffer - must be called before the stream is used.
+	Returns the buffer, which the caller frees after closing the stream
+	(streams which are never closed, such as writers on STDOUT, keep it) -
+	or NULL, if the default buffer is kept ('size' is 0, the allocation
+	failed, or the stream is a terminal).
+	STDIN gets a buffer only once, which is never freed (NULL is returned).
+*/
+char* fastx_iotune_set_buffer(FILE* stream, size_t size, int huge_pages, int output);
+
+// Report the size of a stream's reads/writes (for streams which don't use
+// fastx_iotune_set_buffer(), such as the io_uring streams, see fastx_aio.h)
+void fastx_iotune_report_buffer_size(size_t size, int output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,226 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <limits.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "fastx_error.h"
+#include "fastx_timers.h"
+#include "fastx_metrics.h"
+
+FASTX_METRICS fastx_metrics;
+
+static const char* metrics_filename;
+static char metrics_temp_filename[PATH_MAX];
+static const char* metrics_program_name;
+static int prometheus_format;
+static double interval;
+
+static off_t input_size = 0 ;
+static int input_size_known = 1 ;
+
+static double next_snapshot;
+static double last_snapshot;
+static uint64_t last_snapshot_sequences;
+
+static double monotonic_seconds()
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec / 1e9 ;
+}
+
+static double elapsed_seconds()
+{
+	return monotonic_seconds() - fastx_timers.start.tv_sec - fastx_timers.start.tv_nsec / 1e9 ;
+}
+
+void fastx_metrics_start(const char* filename, double interval_seconds, const char* program_name)
+{
+	size_t len = strlen(filename);
+
+	if (len + 5 > sizeof(metrics_temp_filename))
+		fastx_errx(1,"metrics file name is too long (%s)", filename);
+	metrics_filename = filename;
+	snprintf(metrics_temp_filename, sizeof(metrics_temp_filename), "%s.tmp", filename);
+	metrics_program_name = program_name;
+	prometheus_format = (len>=5 && strcmp(filename+len-5, ".prom")==0);
+	interval = interval_seconds;
+
+	if (!fastx_timers.enabled)
+		fastx_timers_start();
+
+	next_snapshot = elapsed_seconds() + interval ;
+	fastx_metrics.countdown = FASTX_METRICS_CHECK_RECORDS;
+	fastx_metrics.enabled = 1 ;
+}
+
+void fastx_metrics_add_input_size(off_t size)
+{
+	if (size<0)
+		input_size_known = 0 ;
+	else
+		input_size += size;
+}
+
+/*
+	Current resident set size, from /proc (or the maximum RSS so far,
+	where /proc is not available)
+*/
+static uint64_t resident_bytes(uint64_t *max_resident)
+{
+	struct rusage usage;
+	unsigned long long pages_total, pages_resident;
+	FILE *statm;
+	int found = 0 ;
+
+	memset(&usage, 0, sizeof(usage));
+	getrusage(RUSAGE_SELF, &usage);
+	*max_resident = (uint64_t)usage.ru_maxrss * 1024 ;
+
+	statm = fopen("/proc/self/statm", "r");
+	if (statm!=NULL) {
+		found = (fscanf(statm, "%llu %llu", &pages_total, &pages_resident)==2);
+		fclose(statm);
+	}
+	if (!found)
+		return *max_resident;
+	return (uint64_t)pages_resident * sysconf(_SC_PAGESIZE);
+}
+
+// Writes a JSON number, or null if the value is unknown (negative)
+static void write_json_value(FILE *output, const char* name, double value)
+{
+	if (value<0)
+		fprintf(output, ", \"%s\": null", name);
+	else
+		fprintf(output, ", \"%s\": %.3f", name, value);
+}
+
+static void write_prometheus_value(FILE *output, const char* name, const char* type,
+		const char* help, double value)
+{
+	//Unknown values are left out
+	if (value<0)
+		return;
+	fprintf(output, "# HELP fastx_%s %s\n", name, help);
+	fprintf(output, "# TYPE fastx_%s %s\n", name, type);
+	fprintf(output, "fastx_%s{program=\"%s\"} %.15g\n", name, metrics_program_name, value);
+}
+
+static void write_snapshot(int finished)
+{
+	FILE *output;
+	double elapsed = elapsed_seconds();
+	double rate, recent_rate;
+	double consumed, total = -1, eta = -1 ;
+	uint64_t max_resident;
+	uint64_t resident = resident_bytes(&max_resident);
+
+	rate = (elapsed>0) ? fastx_timers.sequences_in / elapsed : 0 ;
+	recent_rate = (elapsed>last_snapshot) ?
+		(fastx_timers.sequences_in - last_snapshot_sequences) / (elapsed - last_snapshot) : 0 ;
+
+	consumed = (double)fastx_timers.bytes_in;
+	if (input_size_known && input_size>0) {
+		total = (double)input_size;
+		if (finished)
+			eta = 0 ;
+		else if (consumed>=total)
+			eta = 0 ;
+		else if (consumed>0)
+			eta = (total - consumed) * elapsed / consumed ;
+	}
+
+	output = fopen(metrics_temp_filename, "w");
+	if (output==NULL)
+		fastx_err(1,"failed to create metrics file '%s'", metrics_temp_filename);
+
+	if (prometheus_format) {
+		write_prometheus_value(output, "records_in_total", "counter",
+			"Records read.", fastx_timers.sequences_in);
+		write_prometheus_value(output, "records_out_total", "counter",
+			"Records written.", fastx_timers.sequences_out);
+		write_prometheus_value(output, "records_per_second", "gauge",
+			"Records read per second, since the last snapshot.", recent_rate);
+		write_prometheus_value(output, "input_bytes_consumed_total", "counter",
+			"Input bytes parsed.", consumed);
+		write_prometheus_value(output, "input_bytes", "gauge",
+			"Input size in bytes.", total);
+		write_prometheus_value(output, "eta_seconds", "gauge",
+			"Estimated time left, in seconds.", eta);
+		write_prometheus_value(output, "resident_memory_bytes", "gauge",
+			"Resident memory size in bytes.", resident);
+		write_prometheus_value(output, "elapsed_seconds", "gauge",
+			"Time since the program started, in seconds.", elapsed);
+		write_prometheus_value(output, "last_update_timestamp_seconds", "gauge",
+			"Time of this snapshot, in seconds since the epoch.", (double)time(NULL));
+		write_prometheus_value(output, "finished", "gauge",
+			"1 if the program has finished.", finished);
+	} else {
+		fprintf(output, "{\"program\": \"%s\", \"timestamp\": %lld, \"finished\": %s",
+			metrics_program_name, (long long)time(NULL), finished?"true":"false");
+		write_json_value(output, "elapsed_seconds", elapsed);
+		fprintf(output, ", \"records_in\": %llu, \"records_out\": %llu",
+			(unsigned long long)fastx_timers.sequences_in,
+			(unsigned long long)fastx_timers.sequences_out);
+		write_json_value(output, "records_per_second", rate);
+		write_json_value(output, "recent_records_per_second", recent_rate);
+		fprintf(output, ", \"input_bytes_consumed\": %llu",
+			(unsigned long long)fastx_timers.bytes_in);
+		if (total<0)
+			fprintf(output, ", \"input_bytes\": null");
+		else
+			fprintf(output, ", \"input_bytes\": %lld", (long long)input_size);
+		write_json_value(output, "eta_seconds", eta);
+		fprintf(output, ", \"rss_bytes\": %llu, \"max_rss_bytes\": %llu}\n",
+			(unsigned long long)resident, (unsigned long long)max_resident);
+	}
+
+	if (fclose(output)!=0)
+		fastx_err(1,"failed to write metrics file '%s'", metrics_temp_filename);
+	if (rename(metrics_temp_filename, metrics_filename)!=0)
+		fastx_err(1,"failed to rename metrics file '%s' to '%s'",
+			metrics_temp_filename, metrics_filename);
+
+	last_snapshot = elapsed;
+	last_snapshot_sequences = fastx_timers.sequences_in;
+	next_snapshot = elapsed + interval ;
+}
+
+void fastx_metrics_check_clock()
+{
+	fastx_metrics.countdown = FASTX_METRICS_CHECK_RECORDS;
+	if (elapsed_seconds() >= next_snapshot)
+		write_snapshot(0);
+}
+
+void fastx_metrics_finish()
+{
+	if (!fastx_metrics.enabled)
+		return;
+	write_snapshot(1);
+	fastx_metrics.enabled = 0 ;
+}
@@ -0,0 +1,77 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_METRICS_H__
+#define __FASTX_METRICS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <sys/types.h>
+
+/*
+	Run metrics snapshots -
+	While a program runs, a snapshot of its progress is written
+	periodically to a file: records read/written, records per second,
+	input bytes consumed (versus the input size, for uncompressed regular
+	files), the estimated time left, and the memory in use.
+
+	If the file name ends with ".prom", the snapshot is written in the
+	Prometheus text format (for node_exporter's textfile collector),
+	otherwise as a single JSON object. The file is replaced atomically
+	(written to FILE.tmp and renamed), and a final snapshot (with
+	"finished" set) is written when the program ends.
+
+	The counters are the stage timers' (see fastx_timers.h), which are
+	enabled with the metrics. The clock is checked once every
+	FASTX_METRICS_CHECK_RECORDS records, so a stalled program stops
+	updating the file - monitors should check the snapshot's timestamp.
+*/
+
+#define FASTX_METRICS_CHECK_RECORDS (1024)
+
+typedef struct
+{
+	int	enabled;
+	unsigned int countdown;	// records until the next clock check
+} FASTX_METRICS;
+
+extern FASTX_METRICS fastx_metrics;
+
+void fastx_metrics_start(const char* filename, double interval_seconds, const char* program_name);
+
+// Add an input file's size (or -1 if the size is unknown, e.g. compressed input)
+void fastx_metrics_add_input_size(off_t size);
+
+void fastx_metrics_check_clock();
+
+// Called for every record read or written
+static inline void fastx_metrics_tick()
+{
+	if (fastx_metrics.enabled && --fastx_metrics.countdown==0)
+		fastx_metrics_check_clock();
+}
+
+// Write the final snapshot
+void fastx_metrics_finish();
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
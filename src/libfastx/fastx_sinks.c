@@ -0,0 +1,410 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+
+#include "fastx_error.h"
+#include "fastx.h"
+#include "fastx_sinks.h"
+#include "fastx_timers.h"
+
+//file descriptors left for the rest of the program (input, STDOUT/ERR, etc.)
+#define RESERVED_FILE_DESCRIPTORS (32)
+#define MIN_OPEN_FILES (4)
+
+struct fastx_sink_buffer
+{
+	struct fastx_sink_buffer *next;
+	struct fastx_sink *sink;
+	size_t length;
+	char data[];
+};
+
+static size_t default_max_open_files()
+{
+	struct rlimit limit;
+	size_t max_open;
+
+	if (getrlimit(RLIMIT_NOFILE, &limit)!=0 || limit.rlim_cur==RLIM_INFINITY)
+		return 1024 - RESERVED_FILE_DESCRIPTORS;
+
+	max_open = (limit.rlim_cur > RESERVED_FILE_DESCRIPTORS + MIN_OPEN_FILES) ?
+			limit.rlim_cur - RESERVED_FILE_DESCRIPTORS : MIN_OPEN_FILES;
+	return max_open;
+}
+
+/*
+	Flusher thread functions
+*/
+static void close_sink(FASTX_SINK_POOL *pool, struct fastx_sink *sink)
+{
+	int status;
+	size_t last;
+
+	if (sink->fd==-1)
+		return;
+
+	if (close(sink->fd)!=0)
+		fastx_err(1,"failed to write output file (%s)", sink->filename);
+	sink->fd = -1;
+
+	//Wait for GZIP to finish, before anything else is appended to the file
+	if (sink->compressor_pid>0) {
+		if (waitpid(sink->compressor_pid, &status, 0)==-1)
+			fastx_err(1,"waitpid(gzip) failed");
+		if (!WIFEXITED(status) || WEXITSTATUS(status)!=0)
+			fastx_errx(1,"gzip failed while compressing output file (%s)", sink->filename);
+		sink->compressor_pid = 0 ;
+	}
+
+	//remove from the open-sinks list
+	last = pool->open_count - 1;
+	pool->open_sinks[sink->open_slot] = pool->open_sinks[last];
+	pool->open_sinks[sink->open_slot]->open_slot = sink->open_slot;
+	pool->open_count--;
+}
+
+static int close_least_recently_used(FASTX_SINK_POOL *pool)
+{
+	struct fastx_sink *lru = NULL;
+	size_t i;
+
+	for (i=0; i<pool->open_count; i++)
+		if (lru==NULL || pool->open_sinks[i]->last_used < lru->last_used)
+			lru = pool->open_sinks[i];
+	if (lru==NULL)
+		return 0;
+	close_sink(pool, lru);
+	return 1;
+}
+
+static int open_sink_file(FASTX_SINK_POOL *pool, struct fastx_sink *sink)
+{
+	int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (sink->created ? O_APPEND : O_TRUNC);
+	int fd;
+
+	while ( (fd = open(sink->filename, flags, 0666)) == -1 ) {
+		if ( (errno!=EMFILE && errno!=ENFILE) || !close_least_recently_used(pool) )
+			fastx_err(1, "Failed to create output file (%s)", sink->filename);
+	}
+	return fd;
+}
+
+static int open_compressor_pipe(FASTX_SINK_POOL *pool, struct fastx_sink *sink, int pipe_fds[2])
+{
+	while ( pipe2(pipe_fds, O_CLOEXEC) != 0 ) {
+		if ( (errno!=EMFILE && errno!=ENFILE) || !close_least_recently_used(pool) )
+			fastx_err(1,"pipe (for gzip) failed (%s)", sink->filename);
+	}
+	return 0;
+}
+
+static void open_sink(FASTX_SINK_POOL *pool, struct fastx_sink *sink)
+{
+	int file_fd;
+	int pipe_fds[2];
+
+	if (pool->open_count >= pool->max_open_files)
+		close_least_recently_used(pool);
+
+	if (sink->compress)
+		open_compressor_pipe(pool, sink, pipe_fds);
+
+	file_fd = open_sink_file(pool, sink);
+	sink->created = 1;
+
+	if (!sink->compress) {
+		sink->fd = file_fd;
+	} else {
+		sink->compressor_pid = fork();
+		if (sink->compressor_pid==-1)
+			fastx_err(1,"fork (for gzip) failed");
+
+		if (sink->compressor_pid==0) {
+			/* The child process - all other descriptors are close-on-exec */
+			fastx_error_forked_child();
+			dup2(pipe_fds[0], STDIN_FILENO);
+			dup2(file_fd, STDOUT_FILENO);
+			execlp("gzip","gzip",(char*)NULL);
+			fastx_err(1,"execlp(gzip) failed");
+		}
+		close(pipe_fds[0]);
+		close(file_fd);
+		sink->fd = pipe_fds[1];
+	}
+
+	sink->open_slot = pool->open_count;
+	pool->open_sinks[pool->open_count++] = sink;
+}
+
+static void write_sink_buffer(FASTX_SINK_POOL *pool, struct fastx_sink_buffer *buffer)
+{
+	struct fastx_sink *sink = buffer->sink;
+	size_t offset = 0 ;
+	ssize_t rc;
+
+	if (sink->fd==-1)
+		open_sink(pool, sink);
+	sink->last_used = ++pool->lru_clock;
+
+	while (offset < buffer->length) {
+		rc = write(sink->fd, buffer->data + offset, buffer->length - offset);
+		if (rc==-1) {
+			if (errno==EINTR)
+				continue;
+			fastx_err(1,"writing output file (%s) failed", sink->filename);
+		}
+		offset += rc;
+	}
+}
+
+static void* flusher_thread(void *arg)
+{
+	FASTX_SINK_POOL *pool = (FASTX_SINK_POOL*)arg;
+	struct fastx_sink_buffer *buffer;
+
+	while (1) {
+		pthread_mutex_lock(&pool->lock);
+		while (pool->queue_head==NULL && !pool->stop)
+			pthread_cond_wait(&pool->work_ready, &pool->lock);
+		buffer = pool->queue_head;
+		if (buffer==NULL) {
+			//Stop requested, and nothing left to write
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		pool->queue_head = buffer->next;
+		if (pool->queue_head==NULL)
+			pool->queue_tail = NULL;
+		pthread_mutex_unlock(&pool->lock);
+
+		write_sink_buffer(pool, buffer);
+
+		pthread_mutex_lock(&pool->lock);
+		buffer->next = pool->free_buffers;
+		pool->free_buffers = buffer;
+		pool->queued_buffers--;
+		pthread_cond_signal(&pool->buffer_flushed);
+		pthread_mutex_unlock(&pool->lock);
+	}
+	return NULL;
+}
+
+/*
+	Writing thread functions
+*/
+FASTX_SINK_POOL* fastx_sink_pool_new(size_t buffer_size, size_t max_open_files)
+{
+	FASTX_SINK_POOL *pool;
+
+	pool = calloc(1, sizeof(FASTX_SINK_POOL));
+	if (pool==NULL)
+		fastx_err(1,"failed to allocate output pool");
+
+	pool->buffer_size = (buffer_size>0) ? buffer_size : FASTX_SINK_DEFAULT_BUFFER_SIZE ;
+	pool->max_queued_buffers = FASTX_SINK_DEFAULT_QUEUED_BUFFERS;
+	pool->max_open_files = (max_open_files>0) ? max_open_files : default_max_open_files();
+
+	pool->open_sinks = calloc(pool->max_open_files, sizeof(struct fastx_sink*));
+	if (pool->open_sinks==NULL)
+		fastx_err(1,"failed to allocate output pool");
+
+	pool->staging = open_memstream(&pool->staging_buffer, &pool->staging_size);
+	if (pool->staging==NULL)
+		fastx_err(1,"open_memstream failed");
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->work_ready, NULL);
+	pthread_cond_init(&pool->buffer_flushed, NULL);
+	if (pthread_create(&pool->flusher, NULL, flusher_thread, pool)!=0)
+		fastx_errx(1,"failed to start output flusher thread");
+
+	return pool;
+}
+
+size_t fastx_sink_pool_add(FASTX_SINK_POOL *pool, const char* filename, int compress)
+{
+	struct fastx_sink *sink;
+
+	if (pool->sinks_count == pool->sinks_capacity) {
+		pool->sinks_capacity = (pool->sinks_capacity>0) ? pool->sinks_capacity*2 : 16 ;
+		pool->sinks = realloc(pool->sinks, pool->sinks_capacity * sizeof(struct fastx_sink*));
+		if (pool->sinks==NULL)
+			fastx_err(1,"failed to allocate output pool");
+	}
+
+	sink = calloc(1, sizeof(struct fastx_sink));
+	if (sink==NULL)
+		fastx_err(1,"failed to allocate output pool");
+	sink->filename = strdup(filename);
+	if (sink->filename==NULL)
+		fastx_err(1,"failed to allocate output pool");
+	sink->compress = compress;
+	sink->fd = -1;
+
+	pool->sinks[pool->sinks_count] = sink;
+	return pool->sinks_count++;
+}
+
+// Returns an empty buffer - waits for the flusher if too many buffers are queued.
+static struct fastx_sink_buffer* get_empty_buffer(FASTX_SINK_POOL *pool)
+{
+	struct fastx_sink_buffer *buffer;
+
+	pthread_mutex_lock(&pool->lock);
+	while (pool->queued_buffers >= pool->max_queued_buffers)
+		pthread_cond_wait(&pool->buffer_flushed, &pool->lock);
+	buffer = pool->free_buffers;
+	if (buffer!=NULL)
+		pool->free_buffers = buffer->next;
+	pthread_mutex_unlock(&pool->lock);
+
+	if (buffer==NULL) {
+		buffer = malloc(sizeof(struct fastx_sink_buffer) + pool->buffer_size);
+		if (buffer==NULL)
+			fastx_err(1,"failed to allocate output buffer");
+	}
+	buffer->next = NULL;
+	buffer->length = 0 ;
+	return buffer;
+}
+
+static void queue_buffer(FASTX_SINK_POOL *pool, struct fastx_sink_buffer *buffer)
+{
+	pthread_mutex_lock(&pool->lock);
+	buffer->next = NULL;
+	if (pool->queue_tail!=NULL)
+		pool->queue_tail->next = buffer;
+	else
+		pool->queue_head = buffer;
+	pool->queue_tail = buffer;
+	pool->queued_buffers++;
+	pthread_cond_signal(&pool->work_ready);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void fastx_sink_write(FASTX_SINK_POOL *pool, size_t sink_index, const char* data, size_t length)
+{
+	struct fastx_sink *sink;
+	struct fastx_sink_buffer *buffer;
+	size_t count;
+
+	if (sink_index >= pool->sinks_count)
+		fastx_errx(1,"Internal error: invalid output sink %zu (%s:%d)", sink_index, __FILE__, __LINE__);
+	sink = pool->sinks[sink_index];
+
+	while (length>0) {
+		if (sink->active==NULL) {
+			sink->active = get_empty_buffer(pool);
+			sink->active->sink = sink;
+		}
+		buffer = sink->active;
+
+		count = pool->buffer_size - buffer->length;
+		if (count > length)
+			count = length;
+		memcpy(buffer->data + buffer->length, data, count);
+		buffer->length += count;
+		data += count;
+		length -= count;
+
+		if (buffer->length == pool->buffer_size) {
+			queue_buffer(pool, buffer);
+			sink->active = NULL;
+		}
+	}
+}
+
+void fastx_sink_write_record(FASTX_SINK_POOL *pool, size_t sink_index, FASTX *pFASTX)
+{
+	FILE *output = pFASTX->output;
+	const char *raw_record = pFASTX->raw_record;
+
+	if (fseeko(pool->staging, 0, SEEK_SET)!=0)
+		fastx_err(1,"fseek (staging buffer) failed");
+
+	//The staging buffer is read right away - format the record now,
+	//instead of collecting it with other raw records
+	pFASTX->raw_record = NULL;
+	pFASTX->output = pool->staging;
+	fastx_write_record(pFASTX);
+	pFASTX->output = output;
+	pFASTX->raw_record = raw_record;
+
+	fastx_timed_call_begin(FASTX_TIMED_SINK_WRITE, FASTX_TIMER_WRITE);
+	if (fflush(pool->staging)!=0)
+		fastx_err(1,"failed to format output record");
+	fastx_sink_write(pool, sink_index, pool->staging_buffer, pool->staging_size);
+	fastx_timed_call_end();
+}
+
+void fastx_sink_pool_close(FASTX_SINK_POOL *pool)
+{
+	struct fastx_sink *sink;
+	size_t i;
+
+	for (i=0; i<pool->sinks_count; i++) {
+		sink = pool->sinks[i];
+		if (sink->active!=NULL && sink->active->length>0)
+			queue_buffer(pool, sink->active);
+		else
+			free(sink->active);
+		sink->active = NULL;
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stop = 1;
+	pthread_cond_signal(&pool->work_ready);
+	pthread_mutex_unlock(&pool->lock);
+	if (pthread_join(pool->flusher, NULL)!=0)
+		fastx_errx(1,"failed to stop output flusher thread");
+
+	//The flusher is done - create the files which were never written to, and close everything
+	for (i=0; i<pool->sinks_count; i++) {
+		sink = pool->sinks[i];
+		if (!sink->created)
+			open_sink(pool, sink);
+		close_sink(pool, sink);
+		free(sink->filename);
+		free(sink);
+	}
+
+	while (pool->free_buffers!=NULL) {
+		struct fastx_sink_buffer *next = pool->free_buffers->next;
+		free(pool->free_buffers);
+		pool->free_buffers = next;
+	}
+
+	fclose(pool->staging);
+	free(pool->staging_buffer);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->work_ready);
+	pthread_cond_destroy(&pool->buffer_flushed);
+	free(pool->open_sinks);
+	free(pool->sinks);
+	free(pool);
+}
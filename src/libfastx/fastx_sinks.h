@@ -0,0 +1,124 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_SINKS_H__
+#define __FASTX_SINKS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <pthread.h>
+#include <sys/types.h>
+
+#include "fastx.h"
+
+/*
+	Multi-sink writer pool -
+	For programs which split one input into many output files
+	(e.g. one file per barcode).
+
+	Each sink (output file) has its own append buffer. Full buffers are
+	queued, and written (in large writes) by a background flusher thread.
+
+	The flusher keeps a limited number of file descriptors open
+	(by default, derived from 'ulimit -n'). When the limit is reached
+	(or open() fails with EMFILE), the least-recently-used sink is closed,
+	and re-opened later in append mode.
+
+	Compressed sinks are piped through GZIP. Closing and re-opening
+	a compressed sink starts a new GZIP member in the same file
+	(concatenated GZIP members are a valid GZIP file).
+
+	All output files are created (even if nothing was written to them)
+	when the pool is closed.
+*/
+
+#define FASTX_SINK_DEFAULT_BUFFER_SIZE   (128*1024)
+#define FASTX_SINK_DEFAULT_QUEUED_BUFFERS (32)
+
+struct fastx_sink_buffer;
+
+struct fastx_sink
+{
+	char	*filename;
+	int	compress;		// 1 = pass output through GZIP
+
+	/* Owned by the writing thread */
+	struct fastx_sink_buffer *active; // partially filled buffer
+
+	/* Owned by the flusher thread */
+	int	fd;			// -1 if not currently open
+	pid_t	compressor_pid;		// GZIP process, if 'compress' and open
+	int	created;		// 1 = file was created (re-open in append mode)
+	unsigned long long last_used;	// for the LRU
+	size_t	open_slot;		// position in 'open_sinks'
+};
+
+typedef struct
+{
+	struct fastx_sink **sinks;
+	size_t	sinks_count;
+	size_t	sinks_capacity;
+
+	size_t	buffer_size;
+	size_t	max_queued_buffers;
+
+	/* Queue of full buffers, protected by 'lock' */
+	pthread_mutex_t lock;
+	pthread_cond_t	work_ready;
+	pthread_cond_t	buffer_flushed;
+	struct fastx_sink_buffer *queue_head;
+	struct fastx_sink_buffer *queue_tail;
+	size_t	queued_buffers;
+	struct fastx_sink_buffer *free_buffers;
+	int	stop;
+
+	pthread_t flusher;
+
+	/* Open file descriptors LRU - owned by the flusher thread */
+	struct fastx_sink **open_sinks;
+	size_t	open_count;
+	size_t	max_open_files;
+	unsigned long long lru_clock;
+
+	/* Staging stream for fastx_sink_write_record() */
+	FILE	*staging;
+	char	*staging_buffer;
+	size_t	staging_size;
+} FASTX_SINK_POOL;
+
+// buffer_size=0, max_open_files=0 = use the defaults
+FASTX_SINK_POOL* fastx_sink_pool_new(size_t buffer_size, size_t max_open_files);
+
+// Returns the new sink's index. The file is not opened until data is flushed to it.
+size_t fastx_sink_pool_add(FASTX_SINK_POOL *pool, const char* filename, int compress);
+
+void fastx_sink_write(FASTX_SINK_POOL *pool, size_t sink, const char* data, size_t length);
+
+// Write a record (in the format set by fastx_init_writer()) to a sink
+void fastx_sink_write_record(FASTX_SINK_POOL *pool, size_t sink, FASTX *pFASTX);
+
+// Flush all buffers, create all the files, close everything and free the pool.
+void fastx_sink_pool_close(FASTX_SINK_POOL *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,315 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fastx_error.h"
+#include "fastx.h"
+#include "fastx_stages.h"
+
+/*
+	fastx_trimmer
+*/
+void fastx_trimmer_init_options(struct fastx_trimmer_options *options)
+{
+	options->keep_first_base = 1;
+	options->keep_last_base = DO_NOT_TRIM_LAST_BASE;
+	options->trim_last_bases = 0;
+	options->minimum_length = 0;
+	options->trim_by_position = 0;
+	options->trim_from_end = 0;
+}
+
+int fastx_trimmer_parse_option(struct fastx_trimmer_options *options, int optc, const char* optarg)
+{
+	switch(optc) {
+	case 'f':
+		if (optarg==NULL) 
+			fastx_errx(1, "[-f] parameter requires an argument value");
+		options->keep_first_base = strtoul(optarg,NULL,10);
+		if (options->keep_first_base<=0 || options->keep_first_base>=MAX_SEQ_LINE_LENGTH) 
+			fastx_errx(1,"Invalid number bases to keep (-f %s)", optarg);
+		options->trim_by_position=1;
+		break;
+
+	case 'l':
+		if (optarg==NULL) 
+			fastx_errx(1, "[-l] parameter requires an argument value");
+		options->keep_last_base = strtoul(optarg,NULL,10);
+		if (options->keep_last_base<=0 ||  options->keep_last_base>=MAX_SEQ_LINE_LENGTH) 
+			fastx_errx(1,"Invalid number bases to keep (-l %s)", optarg);
+		options->trim_by_position=1;
+		break;
+
+	case 't':
+		if (optarg==NULL)
+			fastx_errx(1, "[-t] parameter requires an argument value");
+		options->trim_last_bases = strtoul(optarg,NULL,10);
+		if (options->trim_last_bases<=0 ||  options->trim_last_bases>=MAX_SEQ_LINE_LENGTH)
+			fastx_errx(1,"Invalid number bases to trim (-t %s)", optarg);
+		options->trim_from_end=1;
+		break;
+
+	case 'm':
+		if (optarg==NULL)
+			fastx_errx(1, "[-t] parameter requires an argument value");
+		options->minimum_length = strtoul(optarg,NULL,10);
+		if (options->minimum_length<=0 ||  options->minimum_length>=MAX_SEQ_LINE_LENGTH)
+			fastx_errx(1,"Invalid minimum length value (-m %s)", optarg);
+		break;
+
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+void fastx_trimmer_validate_options(const struct fastx_trimmer_options *options)
+{
+	if (options->trim_by_position && options->trim_from_end)
+		fastx_errx(1,"[-t], [-f] and [-l] options can not be used together. Use [-t] or [-l,-f]");
+}
+
+int fastx_trimmer_process(FASTX *pFASTX, const struct fastx_trimmer_options *options)
+{
+	size_t length;
+
+	if (options->keep_last_base != DO_NOT_TRIM_LAST_BASE) {
+		length = fastx_view_length(pFASTX);
+		if ( length > (size_t)options->keep_last_base )
+			fastx_trim_end(pFASTX, length - options->keep_last_base);
+	}
+
+	if (options->keep_first_base != 1) {
+		if ( fastx_view_length(pFASTX) < (size_t)options->keep_first_base ) //sequence too short - remove it
+			return 0;
+		fastx_trim_start(pFASTX, options->keep_first_base-1);
+	}
+
+	if (options->trim_last_bases>0) {
+		length = fastx_view_length(pFASTX);
+		if (length <= options->trim_last_bases)
+			return 0;
+		if (length - options->trim_last_bases < options->minimum_length)
+			return 0;
+		fastx_trim_end(pFASTX, options->trim_last_bases);
+	}
+
+	return 1;
+}
+
+/*
+	fastq_quality_trimmer
+*/
+void fastq_quality_trimmer_init_options(struct fastq_quality_trimmer_options *options)
+{
+	options->min_quality_threshold = 0;
+	options->min_length = 0;
+}
+
+int fastq_quality_trimmer_parse_option(struct fastq_quality_trimmer_options *options, int optc, const char* optarg)
+{
+	switch(optc) {
+	case 'l':
+		if (optarg==NULL) 
+			fastx_errx(1, "[-l] parameter requires an argument value");
+		options->min_length = strtoul(optarg,NULL,10);
+		if (options->min_length<0)
+			fastx_errx(1,"Invalid minimum length value (-l %s)", optarg);
+		break;
+
+	case 't':
+		if (optarg==NULL) 
+			fastx_errx(1, "[-t] parameter requires an argument value");
+		options->min_quality_threshold = strtol(optarg,NULL,10);
+		break;
+
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+void fastq_quality_trimmer_validate_options(const struct fastq_quality_trimmer_options *options)
+{
+	if ( options->min_quality_threshold == 0 )
+		fastx_errx(1, "Missing minimum quality threshold value (-t)" ) ;
+}
+
+int fastq_quality_trimmer_process(FASTX *pFASTX, const struct fastq_quality_trimmer_options *options)
+{
+	int i ;
+	const int *quality ;
+
+	//Scan each sequence - backwards
+	quality = fastx_view_quality(pFASTX);
+	for ( i=(int)fastx_view_length(pFASTX)-1 ; i >=0 ; i-- ) {
+		if ( quality[i] >= options->min_quality_threshold ) 
+			break ;	
+	}
+	fastx_trim_end(pFASTX, fastx_view_length(pFASTX) - (i+1));
+
+	return ( i>=0 && i+1 >= options->min_length );
+}
+
+/*
+	fastq_quality_filter
+*/
+void fastq_quality_filter_init_options(struct fastq_quality_filter_options *options)
+{
+	options->min_quality = 0;
+	options->min_percent = 0;
+}
+
+int fastq_quality_filter_parse_option(struct fastq_quality_filter_options *options, int optc, const char* optarg)
+{
+	switch(optc) {
+	case 'q':
+		if (optarg==NULL) 
+			fastx_errx(1, "[-q] parameter requires an argument value");
+		options->min_quality = strtoul(optarg,NULL,10);
+		break;
+
+	case 'p':
+		if (optarg==NULL) 
+			fastx_errx(1, "[-l] parameter requires an argument value");
+		options->min_percent = strtoul(optarg,NULL,10);
+		if (options->min_percent<=0 ||  options->min_percent>100) 
+			fastx_errx(1,"Invalid percent value (-p %s)", optarg);
+		break;
+
+	default:
+		return 0;
+	}
+	return 1;
+}
+
+static int get_index_of_nth_element(int *array, int array_size, int n)
+{
+	int pos;
+
+	//Find the first nono-empty index
+	pos = 0 ;
+	while ( pos < array_size && array[pos]==0 )
+		pos++;
+
+	if (pos == array_size)
+		fastx_errx(1,"bug: got empty array at %s:%d", __FILE__, __LINE__);
+	
+	while (n > 0) {
+		if (array[pos] > n)
+			break;
+		n -= array[pos];
+		pos++;
+		while (array[pos]==0 && pos < array_size)
+			pos++;
+	}
+	return pos;
+}
+
+int get_percentile_quality(const FASTX *pFASTX, int percentile)
+{
+	size_t i;
+	int count=0;
+	int quality_values[QUALITY_VALUES_RANGE];
+	const int *quality;
+	size_t length;
+
+	memset(quality_values, 0, sizeof(quality_values));
+
+	quality = fastx_view_quality(pFASTX);
+	length = fastx_view_length(pFASTX);
+	for (i=0; i<length; i++) {
+		count++;
+		quality_values[ quality[i] - MIN_QUALITY_VALUE ] ++ ;
+	}
+
+	i = get_index_of_nth_element(quality_values, QUALITY_VALUES_RANGE, (count * (100-percentile) / 100));
+	
+	return i + MIN_QUALITY_VALUE ;
+}
+
+int fastq_quality_filter_process(const FASTX *pFASTX, const struct fastq_quality_filter_options *options)
+{
+	return ( get_percentile_quality(pFASTX, options->min_percent) >= options->min_quality ) ;
+}
+
+/*
+	fastx_artifacts_filter
+*/
+int artifact_sequence(const FASTX *pFASTX)
+{
+	int n_count=0;
+	int a_count=0;
+	int c_count=0;
+	int t_count=0;
+	int g_count=0;
+	int total_count=0;
+
+	int max_allowed_different_bases = 3 ;
+
+	const char *nucleotides = fastx_view_nucleotides(pFASTX);
+	int length = (int)fastx_view_length(pFASTX);
+	int i;
+
+	for (i=0; i<length; i++) {
+		total_count++;
+		switch(nucleotides[i])
+		{
+		case 'A':
+			a_count++;
+			break;
+		case 'C':
+			c_count++;
+			break;
+		case 'G':
+			g_count++;
+			break;
+		case 'T':
+			t_count++;
+			break;
+		case 'N':
+			n_count++;
+			break;
+		default:
+			fastx_errx(1, __FILE__":%d: invalid nucleotide value (%c) at position %d",
+				__LINE__, nucleotides[i], i ) ;
+		}
+	}
+
+	//Rules for artifacts
+	
+	if ( a_count>=(total_count-max_allowed_different_bases) 
+	     ||
+	     c_count>=(total_count-max_allowed_different_bases)
+	     ||
+	     g_count>=(total_count-max_allowed_different_bases)
+	     ||
+	     t_count>=(total_count-max_allowed_different_bases)
+	     )
+	     return 1;
+	 
+
+	 return 0;
+}
+
+int fastx_artifacts_filter_process(const FASTX *pFASTX)
+{
+	return !artifact_sequence(pFASTX);
+}
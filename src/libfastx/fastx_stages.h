@@ -0,0 +1,96 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_STAGES_H__
+#define __FASTX_STAGES_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "fastx.h"
+
+/*
+	Per-record processing stages.
+
+	The record logic of fastx_trimmer, fastq_quality_trimmer,
+	fastq_quality_filter and fastx_artifacts_filter, shared between the
+	stand-alone programs and fastx_pipeline.
+
+	Each stage works on the record's current view (see fastx_trim_start()),
+	so several stages can be applied to the same record, one after the other,
+	exactly as if the record was written and re-read between them.
+
+	The *_process() functions return 1 if the record should be kept,
+	0 if it should be discarded.
+	The *_parse_option() functions accept the same option letters as the
+	stand-alone programs, and return 0 for unknown options.
+*/
+
+/* fastx_trimmer */
+#define DO_NOT_TRIM_LAST_BASE (0)
+
+struct fastx_trimmer_options
+{
+	int keep_first_base;		// 1 = first base
+	int keep_last_base;		// DO_NOT_TRIM_LAST_BASE = entire read
+	unsigned int trim_last_bases;
+	unsigned int minimum_length;
+	int trim_by_position;
+	int trim_from_end;
+};
+
+void fastx_trimmer_init_options(struct fastx_trimmer_options *options);
+int  fastx_trimmer_parse_option(struct fastx_trimmer_options *options, int optc, const char* optarg);
+void fastx_trimmer_validate_options(const struct fastx_trimmer_options *options);
+int  fastx_trimmer_process(FASTX *pFASTX, const struct fastx_trimmer_options *options);
+
+/* fastq_quality_trimmer */
+struct fastq_quality_trimmer_options
+{
+	int min_quality_threshold;
+	int min_length;
+};
+
+void fastq_quality_trimmer_init_options(struct fastq_quality_trimmer_options *options);
+int  fastq_quality_trimmer_parse_option(struct fastq_quality_trimmer_options *options, int optc, const char* optarg);
+void fastq_quality_trimmer_validate_options(const struct fastq_quality_trimmer_options *options);
+int  fastq_quality_trimmer_process(FASTX *pFASTX, const struct fastq_quality_trimmer_options *options);
+
+/* fastq_quality_filter */
+struct fastq_quality_filter_options
+{
+	int min_quality;
+	int min_percent;
+};
+
+void fastq_quality_filter_init_options(struct fastq_quality_filter_options *options);
+int  fastq_quality_filter_parse_option(struct fastq_quality_filter_options *options, int optc, const char* optarg);
+int  fastq_quality_filter_process(const FASTX *pFASTX, const struct fastq_quality_filter_options *options);
+
+// The quality score which at least 'percentile' percent of the bases (in the view) have.
+int get_percentile_quality(const FASTX *pFASTX, int percentile);
+
+/* fastx_artifacts_filter */
+int artifact_sequence(const FASTX *pFASTX);
+int fastx_artifacts_filter_process(const FASTX *pFASTX);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,352 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "fastx_error.h"
+#include "fastx.h"
+#include "fastx_store.h"
+
+#define ALIGN8(x) ( ((x)+7) & ~((uint64_t)7) )
+
+/*
+	Reader
+*/
+
+// 4 bases for each possible packed byte
+static char unpack_table[256][4];
+static pthread_once_t unpack_table_once = PTHREAD_ONCE_INIT;
+
+static void init_unpack_table()
+{
+	int byte, i;
+
+	for (byte=0; byte<256; byte++)
+		for (i=0; i<4; i++)
+			unpack_table[byte][i] = "ACGT"[ (byte >> (i*2)) & 3 ];
+}
+
+static void check_section(const FASTX_STORE *store, const char* name,
+		uint64_t offset, uint64_t size, const char* section)
+{
+	if (offset > store->map_size || size > store->map_size - offset)
+		fastx_errx(1,"binary read store (%s) is corrupted (%s section is outside the file)",
+				name, section);
+}
+
+FASTX_STORE* fastx_store_open_fd(int fd, const char* name)
+{
+	FASTX_STORE *store;
+	const struct fastx_store_header *header;
+	struct stat st;
+	void *map;
+
+	if (fstat(fd, &st)!=0)
+		fastx_err(1,"fstat failed (%s)", name);
+	if (!S_ISREG(st.st_mode))
+		fastx_errx(1,"binary read store (%s) must be a regular file (it can't be read from a pipe)", name);
+	if ((size_t)st.st_size < sizeof(struct fastx_store_header))
+		fastx_errx(1,"binary read store (%s) is truncated", name);
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map==MAP_FAILED)
+		fastx_err(1,"mmap failed (%s)", name);
+	posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+
+	store = calloc(1, sizeof(FASTX_STORE));
+	if (store==NULL)
+		fastx_err(1,"failed to allocate binary read store");
+	store->map = map;
+	store->map_size = st.st_size;
+
+	header = (const struct fastx_store_header*)map;
+	if (memcmp(header->magic, FASTX_STORE_MAGIC, sizeof(header->magic))!=0)
+		fastx_errx(1,"input file (%s) is not a binary read store", name);
+	if (header->version != FASTX_STORE_VERSION)
+		fastx_errx(1,"binary read store (%s) has unsupported version %u", name, header->version);
+
+	check_section(store, name, header->index_offset,
+			header->records_count * sizeof(struct fastx_store_index_entry), "index");
+	check_section(store, name, header->names_offset, header->names_size, "names");
+	check_section(store, name, header->sequence_offset, header->bases_count/4, "sequence");
+	check_section(store, name, header->nmask_offset, header->bases_count/8, "N-mask");
+	if (header->flags & FASTX_STORE_FASTQ)
+		check_section(store, name, header->quality_offset, header->quality_size, "quality");
+	if (header->names_size>0 && store->map[header->names_offset + header->names_size - 1] != 0)
+		fastx_errx(1,"binary read store (%s) is corrupted (names section)", name);
+
+	store->header = header;
+	store->index = (const struct fastx_store_index_entry*)(store->map + header->index_offset);
+	store->names = (const char*)(store->map + header->names_offset);
+	store->sequence = store->map + header->sequence_offset;
+	store->nmask = store->map + header->nmask_offset;
+	store->quality = (header->flags & FASTX_STORE_FASTQ) ? store->map + header->quality_offset : NULL;
+
+	//Readers in different threads can open stores at the same time
+	pthread_once(&unpack_table_once, init_unpack_table);
+
+	return store;
+}
+
+void fastx_store_close(FASTX_STORE *store)
+{
+	if (store==NULL)
+		return;
+	munmap((void*)store->map, store->map_size);
+	free(store);
+}
+
+size_t fastx_store_records_count(const FASTX_STORE *store)
+{
+	return store->header->records_count;
+}
+
+void fastx_store_get_record(const FASTX_STORE *store, size_t record, FASTX_STORE_RECORD *view)
+{
+	const struct fastx_store_header *header = store->header;
+	const struct fastx_store_index_entry *entry;
+	size_t name_length;
+
+	if (record >= header->records_count)
+		fastx_errx(1,"Internal error: invalid store record %zu (%s:%d)", record, __FILE__, __LINE__);
+	entry = &store->index[record];
+
+	//Cheap sanity checks - everything else was validated when the store was created
+	if (entry->length==0 || entry->length > MAX_SEQ_LINE_LENGTH
+	    || (entry->base_offset & 7)!=0
+	    || entry->base_offset > header->bases_count
+	    || entry->length > header->bases_count - entry->base_offset
+	    || entry->name_offset >= header->names_size
+	    || (store->quality!=NULL && (entry->quality_offset > header->quality_size
+	                                 || entry->length > header->quality_size - entry->quality_offset)))
+		fastx_errx(1,"binary read store is corrupted (record %zu)", record);
+
+	view->name = store->names + entry->name_offset;
+	name_length = strlen(view->name);
+	if (entry->name_offset + name_length + 1 >= header->names_size)
+		fastx_errx(1,"binary read store is corrupted (record %zu)", record);
+	view->name2 = view->name + name_length + 1;
+	view->packed_sequence = store->sequence + entry->base_offset/4;
+	view->nmask = store->nmask + entry->base_offset/8;
+	view->quality = (store->quality!=NULL) ? store->quality + entry->quality_offset : NULL;
+	view->length = entry->length;
+}
+
+void fastx_store_unpack_sequence(const FASTX_STORE_RECORD *view, char *nucleotides)
+{
+	size_t i, bit;
+	unsigned char mask;
+
+	for (i=0; i+4<=view->length; i+=4)
+		memcpy(nucleotides+i, unpack_table[view->packed_sequence[i>>2]], 4);
+	for (; i<view->length; i++)
+		nucleotides[i] = unpack_table[view->packed_sequence[i>>2]][i&3];
+
+	for (i=0; i<view->length; i+=8) {
+		mask = view->nmask[i>>3];
+		for (bit=0; mask!=0; bit++, mask>>=1)
+			if (mask & 1)
+				nucleotides[i+bit] = 'N';
+	}
+	nucleotides[view->length] = 0 ;
+}
+
+void fastx_store_unpack_quality(const FASTX_STORE_RECORD *view, int *quality)
+{
+	size_t i;
+
+	for (i=0; i<view->length; i++)
+		quality[i] = (int)view->quality[i] + MIN_QUALITY_VALUE;
+}
+
+/*
+	Writer
+*/
+struct fastx_store_writer
+{
+	char	filename[PATH_MAX];
+	FILE	*output;
+	struct fastx_store_header header;
+
+	/* Sections are spooled to temporary files until the store is closed */
+	FILE	*index;
+	FILE	*names;
+	FILE	*sequence;
+	FILE	*nmask;
+	FILE	*quality;
+
+	unsigned char packed[(MAX_SEQ_LINE_LENGTH+8)/4];
+	unsigned char mask[(MAX_SEQ_LINE_LENGTH+8)/8];
+	unsigned char quality_bytes[MAX_SEQ_LINE_LENGTH+1];
+};
+
+static FILE* create_spool_file()
+{
+	FILE *f = tmpfile();
+	if (f==NULL)
+		fastx_err(1,"failed to create temporary file");
+	return f;
+}
+
+static void write_or_die(struct fastx_store_writer *writer, FILE* f, const void* data, size_t size)
+{
+	if (size>0 && fwrite(data, 1, size, f)!=size)
+		fastx_err(1,"writing binary read store (%s) failed", writer->filename);
+}
+
+struct fastx_store_writer* fastx_store_writer_new(const char* filename, int fastq,
+		int fastq_ascii, int fastq_ascii_quality_offset)
+{
+	struct fastx_store_writer *writer;
+
+	writer = calloc(1, sizeof(struct fastx_store_writer));
+	if (writer==NULL)
+		fastx_err(1,"failed to allocate binary read store writer");
+
+	strncpy(writer->filename, filename, sizeof(writer->filename)-1);
+	if (strcmp(filename,"-")==0) {
+		writer->output = stdout;
+	} else {
+		writer->output = fopen(filename, "w");
+		if (writer->output==NULL)
+			fastx_err(1,"Failed to create output file (%s)", filename);
+	}
+
+	memcpy(writer->header.magic, FASTX_STORE_MAGIC, sizeof(writer->header.magic));
+	writer->header.version = FASTX_STORE_VERSION;
+	writer->header.flags = (fastq ? FASTX_STORE_FASTQ : 0) | (fastq_ascii ? FASTX_STORE_FASTQ_ASCII : 0);
+	writer->header.fastq_ascii_quality_offset = fastq_ascii_quality_offset;
+
+	writer->index = create_spool_file();
+	writer->names = create_spool_file();
+	writer->sequence = create_spool_file();
+	writer->nmask = create_spool_file();
+	if (fastq)
+		writer->quality = create_spool_file();
+
+	return writer;
+}
+
+void fastx_store_writer_add(struct fastx_store_writer *writer,
+		const char* name, const char* name2,
+		const char* nucleotides, const int* quality, size_t length)
+{
+	struct fastx_store_index_entry entry;
+	size_t padded_length = ALIGN8(length);
+	size_t i;
+	unsigned int code;
+
+	if (length==0 || length > MAX_SEQ_LINE_LENGTH)
+		fastx_errx(1,"Internal error: invalid sequence length %zu (%s:%d)", length, __FILE__, __LINE__);
+
+	memset(&entry, 0, sizeof(entry));
+	entry.name_offset = writer->header.names_size;
+	entry.base_offset = writer->header.bases_count;
+	entry.quality_offset = writer->header.quality_size;
+	entry.length = length;
+	write_or_die(writer, writer->index, &entry, sizeof(entry));
+
+	write_or_die(writer, writer->names, name, strlen(name)+1);
+	write_or_die(writer, writer->names, name2, strlen(name2)+1);
+	writer->header.names_size += strlen(name) + strlen(name2) + 2;
+
+	memset(writer->packed, 0, padded_length/4);
+	memset(writer->mask, 0, padded_length/8);
+	for (i=0; i<length; i++) {
+		switch (nucleotides[i]) {
+		case 'A': code = 0; break;
+		case 'C': code = 1; break;
+		case 'G': code = 2; break;
+		case 'T': code = 3; break;
+		case 'N':
+			code = 0;
+			writer->mask[i>>3] |= 1<<(i&7);
+			writer->header.flags |= FASTX_STORE_HAS_N;
+			break;
+		default:
+			fastx_errx(1,"invalid base '%c' for a binary read store (only A/C/G/T/N are allowed)",
+					nucleotides[i]);
+		}
+		writer->packed[i>>2] |= code << ((i&3)*2);
+	}
+	write_or_die(writer, writer->sequence, writer->packed, padded_length/4);
+	write_or_die(writer, writer->nmask, writer->mask, padded_length/8);
+	writer->header.bases_count += padded_length;
+
+	if (writer->quality!=NULL) {
+		for (i=0; i<length; i++)
+			writer->quality_bytes[i] = (unsigned char)(quality[i] - MIN_QUALITY_VALUE);
+		write_or_die(writer, writer->quality, writer->quality_bytes, length);
+		writer->header.quality_size += length;
+	}
+
+	writer->header.records_count++;
+}
+
+// Append a spooled section to the store, padded to 8 bytes
+static void copy_section(struct fastx_store_writer *writer, FILE* section, uint64_t size)
+{
+	static const char padding[8] = { 0 } ;
+	char buffer[65536];
+	size_t count;
+
+	if (section==NULL)
+		return;
+
+	rewind(section);
+	while ( (count = fread(buffer, 1, sizeof(buffer), section)) > 0 )
+		write_or_die(writer, writer->output, buffer, count);
+	if (ferror(section))
+		fastx_err(1,"reading temporary file failed");
+	fclose(section);
+
+	write_or_die(writer, writer->output, padding, ALIGN8(size) - size);
+}
+
+void fastx_store_writer_close(struct fastx_store_writer *writer)
+{
+	struct fastx_store_header *header = &writer->header;
+	uint64_t index_size = header->records_count * sizeof(struct fastx_store_index_entry);
+
+	header->index_offset = ALIGN8(sizeof(struct fastx_store_header));
+	header->names_offset = header->index_offset + ALIGN8(index_size);
+	header->sequence_offset = header->names_offset + ALIGN8(header->names_size);
+	header->nmask_offset = header->sequence_offset + ALIGN8(header->bases_count/4);
+	if (writer->quality!=NULL)
+		header->quality_offset = header->nmask_offset + ALIGN8(header->bases_count/8);
+
+	write_or_die(writer, writer->output, header, sizeof(struct fastx_store_header));
+	write_or_die(writer, writer->output, "\0\0\0\0\0\0\0",
+			header->index_offset - sizeof(struct fastx_store_header));
+	copy_section(writer, writer->index, index_size);
+	copy_section(writer, writer->names, header->names_size);
+	copy_section(writer, writer->sequence, header->bases_count/4);
+	copy_section(writer, writer->nmask, header->bases_count/8);
+	copy_section(writer, writer->quality, header->quality_size);
+
+	if (fclose(writer->output)!=0)
+		fastx_err(1,"writing binary read store (%s) failed", writer->filename);
+	free(writer);
+}
@@ -0,0 +1,156 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_STORE_H__
+#define __FASTX_STORE_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	Binary read store -
+	A pre-parsed, pre-validated copy of a FASTA/FASTQ file, which is
+	mmap'd by the reader (instead of parsing and validating text on every
+	pass). Create one with the 'fastx_store' program.
+
+	File layout (all integers in native byte order, all sections 8-byte aligned):
+
+	  header      struct fastx_store_header
+	  index       one struct fastx_store_index_entry per record
+	  names       "name\0name2\0" for each record
+	  sequence    2-bit packed bases (A=0,C=1,G=2,T=3), 4 bases per byte,
+	              first base in the lowest bits
+	  N-mask      1 bit per base (set = 'N'), 8 bases per byte
+	  quality     1 byte per base: quality value - MIN_QUALITY_VALUE (FASTQ only)
+
+	Each record's bases start on a multiple of 8, so every record's
+	sequence and N-mask start on a byte boundary.
+
+	Only upper-case A/C/G/T/N bases can be stored.
+*/
+
+#define FASTX_STORE_MAGIC      "\x89" "FXS\r\n\x1a\n"
+#define FASTX_STORE_MAGIC_BYTE (0x89)
+#define FASTX_STORE_VERSION    (1)
+
+#define FASTX_STORE_FASTQ       (1)	// records have quality scores
+#define FASTX_STORE_FASTQ_ASCII (2)	// the original FASTQ file had ASCII quality scores
+#define FASTX_STORE_HAS_N       (4)	// at least one base is 'N'
+
+struct fastx_store_header
+{
+	char	 magic[8];
+	uint32_t version;
+	uint32_t flags;
+	int32_t	 fastq_ascii_quality_offset;	// the offset used when the store was created
+	uint32_t reserved;
+	uint64_t records_count;
+	uint64_t bases_count;		// including the padding between records
+
+	/* file offsets of the sections */
+	uint64_t index_offset;
+	uint64_t names_offset;
+	uint64_t names_size;
+	uint64_t sequence_offset;
+	uint64_t nmask_offset;
+	uint64_t quality_offset;	// 0 if the store has no quality scores
+	uint64_t quality_size;
+};
+
+struct fastx_store_index_entry
+{
+	uint64_t name_offset;		// relative to the names section
+	uint64_t base_offset;		// index of the first base (always a multiple of 8)
+	uint64_t quality_offset;	// relative to the quality section
+	uint32_t length;
+	uint32_t reserved;
+};
+
+typedef struct fastx_store
+{
+	const unsigned char *map;
+	size_t	map_size;
+
+	const struct fastx_store_header *header;
+	const struct fastx_store_index_entry *index;
+	const char *names;
+	const unsigned char *sequence;
+	const unsigned char *nmask;
+	const unsigned char *quality;
+
+	size_t	next_record;		// used by fastx_read_next_record()
+} FASTX_STORE;
+
+/*
+	Zero-copy view of a stored record - all pointers point into the mapped file.
+*/
+typedef struct
+{
+	const char *name;
+	const char *name2;
+	const unsigned char *packed_sequence;	// use fastx_store_base()
+	const unsigned char *nmask;
+	const unsigned char *quality;		// NULL for FASTA stores
+	size_t	length;
+} FASTX_STORE_RECORD;
+
+// Map a store file. 'name' is used in error messages.
+FASTX_STORE* fastx_store_open_fd(int fd, const char* name);
+
+void fastx_store_close(FASTX_STORE *store);
+
+size_t fastx_store_records_count(const FASTX_STORE *store);
+
+void fastx_store_get_record(const FASTX_STORE *store, size_t record, FASTX_STORE_RECORD *view);
+
+// Unpack a record's bases (NULL-terminated) and quality scores
+void fastx_store_unpack_sequence(const FASTX_STORE_RECORD *view, char *nucleotides);
+void fastx_store_unpack_quality(const FASTX_STORE_RECORD *view, int *quality);
+
+static inline char fastx_store_base(const FASTX_STORE_RECORD *view, size_t i)
+{
+	if (view->nmask[i>>3] & (1<<(i&7)))
+		return 'N';
+	return "ACGT"[ (view->packed_sequence[i>>2] >> ((i&3)*2)) & 3 ];
+}
+
+/*
+	Store writer - used by the 'fastx_store' program.
+	Records are added one by one (sections are spooled to temporary files),
+	and the store is written when it's closed.
+*/
+struct fastx_store_writer;
+
+struct fastx_store_writer* fastx_store_writer_new(const char* filename, int fastq,
+		int fastq_ascii, int fastq_ascii_quality_offset);
+
+// Bases must be upper-case A/C/G/T/N. 'quality' is ignored for FASTA stores.
+void fastx_store_writer_add(struct fastx_store_writer *writer,
+		const char* name, const char* name2,
+		const char* nucleotides, const int* quality, size_t length);
+
+void fastx_store_writer_close(struct fastx_store_writer *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
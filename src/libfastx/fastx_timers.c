@@ -0,0 +1,230 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "fastx_timers.h"
+
+FASTX_TIMERS fastx_timers;
+
+static const char* timer_names[FASTX_TIMERS_COUNT] = {
+	"setup", "parse", "validate", "quality", "write", "process"
+};
+
+static uint64_t nanoseconds_between(const struct timespec *from, const struct timespec *to)
+{
+	return (uint64_t)(to->tv_sec - from->tv_sec) * 1000000000ULL
+		+ to->tv_nsec - from->tv_nsec ;
+}
+
+void fastx_timers_start()
+{
+	memset(&fastx_timers, 0, sizeof(fastx_timers));
+	clock_gettime(CLOCK_MONOTONIC, &fastx_timers.start);
+	fastx_timers.enabled = 1 ;
+}
+
+void fastx_timed_call_begin_enabled(FASTX_TIMED_CALL call, FASTX_TIMER timer)
+{
+	//The first call is always timed (it also ends the setup stage)
+	if (fastx_timers.calls[call]++ % FASTX_TIMERS_SAMPLE_INTERVAL != 0)
+		return;
+
+	clock_gettime(CLOCK_MONOTONIC, &fastx_timers.last_switch);
+	if (fastx_timers.setup_nanoseconds==0)
+		fastx_timers.setup_nanoseconds =
+			nanoseconds_between(&fastx_timers.start, &fastx_timers.last_switch);
+
+	fastx_timers.timed_calls[call]++;
+	fastx_timers.call = call;
+	fastx_timers.current = timer;
+	fastx_timers.sampling = 1 ;
+}
+
+void fastx_timer_switch_sampling(FASTX_TIMER timer)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	fastx_timers.nanoseconds[fastx_timers.call][fastx_timers.current] +=
+		nanoseconds_between(&fastx_timers.last_switch, &now);
+	fastx_timers.last_switch = now;
+	fastx_timers.current = timer;
+}
+
+void fastx_timed_call_end_sampling()
+{
+	fastx_timer_switch_sampling(FASTX_TIMER_PROCESS);
+	fastx_timers.sampling = 0 ;
+}
+
+const char* fastx_timer_name(FASTX_TIMER timer)
+{
+	return timer_names[timer];
+}
+
+void fastx_timers_estimate(double seconds[FASTX_TIMERS_COUNT])
+{
+	struct timespec now;
+	double total, others = 0 ;
+	double scale;
+	int call;
+	int i;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	total = nanoseconds_between(&fastx_timers.start, &now) / 1e9 ;
+
+	memset(seconds, 0, sizeof(double)*FASTX_TIMERS_COUNT);
+	//Before the first call, all the time is setup
+	seconds[FASTX_TIMER_SETUP] = (fastx_timers.setup_nanoseconds>0) ?
+			fastx_timers.setup_nanoseconds / 1e9 : total ;
+
+	//Scale the timed calls up to all the calls
+	for (call=0; call<FASTX_TIMED_CALLS_COUNT; call++) {
+		if (fastx_timers.timed_calls[call]==0)
+			continue;
+		scale = (double)fastx_timers.calls[call] / fastx_timers.timed_calls[call];
+		for (i=0; i<FASTX_TIMERS_COUNT; i++)
+			seconds[i] += fastx_timers.nanoseconds[call][i] / 1e9 * scale ;
+	}
+
+	for (i=0; i<FASTX_TIMERS_COUNT; i++)
+		if (i!=FASTX_TIMER_PROCESS)
+			others += seconds[i];
+	seconds[FASTX_TIMER_PROCESS] = (total > others) ? total - others : 0 ;
+}
+
+static double total_seconds(const double seconds[FASTX_TIMERS_COUNT])
+{
+	double total = 0 ;
+	int i;
+
+	for (i=0; i<FASTX_TIMERS_COUNT; i++)
+		total += seconds[i];
+	return total;
+}
+
+// Per second, or 0 if no time was measured
+static double rate(uint64_t count, double seconds)
+{
+	return (seconds>0) ? count/seconds : 0 ;
+}
+
+// The parallel chunked reader's threads validated the records, not the main thread
+// (unless it fell back to the sequential reader)
+static int validated_by_reader_threads(int timer, double seconds)
+{
+	return timer==FASTX_TIMER_VALIDATE && fastx_timers.reader_threads>0 && !(seconds>0) ;
+}
+
+// The size of each read/write (0 = stdio's default), and the pipe's capacity (if a pipe)
+static void print_io_size(FILE *output, const char* name, uint64_t buffer_size, uint64_t pipe_size)
+{
+	if (buffer_size>0)
+		fprintf(output, "%s size %llu KB", name, (unsigned long long)buffer_size/1024);
+	else
+		fprintf(output, "%s size default", name);
+	if (pipe_size>0)
+		fprintf(output, " (pipe %llu KB)", (unsigned long long)pipe_size/1024);
+}
+
+void fastx_timers_print(FILE *output)
+{
+	double seconds[FASTX_TIMERS_COUNT];
+	double total;
+	int i;
+
+	if (!fastx_timers.enabled)
+		return;
+	fastx_timers_estimate(seconds);
+	total = total_seconds(seconds);
+
+	fprintf(output, "Time: %.3f seconds (", total);
+	for (i=0; i<FASTX_TIMERS_COUNT; i++)
+		if (validated_by_reader_threads(i, seconds[i]))
+			fprintf(output, ", %s n/a", timer_names[i]);
+		else
+			fprintf(output, "%s%s %.3f", (i>0)?", ":"", timer_names[i], seconds[i]);
+	fprintf(output, ")\n");
+	if (fastx_timers.reader_threads>0)
+		fprintf(output, "Reader threads: %u, %.3f seconds parsing and validating (not included above)\n",
+			fastx_timers.reader_threads,
+			fastx_timers.reader_threads_nanoseconds / 1e9);
+
+	fprintf(output, "Bytes: input %llu (%.1f MB/s), output %llu (%.1f MB/s)\n",
+		(unsigned long long)fastx_timers.bytes_in,
+		rate(fastx_timers.bytes_in, total) / (1024*1024),
+		(unsigned long long)fastx_timers.bytes_out,
+		rate(fastx_timers.bytes_out, total) / (1024*1024));
+
+	fprintf(output, "I/O: ");
+	print_io_size(output, "read", fastx_timers.input_buffer_size, fastx_timers.input_pipe_size);
+	fprintf(output, ", ");
+	print_io_size(output, "write", fastx_timers.output_buffer_size, fastx_timers.output_pipe_size);
+	fprintf(output, "%s\n", fastx_timers.huge_pages ? ", huge pages" : "");
+}
+
+void fastx_timers_write_json(FILE *output, const char* program_name)
+{
+	double seconds[FASTX_TIMERS_COUNT];
+	double total;
+	int i;
+
+	if (!fastx_timers.enabled)
+		return;
+	fastx_timers_estimate(seconds);
+	total = total_seconds(seconds);
+
+	fprintf(output, "{\"program\": \"");
+	//Program names are plain file names, but escape them properly anyway
+	for ( ; *program_name; program_name++) {
+		if (*program_name=='"' || *program_name=='\\')
+			fprintf(output, "\\%c", *program_name);
+		else if ((unsigned char)*program_name < 0x20)
+			fprintf(output, "\\u%04x", (unsigned char)*program_name);
+		else
+			fputc(*program_name, output);
+	}
+	fprintf(output, "\", \"seconds\": {\"total\": %.6f", total);
+	for (i=0; i<FASTX_TIMERS_COUNT; i++)
+		if (validated_by_reader_threads(i, seconds[i]))
+			fprintf(output, ", \"%s\": null", timer_names[i]);
+		else
+			fprintf(output, ", \"%s\": %.6f", timer_names[i], seconds[i]);
+	fprintf(output, "}, \"reader_threads\": %u, \"reader_threads_seconds\": %.6f",
+		fastx_timers.reader_threads,
+		fastx_timers.reader_threads_nanoseconds / 1e9);
+	fprintf(output, ", \"bytes_in\": %llu, \"bytes_out\": %llu"
+			", \"sequences_in\": %llu, \"sequences_out\": %llu"
+			", \"bytes_in_per_sec\": %.0f, \"sequences_in_per_sec\": %.0f"
+			", \"read_size\": %llu, \"read_pipe_size\": %llu"
+			", \"write_size\": %llu, \"write_pipe_size\": %llu, \"huge_pages\": %s}\n",
+		(unsigned long long)fastx_timers.bytes_in,
+		(unsigned long long)fastx_timers.bytes_out,
+		(unsigned long long)fastx_timers.sequences_in,
+		(unsigned long long)fastx_timers.sequences_out,
+		rate(fastx_timers.bytes_in, total),
+		rate(fastx_timers.sequences_in, total),
+		(unsigned long long)fastx_timers.input_buffer_size,
+		(unsigned long long)fastx_timers.input_pipe_size,
+		(unsigned long long)fastx_timers.output_buffer_size,
+		(unsigned long long)fastx_timers.output_pipe_size,
+		fastx_timers.huge_pages ? "true" : "false");
+}
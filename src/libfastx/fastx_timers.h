@@ -0,0 +1,140 @@
+/*
+    FASTX-toolkit - FASTA/FASTQ preprocessing tools.
+    Copyright (C) 2009-2013  A. Gordon (assafgordon@gmail.com)
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+#ifndef __FASTX_TIMERS_H__
+#define __FASTX_TIMERS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+	Stage timers -
+	The time of a program run is divided between the stages below.
+	libfastx switches between the stages as it reads and writes records;
+	the rest of the time (between reading a record and writing it) is the
+	program's own processing.
+
+	To keep the overhead low, only one in FASTX_TIMERS_SAMPLE_INTERVAL
+	calls to fastx_read_next_record() and fastx_write_record() is timed
+	(each switch reads the monotonic clock once), and the totals are
+	estimated from the timed calls. When the timers are not enabled
+	(see fastx_timers_start()), a switch is a single test.
+
+	Only the main thread is sampled. The parallel chunked reader's threads
+	parse and validate the records (see fastx_chunks.h) - their total time
+	is counted separately, and the main thread's validate stage is then
+	reported as n/a (its parse stage is copying the parsed records).
+*/
+
+#define FASTX_TIMERS_SAMPLE_INTERVAL (16)
+
+typedef enum {
+	FASTX_TIMER_SETUP=0,	// before the first record is read
+	FASTX_TIMER_PARSE,	// reading and splitting the input lines
+	FASTX_TIMER_VALIDATE,	// validating the nucleotides
+	FASTX_TIMER_QUALITY,	// decoding the quality scores
+	FASTX_TIMER_WRITE,	// formatting and writing the output
+	FASTX_TIMER_PROCESS,	// everything else - the program's own processing
+	FASTX_TIMERS_COUNT
+} FASTX_TIMER;
+
+typedef enum {
+	FASTX_TIMED_READ=0,	// fastx_read_next_record()
+	FASTX_TIMED_WRITE,	// fastx_write_record()
+	FASTX_TIMED_SINK_WRITE,	// writing a formatted record to a sink (see fastx_sinks.h)
+	FASTX_TIMED_CALLS_COUNT
+} FASTX_TIMED_CALL;
+
+typedef struct
+{
+	int	enabled;
+	int	sampling;		// 1 = the current call is timed
+	FASTX_TIMED_CALL call;	// the current call (if sampling)
+	FASTX_TIMER current;
+	struct timespec start;
+	struct timespec last_switch;
+
+	uint64_t setup_nanoseconds;
+	uint64_t nanoseconds[FASTX_TIMED_CALLS_COUNT][FASTX_TIMERS_COUNT]; // in the timed calls only
+	uint64_t calls[FASTX_TIMED_CALLS_COUNT];
+	uint64_t timed_calls[FASTX_TIMED_CALLS_COUNT];
+
+	uint64_t bytes_in;		// uncompressed input (as parsed)
+	uint64_t bytes_out;		// uncompressed output (as formatted)
+	uint64_t sequences_in;
+	uint64_t sequences_out;
+
+	unsigned int reader_threads;	// the parallel chunked readers' threads (0 = none)
+	uint64_t reader_threads_nanoseconds; // parsing and validating, all the threads together
+
+	/* Effective I/O sizes - the largest of all the streams (see fastx_iotune.h) */
+	uint64_t input_buffer_size;	// bytes per read() (0 = stdio's default)
+	uint64_t input_pipe_size;	// pipe capacity (0 = not a pipe)
+	uint64_t output_buffer_size;	// bytes per write() (0 = stdio's default)
+	uint64_t output_pipe_size;
+	int	huge_pages;		// 1 = the buffers are on huge pages
+} FASTX_TIMERS;
+
+extern FASTX_TIMERS fastx_timers;
+
+// Start timing (in the SETUP stage)
+void fastx_timers_start();
+
+void fastx_timed_call_begin_enabled(FASTX_TIMED_CALL call, FASTX_TIMER timer);
+void fastx_timer_switch_sampling(FASTX_TIMER timer);
+void fastx_timed_call_end_sampling();
+
+// Called when entering fastx_read_next_record()/fastx_write_record()
+static inline void fastx_timed_call_begin(FASTX_TIMED_CALL call, FASTX_TIMER timer)
+{
+	if (fastx_timers.enabled)
+		fastx_timed_call_begin_enabled(call, timer);
+}
+
+static inline void fastx_timer_switch(FASTX_TIMER timer)
+{
+	if (fastx_timers.sampling)
+		fastx_timer_switch_sampling(timer);
+}
+
+static inline void fastx_timed_call_end()
+{
+	if (fastx_timers.sampling)
+		fastx_timed_call_end_sampling();
+}
+
+const char* fastx_timer_name(FASTX_TIMER timer);
+
+// Estimated seconds spent in each stage
+void fastx_timers_estimate(double seconds[FASTX_TIMERS_COUNT]);
+
+// Print a two-line summary, and the I/O sizes (for the programs' verbose reports)
+void fastx_timers_print(FILE *output);
+
+// Write the timers as a single JSON object
+void fastx_timers_write_json(FILE *output, const char* program_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
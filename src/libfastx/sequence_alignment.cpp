@@ -4,10 +4,10 @@
 #include <iostream>
 #include <algorithm>
 #include <iomanip>
-#include <err.h>
 #include <stdio.h>
 #include <unistd.h>
 
+#include "fastx_error.h"
 #include "sequence_alignment.h"
 
 using namespace std;
@@ -566,7 +566,7 @@ SequenceAlignmentResults HalfLocalSequenceAlignment::find_optimal_alignment_from
 				break ;
 
 			default:
-				errx(1,"Internal error: unknown match type (%c) at query_index=%zu, target_index=%zu\n",
+				fastx_errx(1,"Internal error: unknown match type (%c) at query_index=%zu, target_index=%zu\n",
 					current_match, query_index, target_index ) ;
 			}
 